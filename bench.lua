@@ -0,0 +1,88 @@
+-- Times every public operation of each available backend.
+-- Usage: luajit bench.lua [iterations]
+-- Output is tab-separated: backend, operation, ns per operation, GC bytes allocated per operation.
+
+local iterations = tonumber(arg and arg[1]) or 1000000
+
+local backends = {}
+
+do
+  local ok, vector = pcall(require, "vector")
+  if ok and vector.backend == "ffi" then
+    table.insert(backends, {name = "ffi", vector = vector})
+  else
+    io.stderr:write("skipping ffi backend: ", ok and "FFI is not available" or tostring(vector), "\n")
+  end
+end
+
+do
+  local open = package.loadlib("./vector_old.so", "luaopen_vector")
+  if open then
+    table.insert(backends, {name = "capi", vector = open()})
+  else
+    io.stderr:write("skipping capi backend: ./vector_old.so is not built\n")
+  end
+end
+
+table.insert(backends, {name = "pure", vector = require("vector_pure")})
+
+local operations = {
+  {"new", function(vector) return vector.new(1, 2, 3) end},
+  {"add", function(_, a, b) return a + b end},
+  {"sub", function(_, a, b) return a - b end},
+  {"mul", function(_, a) return a * 2 end},
+  {"div", function(_, a) return a / 2 end},
+  {"mod", function(_, a) return a % 2 end},
+  {"unm", function(_, a) return -a end},
+  {"add_mut", function(_, a, b) return a:add_mut(b) end},
+  {"sub_mut", function(_, a, b) return a:sub_mut(b) end},
+  {"mul_mut", function(_, a) return a:mul_mut(1) end},
+  {"div_mut", function(_, a) return a:div_mut(1) end},
+  {"abs", function(_, a) return a:abs() end},
+  {"abs2", function(_, a) return a:abs2() end},
+  {"normalized", function(_, a) return a:normalized() end},
+  {"normalized2", function(_, _, _, a2) return a2:normalized2() end},
+  {"eq", function(_, a, b) return a == b end},
+  {"lt", function(_, a, b) return a < b end},
+  {"le", function(_, a, b) return a <= b end},
+  {"hex", function(vector) return vector.hex("ff8000") end},
+  {"tostring", function(_, a) return tostring(a) end},
+  {"copy", function(_, a) return a:copy() end},
+  {"unpack", function(_, a) return a:unpack() end},
+  {"len", function(_, a) return #a end},
+  {"map", function(_, a) return a:map(math.floor) end},
+}
+
+local measure = function(f, vector, a, b, a2)
+  for _ = 1, math.ceil(iterations / 10) do
+    f(vector, a, b, a2)
+  end
+
+  collectgarbage("collect")
+  collectgarbage("stop")
+  local memory_before = collectgarbage("count")
+  local time_before = os.clock()
+  for _ = 1, iterations do
+    f(vector, a, b, a2)
+  end
+  local elapsed = os.clock() - time_before
+  local allocated = (collectgarbage("count") - memory_before) * 1024
+  collectgarbage("restart")
+
+  return elapsed * 1e9 / iterations, allocated / iterations
+end
+
+print("backend\toperation\tns_per_op\tbytes_per_op")
+for _, backend in ipairs(backends) do
+  local vector = backend.vector
+  for _, operation in ipairs(operations) do
+    local name, f = operation[1], operation[2]
+    local a, b, a2 = vector.new(1.5, 2.5, 3.5), vector.new(4, 5, 6), vector.new(3, -4)
+    local ok, ns, bytes = pcall(measure, f, vector, a, b, a2)
+    if ok then
+      print(("%s\t%s\t%.2f\t%.1f"):format(backend.name, name, ns, bytes))
+    else
+      io.stderr:write(("%s %s failed: %s\n"):format(backend.name, name, tostring(ns)))
+    end
+  end
+end
@@ -3,6 +3,17 @@
 --- @class vector: number[]
 --- @field items number[]
 --- @field len integer
+--- @field x number? components by name, nil past len; also y, z, w and r, g, b, a
+--- @field y number?
+--- @field z number?
+--- @field w number?
+--- @field r number?
+--- @field g number?
+--- @field b number?
+--- @field a number?
+--- @field xy vector? any 1-4 letters from one of xyzw/rgba read as a new vector, e.g. v.zyx, v.rgb;
+--- assigning a vector to a pattern without repeated letters writes the components, e.g. v.xy = u
+--- @field rgb vector?
 --- @operator add(vector): vector
 --- @operator sub(vector): vector
 --- @operator mul(number): vector
@@ -12,10 +23,415 @@ local vector_methods = {}
 
 local vector = {}
 
+--- "ffi" over libvector.so, or "capi" for the Lua C API module vector_old.so, which require picks
+--- when FFI is not available or VECTOR_BACKEND=capi is set. The C API backend has the single-vector
+--- API and the functions over numbers and Lua sequences of vectors, returning zero-based tables
+--- where vector.lua returns C buffers; arrays, buffers and the C module types need FFI. See the
+--- header of vector_old.c for the full list.
+--- @type "ffi" | "capi"
+vector.backend = "ffi"
+
 --- @param ... number
 --- @return vector
 vector.new = function(...) end
 
+--- Single precision vector, 20 bytes instead of 40
+--- @param ... number
+--- @return vectorf
+vector.newf = function(...) end
+
+--- Single precision counterpart of `vector.hex`
+--- @param hex string
+--- @return vectorf
+vector.hexf = function(hex) end
+
+--- Fixed-width vector picked by the number of arguments (2 to 4): no len field and kernels
+--- unrolled at compile time. `vector.new` keeps returning the generic `vector`, which is what
+--- the rest of the C API accepts.
+--- @param ... number
+--- @return vec2 | vec3 | vec4
+vector.vec = function(...) end
+
+--- @param x number
+--- @param y number
+--- @return vec2
+vector.vec2 = function(x, y) end
+
+--- @param x number
+--- @param y number
+--- @param z number
+--- @return vec3
+vector.vec3 = function(x, y, z) end
+
+--- @param x number
+--- @param y number
+--- @param z number
+--- @param w number
+--- @return vec4
+vector.vec4 = function(x, y, z, w) end
+
+--- Integer grid vector, comparable and hashable by value
+--- @param x integer
+--- @param y integer
+--- @return ivec2
+vector.ivec2 = function(x, y) end
+
+--- @param x integer
+--- @param y integer
+--- @param z integer
+--- @return ivec3
+vector.ivec3 = function(x, y, z) end
+
+--- Open-addressing hash map in C from ivec keys to integer payloads
+--- @param dim? 2 | 3 key dimension, 2 by default
+--- @param capacity? integer expected number of entries
+--- @return ivec_map
+vector.ivec_map = function(dim, capacity) end
+
+--- Uniform spatial hash over 2D or 3D vector positions, keyed by integer ids. Entries live in an
+--- array indexed by id, so ids should be small and dense, like indices into the caller's objects.
+--- @param cell_size number roughly the typical query radius
+--- @param dim? 2 | 3 2 by default
+--- @return spatial_hash
+vector.spatial_hash = function(cell_size, dim) end
+
+--- Buffer of int32 ids for query results, zero-based
+--- @param capacity integer
+--- @return integer[]
+vector.id_buffer = function(capacity) end
+
+--- Static k-d tree over 2 to 4 dimensional points of the same length
+--- @param points vector[] | ffi.cdata* Lua sequence or a vector.buffer
+--- @param n? integer number of points, required for a buffer
+--- @return kd_tree
+vector.kd_tree = function(points, n) end
+
+--- Contiguous zero-based C array of `n` vectors
+--- @param n integer
+--- @return vector[]
+vector.buffer = function(n) end
+
+--- Row-major matrices: no arguments give the identity, otherwise n * n items row by row.
+--- `m * m` composes, `m * v` transforms; a vector one component shorter than the matrix is a
+--- point (w = 1), so mat3 is a 2D affine transform and mat4 a 3D one.
+--- @param ... number
+--- @return mat2
+vector.mat2 = function(...) end
+
+--- @param ... number
+--- @return mat3
+vector.mat3 = function(...) end
+
+--- @param ... number
+--- @return mat4
+vector.mat4 = function(...) end
+
+--- @param angle number
+--- @return mat2
+vector.mat2_rotation = function(angle) end
+
+--- @param x number
+--- @param y number
+--- @return mat3
+vector.mat3_translation = function(x, y) end
+
+--- @param angle number
+--- @return mat3
+vector.mat3_rotation = function(angle) end
+
+--- @param x number
+--- @param y? number defaults to x
+--- @return mat3
+vector.mat3_scale = function(x, y) end
+
+--- translation * rotation * scale
+--- @param x number
+--- @param y number
+--- @param angle? number
+--- @param scale_x? number
+--- @param scale_y? number defaults to scale_x
+--- @return mat3
+vector.mat3_compose = function(x, y, angle, scale_x, scale_y) end
+
+--- @param x number
+--- @param y number
+--- @param z number
+--- @return mat4
+vector.mat4_translation = function(x, y, z) end
+
+--- @param x number
+--- @param y? number defaults to x
+--- @param z? number defaults to x
+--- @return mat4
+vector.mat4_scale = function(x, y, z) end
+
+--- Rotation around the axis (x, y, z)
+--- @param x number
+--- @param y number
+--- @param z number
+--- @param angle number
+--- @return mat4
+vector.mat4_rotation = function(x, y, z, angle) end
+
+--- Starts a lazy expression: +, -, * k, / k and unary minus are recorded instead of executed,
+--- and `:eval(result?)` runs the whole chain in one C call, allocating at most the result.
+--- Recording allocates nothing because all expressions share one program, so build and evaluate
+--- one expression at a time; :eval consumes it, and an unevaluated one fails the next :eval.
+--- @param v vector
+--- @return vector_expression
+vector.lazy = function(v) end
+
+--- result = a * x + y
+--- @param a number
+--- @param x vector
+--- @param y vector
+--- @param result? vector
+--- @return vector
+vector.axpy = function(a, x, y, result) end
+
+--- Reusable A* and Dijkstra scratch memory for a `width` x `height` grid
+--- @param width integer
+--- @param height integer
+--- @return pathfinder
+vector.pathfinder = function(width, height) end
+
+--- Row-major float[width * height] of costs of entering each cell; negative or math.huge blocks
+--- @param width integer
+--- @param height integer
+--- @param cost? number initial cost of every cell, 1 by default
+--- @return number[]
+vector.cost_grid = function(width, height, cost) end
+
+--- Direction names of the first `n` steps of a 4-connected path; errors on a diagonal step
+--- @param steps vector[] buffer returned by pathfinder:astar
+--- @param n integer
+--- @return ("up" | "left" | "down" | "right")[]
+vector.path_names = function(steps, n) end
+
+--- Row-major uint8_t[width * height] sight mask, zero-filled; non-zero cells block sight
+--- @param width integer
+--- @param height integer
+--- @return integer[]
+vector.grid_mask = function(width, height) end
+
+--- Bresenham cells from `from` to `to` inclusive, see spatial_hash:query_radius for buffers
+--- @param from vector
+--- @param to vector
+--- @param result? vector[]
+--- @param capacity? integer
+--- @return vector[], integer, integer
+vector.line = function(from, to, result, capacity) end
+
+--- True if no blocking cell lies strictly between the two cells; the endpoints may be walls
+--- @param blocking integer[] see vector.grid_mask
+--- @param width integer
+--- @param height integer
+--- @param from vector
+--- @param to vector
+--- @return boolean
+vector.line_of_sight = function(blocking, width, height, from, to) end
+
+--- First blocking cell along the ray; integer coordinates are cell centers and the origin cell
+--- never blocks. The grid edge blocks too and is reported as the last cell inside.
+--- @param blocking integer[]
+--- @param width integer
+--- @param height integer
+--- @param origin vector
+--- @param direction vector any non-zero length
+--- @param max_distance? number
+--- @return vector? hit nil if nothing is hit within max_distance
+--- @return number distance to the boundary of the hit cell
+vector.raycast = function(blocking, width, height, origin, direction, max_distance) end
+
+--- Shadowcasting field of view: cells seen from `origin` are set to 1, others to 0
+--- @param blocking integer[]
+--- @param width integer
+--- @param height integer
+--- @param origin vector
+--- @param radius? number unlimited by default
+--- @param visible? integer[] reused uint8_t[width * height]
+--- @return integer[]
+vector.fov = function(blocking, width, height, origin, radius, visible) end
+
+--- @class vector_stats
+--- @field functions table<string, {calls: integer, cycles: integer}> by C function name, e.g. vector_add_into; cycles include nested calls and are nanoseconds off x86
+--- @field allocations table<string, integer> vectors allocated by new, hex, copy, normalized, normalized2 and the __unm/__add/... operators
+
+--- Counters since load or the last vector.reset_stats(); empty unless libvector.so is built with
+--- `make STATS=1`
+--- @return vector_stats
+vector.stats = function() end
+
+vector.reset_stats = function() end
+
+--- Memory-maps a binary snapshot, checking only its header; errors if the file is missing or
+--- the header is malformed
+--- @param path string
+--- @return vector_snapshot
+vector.load = function(path) end
+
+--- Streaming snapshot writer for vectors of length `dim`
+--- @param path string
+--- @param dim integer
+--- @param precision? 4 | 8 bytes per component, 8 (vector) by default, 4 stores vectorf
+--- @return vector_snapshot_writer
+vector.snapshot_writer = function(path, dim, precision) end
+
+--- Writes a whole sequence or buffer of vectors of the same length as one snapshot
+--- @param path string
+--- @param points vector[] | ffi.cdata*
+--- @param n? integer required for a buffer
+--- @param precision? 4 | 8
+vector.save = function(path, points, n, precision) end
+
+--- Formats vectors like tostring in one call
+--- @param points vector[] | ffi.cdata*
+--- @param n? integer required for a buffer
+--- @param separator? string "\n" by default
+--- @return string
+vector.format = function(points, n, separator) end
+
+--- Reads every `{1; 2; 3}` vector in `text`, skipping other text and malformed vectors. With a
+--- buffer reads at most `capacity`; an incomplete vector at the end of `text` is left for the next
+--- chunk, which should start at the returned offset.
+--- @param text string
+--- @param result? vector[] see vector.buffer; without it an exact buffer is allocated
+--- @param capacity? integer
+--- @return vector[] result, integer n, integer consumed zero-based offset after the last read vector
+vector.parse = function(text, result, capacity) end
+
+--- Splits vector.array operations across a persistent pool of `n` threads, the caller included;
+--- 1 (the default) keeps everything on the calling thread. Work is cut into fixed chunks, so
+--- results do not depend on `n`.
+--- @param n integer clamped to [1, 256]
+--- @param threshold? integer arrays with fewer than this many numbers (len * dim; len for abs and normalization) stay single-threaded, 100000 by default
+vector.set_threads = function(n, threshold) end
+
+--- @return integer threads, integer threshold
+vector.threads = function() end
+
+--- Incremental sweep-and-prune broad phase over axis-aligned boxes
+--- @param dim? 2 | 3 2 by default
+--- @return sweep_prune
+vector.sweep_prune = function(dim) end
+
+--- @alias easing
+--- | "linear" | "quad_in" | "quad_out" | "quad_in_out" | "cubic_in" | "cubic_out" | "cubic_in_out"
+--- | "quart_in" | "quart_out" | "quart_in_out" | "sine_in" | "sine_out" | "sine_in_out"
+--- | "expo_in" | "expo_out" | "expo_in_out" | "back_in" | "back_out" | "back_in_out"
+--- | "elastic_in" | "elastic_out" | "elastic_in_out" | "bounce_in" | "bounce_out" | "bounce_in_out"
+
+--- Easing curve ids by name
+--- @type table<easing, integer>
+vector.easings = {}
+
+--- Easing curve at `t`, clamped to [0, 1]
+--- @param easing? easing | integer linear by default
+--- @param t number
+--- @return number
+vector.ease = function(easing, t) end
+
+--- Engine stepping many tweens per update call, writing into their targets in place
+--- @return tween_engine
+vector.tween_engine = function() end
+
+--- Turns on pooling of the vectors the library allocates, reused through v:release() and
+--- vector.frame_scope; 0 turns it off
+--- @param capacity integer most vectors kept in the free list
+--- @param preallocate? integer vectors to put into the free list right away
+vector.set_pooling = function(capacity, preallocate) end
+
+--- Calls fn(...) and releases every vector allocated during the call except the returned ones
+--- @generic T
+--- @param fn fun(...): T
+--- @return T
+vector.frame_scope = function(fn, ...) end
+
+--- @class vector_pool_stats
+--- @field hits integer allocations served from the free list
+--- @field misses integer allocations of new vectors while pooling
+--- @field in_use integer vectors handed out by the pool and not released yet
+--- @field peak_in_use integer most vectors in use at once since the last reset
+--- @field free integer
+--- @field capacity integer
+
+--- @return vector_pool_stats
+vector.pool_stats = function() end
+
+--- Zeroes hits, misses and peak_in_use
+vector.reset_pool_stats = function() end
+
+--- Componentwise sum with pairwise summation; errors on empty input or mixed lengths
+--- @param points vector[] | ffi.cdata*
+--- @param n? integer required for a buffer
+--- @param result? vector
+--- @return vector
+vector.sum = function(points, n, result) end
+
+--- Centroid, see vector.sum
+--- @param points vector[] | ffi.cdata*
+--- @param n? integer required for a buffer
+--- @param result? vector
+--- @return vector
+vector.mean = function(points, n, result) end
+
+--- Componentwise minimum and maximum; NaN components are skipped
+--- @param points vector[] | ffi.cdata*
+--- @param n? integer required for a buffer
+--- @param min? vector
+--- @param max? vector
+--- @return vector min, vector max
+vector.aabb = function(points, n, min, max) end
+
+--- Componentwise population variance
+--- @param points vector[] | ffi.cdata*
+--- @param n? integer required for a buffer
+--- @param result? vector
+--- @param mean? vector
+--- @return vector variance, vector mean
+vector.variance = function(points, n, result, mean) end
+
+--- Population covariance matrix of vectors of length 2 to 4
+--- @param points vector[] | ffi.cdata*
+--- @param n? integer required for a buffer
+--- @param mean? vector
+--- @return mat2 | mat3 | mat4 covariance, vector mean
+vector.covariance = function(points, n, mean) end
+
+--- Distances from `origin` to every vector; raises unless all have the length of `origin`
+--- @param origin vector
+--- @param points vector[] | ffi.cdata*
+--- @param n? integer required for a buffer
+--- @param result? number[] double buffer of at least `n`
+--- @param squared? boolean
+--- @return number[] zero-based
+vector.distances = function(origin, points, n, result, squared) end
+
+--- Zero-based indices of the vectors within `radius` of `origin`, boundary included; raises
+--- unless all have the length of `origin`
+--- @param origin vector
+--- @param points vector[] | ffi.cdata*
+--- @param n? integer required for a buffer
+--- @param radius number
+--- @param result? integer[] see vector.id_buffer
+--- @param capacity? integer
+--- @return integer[], integer, integer
+vector.within_radius = function(origin, points, n, radius, result, capacity) end
+
+--- Seedable random stream (xoshiro256**); the same seed and stream always give the same samples,
+--- so give every caller its own stream to keep it independent of the others
+--- @param seed? integer 0 by default
+--- @param stream? integer 0 by default
+--- @return vector_rng
+vector.rng = function(seed, stream) end
+
+--- Packed struct-of-arrays buffer of `n` vectors with `dim` components each (2 by default);
+--- batched operations run over the whole buffer in a single call
+--- @param n integer
+--- @param dim? integer
+--- @return vector_array
+vector.array = function(n, dim) end
+
 --- Creates vector from its hexadecimal representation; each coordinate is between 0 and 1
 --- @param hex string
 --- @return vector
@@ -44,6 +460,17 @@ vector.extended_directions = {
 --- @return string?
 vector.name_from_direction = function(v) end
 
+--- @alias simd_name "scalar" | "sse2" | "avx2"
+
+--- Name of the kernel set chosen at load time by CPU feature detection
+--- @return simd_name
+vector.simd = function() end
+
+--- Forces a kernel set; all of them give bit-identical results
+--- @param name simd_name
+--- @return boolean false if the CPU does not support it
+vector.set_simd = function(name) end
+
 -- --- @param f fun(n: number): number
 -- --- @param ... vector
 -- --- @return vector
@@ -54,6 +481,11 @@ vector.name_from_direction = function(v) end
 --- @return T
 vector_methods.copy = function(self) end
 
+--- Returns the vector to the pool, see vector.set_pooling; it must not be used afterwards.
+--- Releasing it twice, or releasing a vector the pool did not allocate, is an error
+--- @param self vector
+vector_methods.release = function(self) end
+
 --- @generic T
 --- @param self T
 --- @param other vector
@@ -89,6 +521,140 @@ vector_methods.mod_mut = function(self, other) end
 --- @return T
 vector_methods.unm_mut = function(self) end
 
+--- The `*_into` family writes the result into `result` instead of allocating; `result` may be
+--- one of the arguments
+
+--- @param self vector
+--- @param result vector
+--- @return vector
+vector_methods.copy_into = function(self, result) end
+
+--- @param self vector
+--- @param result vector
+--- @return vector
+vector_methods.unm_into = function(self, result) end
+
+--- @param self vector
+--- @param other vector
+--- @param result vector
+--- @return vector
+vector_methods.add_into = function(self, other, result) end
+
+--- @param self vector
+--- @param other vector
+--- @param result vector
+--- @return vector
+vector_methods.sub_into = function(self, other, result) end
+
+--- @param self vector
+--- @param other number
+--- @param result vector
+--- @return vector
+vector_methods.mul_into = function(self, other, result) end
+
+--- @param self vector
+--- @param other number
+--- @param result vector
+--- @return vector
+vector_methods.div_into = function(self, other, result) end
+
+--- @param self vector
+--- @param other number
+--- @param result vector
+--- @return vector
+vector_methods.mod_into = function(self, other, result) end
+
+--- @param self vector
+--- @param result vector
+--- @return vector
+vector_methods.normalized_into = function(self, result) end
+
+--- Returns nil for non-2D vectors
+--- @param self vector
+--- @param result vector
+--- @return vector?
+vector_methods.normalized2_into = function(self, result) end
+
+--- @param self vector
+--- @param result? vectorf
+--- @return vectorf
+vector_methods.to_vectorf = function(self, result) end
+
+--- Converts to ivec2 or ivec3 by len, flooring the coordinates
+--- @param self vector
+--- @param result? ivec2 | ivec3
+--- @return ivec2 | ivec3
+vector_methods.to_ivec = function(self, result) end
+
+--- Converts to vec2, vec3 or vec4 by len
+--- @param self vector
+--- @param result? vec2 | vec3 | vec4
+--- @return vec2 | vec3 | vec4
+vector_methods.to_vec = function(self, result) end
+
+--- self + other * k
+--- @param self vector
+--- @param other vector
+--- @param k number
+--- @return vector
+vector_methods.madd = function(self, other, k) end
+
+--- self + (other - self) * t
+--- @param self vector
+--- @param other vector
+--- @param t number
+--- @return vector
+vector_methods.lerp = function(self, other, t) end
+
+--- Componentwise self * other + addend
+--- @param self vector
+--- @param other vector
+--- @param addend vector
+--- @return vector
+vector_methods.fma = function(self, other, addend) end
+
+--- Componentwise clamp
+--- @param self vector
+--- @param min vector
+--- @param max vector
+--- @return vector
+vector_methods.clamp = function(self, min, max) end
+
+--- @param self vector
+--- @param other vector
+--- @param k number
+--- @param result vector
+--- @return vector
+vector_methods.madd_into = function(self, other, k, result) end
+
+--- @param self vector
+--- @param other vector
+--- @param t number
+--- @param result vector
+--- @return vector
+vector_methods.lerp_into = function(self, other, t, result) end
+
+--- @param self vector
+--- @param other vector
+--- @param addend vector
+--- @param result vector
+--- @return vector
+vector_methods.fma_into = function(self, other, addend, result) end
+
+--- @param self vector
+--- @param min vector
+--- @param max vector
+--- @param result vector
+--- @return vector
+vector_methods.clamp_into = function(self, min, max, result) end
+
+--- Swizzle by a pattern held in a string, e.g. v:swizzle(order); errors on invalid patterns
+--- @param self vector
+--- @param pattern string 1-4 letters from one of xyzw/rgba
+--- @param result? vector may be self
+--- @return vector
+vector_methods.swizzle = function(self, pattern, result) end
+
 --- @param self vector
 --- @param f fun(n: number): number
 --- @return vector
@@ -103,10 +669,41 @@ vector_methods.map = function(self, f) end
 --- @return number
 vector_methods.abs = function(self) end
 
+--- Manhattan (L1) length, not the squared length; see dist2 and dot
 --- @param self vector
 --- @return integer
 vector_methods.abs2 = function(self) end
 
+--- This, dist, dist2 and angle_between raise for vectors of different lengths
+--- @param self vector
+--- @param other vector
+--- @return number
+vector_methods.dot = function(self, other) end
+
+--- z of the 3D product for 2D vectors, the cross product vector for 3D ones
+--- @param self vector
+--- @param other vector
+--- @param result? vector used for 3D
+--- @return number | vector
+vector_methods.cross = function(self, other, result) end
+
+--- @param self vector
+--- @param other vector
+--- @return number
+vector_methods.dist = function(self, other) end
+
+--- Squared distance, for comparisons without allocating or taking a sqrt
+--- @param self vector
+--- @param other vector
+--- @return number
+vector_methods.dist2 = function(self, other) end
+
+--- Unsigned angle in [0, pi]; 0 if either vector is zero
+--- @param self vector
+--- @param other vector
+--- @return number
+vector_methods.angle_between = function(self, other) end
+
 --- @param self vector
 --- @return vector
 vector_methods.normalized = function(self) end
@@ -128,4 +725,481 @@ vector_methods.normalized2_mut = function(self) end
 --- @return vector
 vector_methods.normalized2_mut = function(self, pattern) end
 
+--- @class vector_array
+--- @field items number[][] items[component][index], both zero-based
+--- @field len integer
+--- @field dim integer
+--- @operator len: integer
+local array_methods = {}
+
+--- @param self vector_array
+--- @param i integer one-based index
+--- @param result? vector vector to write into instead of allocating a new one
+--- @return vector
+array_methods.get = function(self, i, result) end
+
+--- @param self vector_array
+--- @param i integer one-based index
+--- @param v vector
+--- @return vector_array
+array_methods.set = function(self, i, v) end
+
+--- Raises if the arrays differ in shape
+--- @param self vector_array
+--- @param other vector_array
+--- @return vector_array self
+array_methods.add_mut = function(self, other) end
+
+--- Raises if the arrays differ in shape
+--- @param self vector_array
+--- @param other vector_array
+--- @return vector_array self
+array_methods.sub_mut = function(self, other) end
+
+--- @param self vector_array
+--- @param k number
+--- @return vector_array
+array_methods.mul_mut = function(self, k) end
+
+--- self += other * k; raises if the arrays differ in shape
+--- @param self vector_array
+--- @param other vector_array
+--- @param k number
+--- @return vector_array self
+array_methods.add_scaled_mut = function(self, other, k) end
+
+--- @param self vector_array
+--- @return vector_array
+array_methods.normalized_mut = function(self) end
+
+--- Lengths of all vectors, zero-based
+--- @param self vector_array
+--- @param result? number[] buffer of at least `len` doubles to write into
+--- @return number[]
+array_methods.abs = function(self, result) end
+
+--- Single precision vector with the same methods and operators as `vector`; operands of
+--- arithmetic and comparisons must be `vectorf` too
+--- @class vectorf: vector
+local vectorf_methods = {}
+
+--- @param self vectorf
+--- @param result? vector
+--- @return vector
+vectorf_methods.to_vector = function(self, result) end
+
+--- Fixed-width vectors share the `vector` methods and operators (operands must have the same
+--- type); `normalized2` exists only on vec2
+--- @class vec2: vectorf
+--- @class vec3: vectorf
+--- @class vec4: vectorf
+
+--- @class ivec2
+--- @field items integer[]
+--- @operator add(ivec2): ivec2
+--- @operator sub(ivec2): ivec2
+--- @operator len: integer
+local ivec_methods = {}
+
+--- @class ivec3: ivec2
+
+--- @generic T
+--- @param self T
+--- @return T
+ivec_methods.copy = function(self) end
+
+--- @generic T
+--- @param self T
+--- @param other T
+--- @return T
+ivec_methods.add_mut = function(self, other) end
+
+--- @generic T
+--- @param self T
+--- @param other T
+--- @return T
+ivec_methods.sub_mut = function(self, other) end
+
+--- 32-bit hash of the coordinates
+--- @param self ivec2
+--- @return integer
+ivec_methods.hash = function(self) end
+
+--- @param self ivec2
+--- @return integer ...
+ivec_methods.unpack = function(self) end
+
+--- @param self ivec2
+--- @return vector
+ivec_methods.to_vector = function(self) end
+
+--- @class ivec_map
+--- @operator len: integer
+local map_methods = {}
+
+--- @param self ivec_map
+--- @param key ivec2 | ivec3
+--- @param value integer
+--- @return ivec_map
+map_methods.set = function(self, key, value) end
+
+--- @param self ivec_map
+--- @param key ivec2 | ivec3
+--- @return integer?
+map_methods.get = function(self, key) end
+
+--- @param self ivec_map
+--- @param key ivec2 | ivec3
+--- @return boolean
+map_methods.has = function(self, key) end
+
+--- @param self ivec_map
+--- @param key ivec2 | ivec3
+--- @return boolean whether the key was present
+map_methods.remove = function(self, key) end
+
+--- @param self ivec_map
+map_methods.clear = function(self) end
+
+--- @param self ivec_map
+--- @return fun(): (ivec2 | ivec3), integer
+map_methods.each = function(self) end
+
+--- @class spatial_hash
+--- @operator len: integer
+local spatial_methods = {}
+
+--- Moves the entry if `id` is already present; raises for a non-finite position
+--- @param self spatial_hash
+--- @param id integer non-negative and below 2^31 - 1
+--- @param position vector
+--- @return spatial_hash
+spatial_methods.insert = function(self, id, position) end
+
+--- @param self spatial_hash
+--- @param id integer
+--- @param position vector
+--- @return boolean false if `id` is absent or `position` is not finite
+spatial_methods.move = function(self, id, position) end
+
+--- @param self spatial_hash
+--- @param id integer
+--- @return boolean false if `id` is absent
+spatial_methods.remove = function(self, id) end
+
+--- @param self spatial_hash
+spatial_methods.clear = function(self) end
+
+--- Ids within `radius` of `center`, written into `result` (an exact buffer is allocated if
+--- omitted, and `capacity` is required with it). Returns the buffer, the number of ids written
+--- and the total number of matches.
+--- @param self spatial_hash
+--- @param center vector
+--- @param radius number
+--- @param result? integer[] see vector.id_buffer
+--- @param capacity? integer
+--- @return integer[], integer, integer
+spatial_methods.query_radius = function(self, center, radius, result, capacity) end
+
+--- Ids inside [min, max], see query_radius
+--- @param self spatial_hash
+--- @param min vector
+--- @param max vector
+--- @param result? integer[]
+--- @param capacity? integer
+--- @return integer[], integer, integer
+spatial_methods.query_aabb = function(self, min, max, result, capacity) end
+
+--- Query results in buffers are zero-based positions in the array the tree was built from
+--- @class kd_tree
+--- @operator len: integer
+local kd_methods = {}
+
+--- @param self kd_tree
+--- @param query vector
+--- @return integer? index one-based index of the nearest point, nil for an empty tree
+--- @return number distance
+kd_methods.nearest = function(self, query) end
+
+--- Up to `k` nearest points sorted by distance
+--- @param self kd_tree
+--- @param query vector
+--- @param k integer
+--- @param result? integer[] at least `k` ids, see vector.id_buffer
+--- @param distances? number[] at least `k` doubles
+--- @return integer[] result, integer n, number[] distances
+kd_methods.k_nearest = function(self, query, k, result, distances) end
+
+--- Points within `radius`, see spatial_hash:query_radius
+--- @param self kd_tree
+--- @param query vector
+--- @param radius number
+--- @param result? integer[]
+--- @param capacity? integer
+--- @return integer[], integer, integer
+kd_methods.radius = function(self, query, radius, result, capacity) end
+
+--- Nearest point for every query in one call; -1 where the tree is empty
+--- @param self kd_tree
+--- @param queries vector[] | ffi.cdata*
+--- @param n? integer required for a buffer
+--- @param result? integer[]
+--- @param distances? number[]
+--- @return integer[] result, number[]? distances
+kd_methods.nearest_batch = function(self, queries, n, result, distances) end
+
+--- @class mat2
+--- @field items number[] row-major, zero-based
+--- @operator mul(mat2): mat2
+--- @operator mul(vector): vector
+local mat_methods = {}
+
+--- @class mat3: mat2
+--- @class mat4: mat2
+
+--- @generic T
+--- @param self T
+--- @return T? nil if singular
+mat_methods.inverse = function(self) end
+
+--- @generic T
+--- @param self T
+--- @return T
+mat_methods.transpose = function(self) end
+
+--- result = self * other; result may be self or other
+--- @generic T
+--- @param self T
+--- @param other T
+--- @param result T
+--- @return T
+mat_methods.mul_into = function(self, other, result) end
+
+--- @param self mat2
+--- @param v vector
+--- @param result vector may be v
+--- @return vector? nil on a length mismatch
+mat_methods.transform_into = function(self, v, result) end
+
+--- Transforms a whole sequence or buffer of vectors in one call
+--- @param self mat2
+--- @param points vector[] | ffi.cdata*
+--- @param n? integer required for a buffer
+--- @param result? ffi.cdata* vector.buffer(n), may be `points`
+--- @return ffi.cdata*
+mat_methods.transform_points = function(self, points, n, result) end
+
+--- @param self mat2
+--- @param source vector_array
+--- @param result? vector_array same shape as source, may be source
+--- @return vector_array
+mat_methods.transform_array = function(self, source, result) end
+
+--- @class vector_expression
+--- @operator add(vector | vector_expression): vector_expression
+--- @operator sub(vector | vector_expression): vector_expression
+--- @operator mul(number): vector_expression
+--- @operator div(number): vector_expression
+--- @operator unm(): vector_expression
+local expression_methods = {}
+
+--- Evaluates and discards the expression
+--- @param self vector_expression
+--- @param result? vector may be one of the operands
+--- @return vector
+expression_methods.eval = function(self, result) end
+
+--- Cells are addressed by zero-based vectors {x; y}, cell (x, y) being costs[y * width + x].
+--- Diagonal moves cost sqrt(2) times the cell cost and never cut blocked corners.
+--- @class pathfinder
+local pathfinder_methods = {}
+
+--- Cheapest path as unit steps from start to goal. Costs below 1 keep paths valid, but not
+--- necessarily optimal.
+--- @param self pathfinder
+--- @param costs number[] see vector.cost_grid
+--- @param start vector
+--- @param goal vector
+--- @param diagonal? boolean 8-connected if true, 4-connected by default
+--- @param result? vector[] see vector.buffer; without it an exact buffer is allocated
+--- @param capacity? integer
+--- @return vector[]? steps nil if the goal is unreachable
+--- @return integer written
+--- @return integer total
+pathfinder_methods.astar = function(self, costs, start, goal, diagonal, result, capacity) end
+
+--- Multi-source Dijkstra map: cost of reaching every cell from the nearest source, math.huge
+--- where unreachable
+--- @param self pathfinder
+--- @param costs number[]
+--- @param sources vector[]
+--- @param diagonal? boolean
+--- @param distances? number[] double[width * height]
+--- @return number[]
+pathfinder_methods.dijkstra = function(self, costs, sources, diagonal, distances) end
+
+--- Downhill step over a Dijkstra map: zero-based index into vector.extended_directions for each
+--- cell, -1 at sources and unreachable cells
+--- @param self pathfinder
+--- @param costs number[]
+--- @param distances number[] result of pathfinder:dijkstra
+--- @param diagonal? boolean
+--- @param directions? integer[] int8_t[width * height]
+--- @return integer[]
+pathfinder_methods.flow_field = function(self, costs, distances, diagonal, directions) end
+
+--- @class vector_snapshot
+--- @field version integer
+--- @field dim integer
+--- @field precision 4 | 8
+--- @field count integer
+--- @operator len: integer
+local snapshot_methods = {}
+
+--- Zero-based vector* (precision 8) or vectorf* (precision 4) into the mapped file; writes stay in
+--- memory. Valid only while the snapshot is alive and not closed. The first call checks every
+--- record and errors if one is corrupt.
+--- @param self vector_snapshot
+--- @return vector[] | vectorf[]
+snapshot_methods.vectors = function(self) end
+
+--- Copies one vector out, checking only its record; errors if i is out of range or the record is
+--- corrupt
+--- @param self vector_snapshot
+--- @param i integer one-based
+--- @param result? vector
+--- @return vector
+snapshot_methods.get = function(self, i, result) end
+
+--- Unmaps the file right away instead of on garbage collection
+--- @param self vector_snapshot
+snapshot_methods.close = function(self) end
+
+--- @class vector_snapshot_writer
+local writer_methods = {}
+
+--- Appends vectors; a batch with a different length errors and is skipped
+--- @param self vector_snapshot_writer
+--- @param points vector | vector[] | ffi.cdata*
+--- @param n? integer required for a buffer
+--- @return vector_snapshot_writer
+writer_methods.write = function(self, points, n) end
+
+--- Completes the file; until then it does not load
+--- @param self vector_snapshot_writer
+writer_methods.close = function(self) end
+
+--- Box indices are zero-based positions in the arrays of the latest update
+--- @class sweep_prune
+--- @operator len: integer
+local sweep_methods = {}
+
+--- Replaces the boxes; keeping their order between frames makes the update close to linear
+--- @param self sweep_prune
+--- @param mins vector[] | ffi.cdata*
+--- @param maxs vector[] | ffi.cdata*
+--- @param n? integer required for buffers
+--- @return sweep_prune
+sweep_methods.update = function(self, mins, maxs, n) end
+
+--- Overlapping pairs, touching included; pair k is result[2k] < result[2k + 1]
+--- @param self sweep_prune
+--- @param result? integer[] 2 * capacity ids, see vector.id_buffer
+--- @param capacity? integer in pairs
+--- @return integer[] result, integer n pairs written, integer total pairs
+sweep_methods.pairs = function(self, result, capacity) end
+
+--- Targets stay referenced by the engine until their tweens finish or are cancelled
+--- @class tween_engine
+--- @operator len: integer
+local tween_methods = {}
+
+--- Tweens `target` to `to` over `duration` seconds, from `from` or its current value
+--- @param self tween_engine
+--- @param target vector written in place on every update
+--- @param to vector
+--- @param duration number
+--- @param easing? easing | integer linear by default
+--- @param from? vector
+--- @return integer id
+tween_methods.add = function(self, target, to, duration, easing, from) end
+
+--- Stops a tween, leaving its target as it is
+--- @param self tween_engine
+--- @param id integer
+--- @return boolean false if the tween has already finished
+tween_methods.cancel = function(self, id) end
+
+--- Stops every tween of `target`
+--- @param self tween_engine
+--- @param target vector
+--- @return integer cancelled
+tween_methods.cancel_target = function(self, target) end
+
+--- @param self tween_engine
+tween_methods.clear = function(self) end
+
+--- Advances all tweens; finished ones leave their targets exactly at `to`
+--- @param self tween_engine
+--- @param dt number
+--- @return integer finished
+tween_methods.update = function(self, dt) end
+
+--- Samplers fill a zero-based buffer of `n` vectors, allocating it unless `result` is given
+--- @class vector_rng
+local rng_methods = {}
+
+--- Restarts the stream as if it was just created
+--- @param self vector_rng
+--- @param seed? integer
+--- @param stream? integer
+--- @return vector_rng self
+rng_methods.seed = function(self, seed, stream) end
+
+--- @param self vector_rng
+--- @param lo? number
+--- @param hi? number
+--- @return number in [0, 1), or in [lo, hi) if both are given
+rng_methods.uniform = function(self, lo, hi) end
+
+--- Uniform in the box [min, max) componentwise
+--- @param self vector_rng
+--- @param min vector
+--- @param max vector of the length of min
+--- @param n integer
+--- @param result? vector[] see vector.buffer
+--- @return vector[]
+rng_methods.box = function(self, min, max, n, result) end
+
+--- 2D points uniform in the unit disk
+--- @param self vector_rng
+--- @param n integer
+--- @param result? vector[]
+--- @return vector[]
+rng_methods.disk = function(self, n, result) end
+
+--- 3D points uniform in the unit ball
+--- @param self vector_rng
+--- @param n integer
+--- @param result? vector[]
+--- @return vector[]
+rng_methods.sphere = function(self, n, result) end
+
+--- Unit vectors uniform in direction
+--- @param self vector_rng
+--- @param dim integer 2 to 4
+--- @param n integer
+--- @param result? vector[]
+--- @return vector[]
+rng_methods.direction = function(self, dim, n, result) end
+
+--- Normally distributed around `mean`
+--- @param self vector_rng
+--- @param mean vector
+--- @param stddev vector | number componentwise standard deviation
+--- @param n integer
+--- @param result? vector[]
+--- @return vector[]
+rng_methods.gaussian = function(self, mean, stddev, n, result) end
+
 return vector
@@ -0,0 +1,184 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vector.h"
+
+// The `{1; 2; 3}` text form of vector.mt.__tostring. Numbers are written like LuaJIT's tostring
+// ("%.14g"), so C and Lua output match byte for byte.
+
+// Longest "%.14g" output is 21 chars, e.g. -1.2345678901234e-308
+#define FORMAT_NUMBER_MAX 24
+
+// Writes n / 10^decimals in fixed notation without trailing zeros
+static int format_fixed(int64_t n, int decimals, char *out) {
+    while (decimals > 0 && n % 10 == 0) {
+        n /= 10;
+        decimals--;
+    }
+
+    char digits[FORMAT_NUMBER_MAX];
+    uint64_t u = n < 0 ? -(uint64_t)n : (uint64_t)n;
+    int len = 0;
+    do {
+        digits[len++] = '0' + u % 10;
+        u /= 10;
+    } while (u > 0 || len <= decimals);
+
+    int i = 0;
+    if (n < 0) out[i++] = '-';
+    while (len > 0) {
+        if (len == decimals) out[i++] = '.';
+        out[i++] = digits[--len];
+    }
+    return i;
+}
+
+static int format_number(double x, char *out) {
+    // %.14g prints values with at most 14 significant digits and 4 decimals, which is most game
+    // data, in plain fixed notation. When x * 10^k rounds to an integer it is within an ulp of it,
+    // far from any 14-digit rounding boundary, though a lower k may have just missed, hence the
+    // trailing zero stripping. -0 keeps its sign, so it goes to snprintf.
+    static const double scales[] = {1, 10, 100, 1000, 10000};
+    if (x != 0 || !signbit(x)) {
+        for (int k = 0; k <= 4; k++) {
+            double y = x * scales[k];
+            if (!(fabs(y) < 1e14)) break;
+            if (y == floor(y)) return format_fixed((int64_t)y, k, out);
+        }
+    }
+    if (isnan(x)) {
+        memcpy(out, "nan", 3);
+        return 3;
+    }
+    return snprintf(out, FORMAT_NUMBER_MAX, "%.14g", x);
+}
+
+// Appends `text` at *offset if it fits below capacity; the offset advances either way
+static inline void format_put(char *buffer, int64_t capacity, int64_t *offset, const char *text, int64_t len) {
+    if (*offset + len <= capacity) memcpy(buffer + *offset, text, len);
+    *offset += len;
+}
+
+static void format_vector(const vector *self, char *buffer, int64_t capacity, int64_t *offset) {
+    format_put(buffer, capacity, offset, "{", 1);
+    for (int i = 0; i < self->len; i++) {
+        char number[FORMAT_NUMBER_MAX];
+        if (i > 0) format_put(buffer, capacity, offset, "; ", 2);
+        format_put(buffer, capacity, offset, number, format_number(self->items[i], number));
+    }
+    format_put(buffer, capacity, offset, "}", 1);
+}
+
+// snprintf-style: returns the length of the text without the terminating NUL and writes it only if
+// it fits into `capacity` bytes with the NUL
+EXPORT int32_t vector_format(const vector *self, char *buffer, int32_t capacity) {
+    int64_t len = 0;
+    format_vector(self, buffer, capacity - 1, &len);
+    if (len < capacity) buffer[len] = '\0';
+    return (int32_t)len;
+}
+
+// `len` vectors joined by `separator` (NULL for "\n"), see vector_format
+EXPORT int64_t vector_format_batch(
+    const vector *items, int64_t len, const char *separator, char *buffer, int64_t capacity
+) {
+    if (separator == NULL) separator = "\n";
+    int64_t separator_len = strlen(separator);
+
+    int64_t offset = 0;
+    for (int64_t i = 0; i < len; i++) {
+        if (i > 0) format_put(buffer, capacity - 1, &offset, separator, separator_len);
+        format_vector(&items[i], buffer, capacity - 1, &offset);
+    }
+    if (offset < capacity) buffer[offset] = '\0';
+    return offset;
+}
+
+static inline bool parse_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static inline bool parse_number_char(char c) {
+    return (c >= '0' && c <= '9') || c == '.' || c == '-' || c == '+' || c == 'e' || c == 'E'
+        || c == 'i' || c == 'n' || c == 'f' || c == 'a' || c == 'I' || c == 'N' || c == 'F' || c == 'A';
+}
+
+typedef enum {
+    PARSE_OK,
+    PARSE_MALFORMED,
+    PARSE_INCOMPLETE,
+} parse_status;
+
+// Parses one vector starting at the '{' at text[*i]; on success *i points past the '}'
+static parse_status parse_vector(const char *text, int64_t len, int64_t *i, vector *result) {
+    int64_t p = *i + 1;
+    vector v = {.len = 0};
+
+    while (p < len && parse_space(text[p])) p++;
+    if (p < len && text[p] == '}') {
+        *result = v;
+        *i = p + 1;
+        return PARSE_OK;
+    }
+
+    while (true) {
+        // Bounded copy, since the text is not NUL-terminated
+        char number[FORMAT_NUMBER_MAX + 8];
+        int n = 0;
+        while (p < len && parse_number_char(text[p])) {
+            if (n == (int)sizeof(number) - 1) return PARSE_MALFORMED;
+            number[n++] = text[p++];
+        }
+        if (p == len) return PARSE_INCOMPLETE;
+        number[n] = '\0';
+
+        char *end;
+        double x = strtod(number, &end);
+        if (n == 0 || end != number + n || v.len == MAX_LEN) return PARSE_MALFORMED;
+        v.items[v.len++] = x;
+
+        while (p < len && parse_space(text[p])) p++;
+        if (p == len) return PARSE_INCOMPLETE;
+        if (text[p] == '}') break;
+        if (text[p] != ';') return PARSE_MALFORMED;
+        p++;
+        while (p < len && parse_space(text[p])) p++;
+    }
+
+    *result = v;
+    *i = p + 1;
+    return PARSE_OK;
+}
+
+// Reads vectors in the `{1; 2; 3}` form from text[0, len), skipping any other text between
+// them and malformed vectors. Stops after `capacity` vectors or at a vector cut off by the end of
+// the text; *consumed (unless NULL) is where the next call should resume. With a NULL result
+// only counts, ignoring capacity. Returns the number of vectors read.
+EXPORT int64_t vector_parse(const char *text, int64_t len, vector *result, int64_t capacity, int64_t *consumed) {
+    int64_t found = 0;
+    int64_t i = 0;
+    while (i < len && (result == NULL || found < capacity)) {
+        if (text[i] != '{') {
+            i++;
+            continue;
+        }
+
+        int64_t start = i;
+        vector v;
+        parse_status status = parse_vector(text, len, &i, &v);
+        if (status == PARSE_INCOMPLETE) {
+            i = start;
+            break;
+        }
+        if (status == PARSE_MALFORMED) {
+            i = start + 1;
+            continue;
+        }
+        if (result != NULL) result[found] = v;
+        found++;
+    }
+    if (consumed != NULL) *consumed = i;
+    return found;
+}
@@ -0,0 +1,237 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vector.h"
+
+// Integer grid vectors and an open-addressing hash map keyed by them by value. The map stores
+// keys as int32_t[dim] (ivec2/ivec3 items) and int64_t payloads, which also fit pointers.
+
+static inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+static inline uint64_t ivec_hash(const int32_t *key, int dim) {
+    uint64_t h = mix64(((uint64_t)(uint32_t)key[0] << 32) | (uint32_t)key[1]);
+    if (dim == 3) h = mix64(h ^ (uint32_t)key[2]);
+    return h;
+}
+
+EXPORT uint32_t ivec2_hash(const ivec2 *self) {
+    return ivec_hash(self->items, 2) >> 32;
+}
+
+EXPORT uint32_t ivec3_hash(const ivec3 *self) {
+    return ivec_hash(self->items, 3) >> 32;
+}
+
+EXPORT bool ivec2_eq(const ivec2 *self, const ivec2 *other) {
+    return self->items[0] == other->items[0] && self->items[1] == other->items[1];
+}
+
+EXPORT bool ivec3_eq(const ivec3 *self, const ivec3 *other) {
+    return self->items[0] == other->items[0]
+        && self->items[1] == other->items[1]
+        && self->items[2] == other->items[2];
+}
+
+EXPORT ivec2 *ivec2_add_mut(ivec2 *self, const ivec2 *other) {
+    self->items[0] += other->items[0];
+    self->items[1] += other->items[1];
+    return self;
+}
+
+EXPORT ivec3 *ivec3_add_mut(ivec3 *self, const ivec3 *other) {
+    self->items[0] += other->items[0];
+    self->items[1] += other->items[1];
+    self->items[2] += other->items[2];
+    return self;
+}
+
+EXPORT ivec2 *ivec2_sub_mut(ivec2 *self, const ivec2 *other) {
+    self->items[0] -= other->items[0];
+    self->items[1] -= other->items[1];
+    return self;
+}
+
+EXPORT ivec3 *ivec3_sub_mut(ivec3 *self, const ivec3 *other) {
+    self->items[0] -= other->items[0];
+    self->items[1] -= other->items[1];
+    self->items[2] -= other->items[2];
+    return self;
+}
+
+// Floors the coordinates, so every point of a tile maps to the same key; NULL if len differs
+EXPORT ivec2 *ivec2_from_vector(const vector *source, ivec2 *result) {
+    if (source->len != 2) return NULL;
+    result->items[0] = (int32_t)floor(source->items[0]);
+    result->items[1] = (int32_t)floor(source->items[1]);
+    return result;
+}
+
+EXPORT ivec3 *ivec3_from_vector(const vector *source, ivec3 *result) {
+    if (source->len != 3) return NULL;
+    result->items[0] = (int32_t)floor(source->items[0]);
+    result->items[1] = (int32_t)floor(source->items[1]);
+    result->items[2] = (int32_t)floor(source->items[2]);
+    return result;
+}
+
+typedef struct {
+    int32_t key[3];
+    bool used;
+    int64_t value;
+} ivec_map_slot;
+
+struct ivec_map {
+    int dim;
+    size_t count;
+    size_t capacity;
+    ivec_map_slot *slots;
+};
+
+#define IVEC_MAP_MIN_CAPACITY 16
+// Largest slot count that can still double without overflowing the allocation size
+#define IVEC_MAP_MAX_CAPACITY (SIZE_MAX / 2 / sizeof(ivec_map_slot))
+
+// NULL for bad dimensions and for capacities beyond what the table can address
+EXPORT ivec_map *ivec_map_new(int dim, size_t capacity) {
+    if (dim != 2 && dim != 3) return NULL;
+
+    size_t slots_n = IVEC_MAP_MIN_CAPACITY;
+    while (slots_n / 2 < capacity) {
+        if (slots_n > IVEC_MAP_MAX_CAPACITY) return NULL;
+        slots_n *= 2;
+    }
+
+    ivec_map *self = malloc(sizeof(ivec_map));
+    if (self == NULL) return NULL;
+    self->slots = calloc(slots_n, sizeof(ivec_map_slot));
+    if (self->slots == NULL) {
+        free(self);
+        return NULL;
+    }
+
+    self->dim = dim;
+    self->count = 0;
+    self->capacity = slots_n;
+    return self;
+}
+
+EXPORT void ivec_map_free(ivec_map *self) {
+    if (self == NULL) return;
+    free(self->slots);
+    free(self);
+}
+
+EXPORT int ivec_map_dim(const ivec_map *self) {
+    return self->dim;
+}
+
+EXPORT size_t ivec_map_count(const ivec_map *self) {
+    return self->count;
+}
+
+EXPORT void ivec_map_clear(ivec_map *self) {
+    memset(self->slots, 0, self->capacity * sizeof(ivec_map_slot));
+    self->count = 0;
+}
+
+static inline bool ivec_map_key_eq(const ivec_map_slot *slot, const int32_t *key, int dim) {
+    return slot->key[0] == key[0] && slot->key[1] == key[1] && (dim == 2 || slot->key[2] == key[2]);
+}
+
+// Index of the slot holding `key`, or of the empty slot where it would be inserted
+static size_t ivec_map_find(const ivec_map *self, const int32_t *key) {
+    size_t mask = self->capacity - 1;
+    size_t i = ivec_hash(key, self->dim) & mask;
+    while (self->slots[i].used && !ivec_map_key_eq(&self->slots[i], key, self->dim)) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static bool ivec_map_grow(ivec_map *self) {
+    ivec_map_slot *old_slots = self->slots;
+    size_t old_capacity = self->capacity;
+    if (old_capacity > IVEC_MAP_MAX_CAPACITY) return false;
+
+    ivec_map_slot *slots = calloc(old_capacity * 2, sizeof(ivec_map_slot));
+    if (slots == NULL) return false;
+
+    self->slots = slots;
+    self->capacity = old_capacity * 2;
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_slots[i].used) {
+            self->slots[ivec_map_find(self, old_slots[i].key)] = old_slots[i];
+        }
+    }
+    free(old_slots);
+    return true;
+}
+
+// Inserts or overwrites; false only if growing the table failed
+EXPORT bool ivec_map_set(ivec_map *self, const int32_t *key, int64_t value) {
+    if ((self->count + 1) * 4 > self->capacity * 3 && !ivec_map_grow(self)) return false;
+
+    ivec_map_slot *slot = &self->slots[ivec_map_find(self, key)];
+    if (!slot->used) {
+        slot->used = true;
+        slot->key[0] = key[0];
+        slot->key[1] = key[1];
+        slot->key[2] = self->dim == 3 ? key[2] : 0;
+        self->count++;
+    }
+    slot->value = value;
+    return true;
+}
+
+// Writes the payload into `value` unless it is NULL; false if the key is absent
+EXPORT bool ivec_map_get(const ivec_map *self, const int32_t *key, int64_t *value) {
+    const ivec_map_slot *slot = &self->slots[ivec_map_find(self, key)];
+    if (!slot->used) return false;
+    if (value != NULL) *value = slot->value;
+    return true;
+}
+
+// Backward-shift deletion keeps probe sequences intact without tombstones
+EXPORT bool ivec_map_remove(ivec_map *self, const int32_t *key) {
+    size_t mask = self->capacity - 1;
+    size_t i = ivec_map_find(self, key);
+    if (!self->slots[i].used) return false;
+
+    size_t j = i;
+    while (true) {
+        j = (j + 1) & mask;
+        if (!self->slots[j].used) break;
+        size_t home = ivec_hash(self->slots[j].key, self->dim) & mask;
+        // Move slot j into the hole at i unless its home lies cyclically in (i, j]
+        bool stays = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+        if (!stays) {
+            self->slots[i] = self->slots[j];
+            i = j;
+        }
+    }
+    self->slots[i].used = false;
+    self->count--;
+    return true;
+}
+
+// Iterates entries: start with *cursor = 0, call until it returns false
+EXPORT bool ivec_map_next(const ivec_map *self, size_t *cursor, int32_t *key, int64_t *value) {
+    for (size_t i = *cursor; i < self->capacity; i++) {
+        if (self->slots[i].used) {
+            memcpy(key, self->slots[i].key, sizeof(int32_t) * self->dim);
+            *value = self->slots[i].value;
+            *cursor = i + 1;
+            return true;
+        }
+    }
+    *cursor = self->capacity;
+    return false;
+}
@@ -0,0 +1,299 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vector.h"
+
+// Static, bulk-built k-d tree over 2 to 4 dimensional points. The tree is implicit: points are
+// reordered so that the median of every range [lo, hi) sits at its middle and splits it along
+// split[mid], which is the axis of largest spread in that range. Indices reported by queries
+// are positions in the array passed to kd_tree_new.
+
+typedef struct {
+    int dim;
+    int32_t len;
+    double *coords;
+    int32_t *indices;
+    uint8_t *split;
+} kd_tree;
+
+static inline double *kd_point(const kd_tree *self, int32_t i) {
+    return self->coords + (size_t)i * self->dim;
+}
+
+static void kd_swap(kd_tree *self, int32_t a, int32_t b) {
+    double tmp[MAX_LEN];
+    size_t size = sizeof(double) * self->dim;
+    memcpy(tmp, kd_point(self, a), size);
+    memcpy(kd_point(self, a), kd_point(self, b), size);
+    memcpy(kd_point(self, b), tmp, size);
+
+    int32_t index = self->indices[a];
+    self->indices[a] = self->indices[b];
+    self->indices[b] = index;
+}
+
+// Quickselect: places the k-th smallest point along `axis` at k within [lo, hi). Three-way
+// partitioning keeps grid-aligned inputs with many equal coordinates linear.
+static void kd_select(kd_tree *self, int32_t lo, int32_t hi, int32_t k, int axis) {
+    while (hi - lo > 1) {
+        double pivot = kd_point(self, lo + (hi - lo) / 2)[axis];
+
+        int32_t less = lo, i = lo, greater = hi;
+        while (i < greater) {
+            double x = kd_point(self, i)[axis];
+            if (x < pivot) {
+                kd_swap(self, i++, less++);
+            } else if (x > pivot) {
+                kd_swap(self, i, --greater);
+            } else {
+                i++;
+            }
+        }
+
+        if (k < less) {
+            hi = less;
+        } else if (k >= greater) {
+            lo = greater;
+        } else {
+            return;
+        }
+    }
+}
+
+static void kd_build(kd_tree *self, int32_t lo, int32_t hi) {
+    while (hi - lo > 1) {
+        double min[MAX_LEN], max[MAX_LEN];
+        memcpy(min, kd_point(self, lo), sizeof(double) * self->dim);
+        memcpy(max, min, sizeof(double) * self->dim);
+        for (int32_t i = lo + 1; i < hi; i++) {
+            const double *p = kd_point(self, i);
+            for (int c = 0; c < self->dim; c++) {
+                if (p[c] < min[c]) min[c] = p[c];
+                if (p[c] > max[c]) max[c] = p[c];
+            }
+        }
+
+        int axis = 0;
+        for (int c = 1; c < self->dim; c++) {
+            if (max[c] - min[c] > max[axis] - min[axis]) axis = c;
+        }
+
+        int32_t middle = lo + (hi - lo) / 2;
+        kd_select(self, lo, hi, middle, axis);
+        self->split[middle] = axis;
+
+        kd_build(self, lo, middle);
+        lo = middle + 1;
+    }
+}
+
+EXPORT void kd_tree_free(kd_tree *self) {
+    if (self == NULL) return;
+    free(self->coords);
+    free(self->indices);
+    free(self->split);
+    free(self);
+}
+
+// All points must have the same len between 2 and MAX_LEN; NULL otherwise
+EXPORT kd_tree *kd_tree_new(const vector *points, int32_t len) {
+    if (len < 0) return NULL;
+    int dim = len > 0 ? points[0].len : 2;
+    if (dim < 2 || dim > MAX_LEN) return NULL;
+    for (int32_t i = 0; i < len; i++) {
+        if (points[i].len != dim) return NULL;
+    }
+
+    kd_tree *self = calloc(1, sizeof(kd_tree));
+    if (self == NULL) return NULL;
+    self->dim = dim;
+    self->len = len;
+    self->coords = malloc(sizeof(double) * dim * (len > 0 ? len : 1));
+    self->indices = malloc(sizeof(int32_t) * (len > 0 ? len : 1));
+    self->split = calloc(len > 0 ? len : 1, 1);
+    if (self->coords == NULL || self->indices == NULL || self->split == NULL) {
+        kd_tree_free(self);
+        return NULL;
+    }
+
+    for (int32_t i = 0; i < len; i++) {
+        memcpy(kd_point(self, i), points[i].items, sizeof(double) * dim);
+        self->indices[i] = i;
+    }
+    kd_build(self, 0, len);
+    return self;
+}
+
+EXPORT int32_t kd_tree_len(const kd_tree *self) {
+    return self->len;
+}
+
+static inline double kd_distance2(const kd_tree *self, int32_t i, const double *query) {
+    const double *p = kd_point(self, i);
+    double result = 0;
+    for (int c = 0; c < self->dim; c++) {
+        double d = p[c] - query[c];
+        result += d * d;
+    }
+    return result;
+}
+
+// Bounded max-heap of the best candidates; with capacity 1 it is the plain nearest search
+typedef struct {
+    int32_t capacity;
+    int32_t len;
+    double *distances2;
+    int32_t *slots;
+} kd_heap;
+
+// Places (distance2, slot) into the hole at the root, moving larger children up
+static void kd_heap_sift_down(kd_heap *heap, double distance2, int32_t slot) {
+    int32_t i = 0;
+    while (true) {
+        int32_t child = 2 * i + 1;
+        if (child >= heap->len) break;
+        if (child + 1 < heap->len && heap->distances2[child + 1] > heap->distances2[child]) child++;
+        if (heap->distances2[child] <= distance2) break;
+        heap->distances2[i] = heap->distances2[child];
+        heap->slots[i] = heap->slots[child];
+        i = child;
+    }
+    heap->distances2[i] = distance2;
+    heap->slots[i] = slot;
+}
+
+static void kd_heap_push(kd_heap *heap, double distance2, int32_t slot) {
+    if (heap->len == heap->capacity) {
+        if (distance2 < heap->distances2[0]) kd_heap_sift_down(heap, distance2, slot);
+        return;
+    }
+
+    int32_t i = heap->len++;
+    while (i > 0 && heap->distances2[(i - 1) / 2] < distance2) {
+        heap->distances2[i] = heap->distances2[(i - 1) / 2];
+        heap->slots[i] = heap->slots[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap->distances2[i] = distance2;
+    heap->slots[i] = slot;
+}
+
+static void kd_heap_pop(kd_heap *heap) {
+    heap->len--;
+    if (heap->len > 0) {
+        kd_heap_sift_down(heap, heap->distances2[heap->len], heap->slots[heap->len]);
+    }
+}
+
+static inline double kd_heap_bound(const kd_heap *heap) {
+    return heap->len < heap->capacity ? INFINITY : heap->distances2[0];
+}
+
+static void kd_search(const kd_tree *self, int32_t lo, int32_t hi, const double *query, kd_heap *heap) {
+    while (lo < hi) {
+        int32_t middle = lo + (hi - lo) / 2;
+        kd_heap_push(heap, kd_distance2(self, middle, query), middle);
+        if (hi - lo == 1) return;
+
+        int axis = self->split[middle];
+        double diff = query[axis] - kd_point(self, middle)[axis];
+        int32_t near_lo = diff < 0 ? lo : middle + 1;
+        int32_t near_hi = diff < 0 ? middle : hi;
+        int32_t far_lo = diff < 0 ? middle + 1 : lo;
+        int32_t far_hi = diff < 0 ? hi : middle;
+
+        kd_search(self, near_lo, near_hi, query, heap);
+        if (diff * diff >= kd_heap_bound(heap)) return;
+        lo = far_lo;
+        hi = far_hi;
+    }
+}
+
+// Writes up to k nearest indices sorted by distance (and their distances unless NULL);
+// returns how many were written, min(k, len)
+EXPORT int32_t kd_tree_k_nearest(
+    const kd_tree *self, const vector *query, int32_t k, int32_t *result, double *distances
+) {
+    if (query->len != self->dim || k <= 0 || self->len == 0) return 0;
+    if (k > self->len) k = self->len;
+
+    double *distances2 = malloc(sizeof(double) * k);
+    int32_t *slots = malloc(sizeof(int32_t) * k);
+    if (distances2 == NULL || slots == NULL) {
+        free(distances2);
+        free(slots);
+        return 0;
+    }
+
+    kd_heap heap = {.capacity = k, .len = 0, .distances2 = distances2, .slots = slots};
+    kd_search(self, 0, self->len, query->items, &heap);
+
+    // Popping the max-heap yields the farthest first, so fill the result from the back
+    for (int32_t i = heap.len - 1; i >= 0; i--) {
+        result[i] = self->indices[heap.slots[0]];
+        if (distances != NULL) distances[i] = sqrt(heap.distances2[0]);
+        kd_heap_pop(&heap);
+    }
+
+    free(distances2);
+    free(slots);
+    return k;
+}
+
+// Index of the nearest point, -1 for an empty tree or dimension mismatch
+EXPORT int32_t kd_tree_nearest(const kd_tree *self, const vector *query, double *distance) {
+    if (query->len != self->dim || self->len == 0) return -1;
+
+    double distance2;
+    int32_t slot;
+    kd_heap heap = {.capacity = 1, .len = 0, .distances2 = &distance2, .slots = &slot};
+    kd_search(self, 0, self->len, query->items, &heap);
+
+    if (distance != NULL) *distance = sqrt(distance2);
+    return self->indices[slot];
+}
+
+// Answers `len` nearest queries in one call; distances may be NULL
+EXPORT void kd_tree_nearest_batch(
+    const kd_tree *self, const vector *queries, int32_t len, int32_t *result, double *distances
+) {
+    for (int32_t i = 0; i < len; i++) {
+        result[i] = kd_tree_nearest(self, &queries[i], distances != NULL ? &distances[i] : NULL);
+    }
+}
+
+static int32_t kd_radius(
+    const kd_tree *self, int32_t lo, int32_t hi, const double *query, double radius2,
+    int32_t *result, int32_t capacity, int32_t found
+) {
+    while (lo < hi) {
+        int32_t middle = lo + (hi - lo) / 2;
+        if (kd_distance2(self, middle, query) <= radius2) {
+            if (found < capacity) result[found] = self->indices[middle];
+            found++;
+        }
+        if (hi - lo == 1) return found;
+
+        int axis = self->split[middle];
+        double diff = query[axis] - kd_point(self, middle)[axis];
+        if (diff <= 0 || diff * diff <= radius2) {
+            found = kd_radius(self, lo, middle, query, radius2, result, capacity, found);
+        }
+        if (diff >= 0 || diff * diff <= radius2) {
+            lo = middle + 1;
+        } else {
+            return found;
+        }
+    }
+    return found;
+}
+
+// Indices within `radius` (inclusive) in no particular order; returns the total count, which may
+// exceed capacity
+EXPORT int32_t kd_tree_radius(
+    const kd_tree *self, const vector *query, double radius, int32_t *result, int32_t capacity
+) {
+    if (query->len != self->dim || !(radius >= 0)) return 0;
+    return kd_radius(self, 0, self->len, query->items, radius * radius, result, capacity, 0);
+}
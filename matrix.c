@@ -0,0 +1,243 @@
+#include <math.h>
+#include <string.h>
+
+#include "vector.h"
+
+// mat2, mat3 and mat4 share size-generic kernels on row-major double arrays. Vectors one
+// component shorter than the matrix are treated as points in homogeneous coordinates (w = 1),
+// so mat3 transforms 2D positions affinely and mat4 transforms 3D positions with perspective
+// divide.
+
+static void mat_identity(double *result, int n) {
+    memset(result, 0, sizeof(double) * n * n);
+    for (int i = 0; i < n; i++) {
+        result[i * n + i] = 1;
+    }
+}
+
+// result may alias a or b
+static void mat_mul(const double *a, const double *b, double *result, int n) {
+    double tmp[16];
+    for (int row = 0; row < n; row++) {
+        for (int col = 0; col < n; col++) {
+            double sum = 0;
+            for (int k = 0; k < n; k++) {
+                sum += a[row * n + k] * b[k * n + col];
+            }
+            tmp[row * n + col] = sum;
+        }
+    }
+    memcpy(result, tmp, sizeof(double) * n * n);
+}
+
+// Gauss-Jordan elimination with partial pivoting; false if the matrix is singular
+static bool mat_inverse(const double *a, double *result, int n) {
+    double m[16], inv[16];
+    memcpy(m, a, sizeof(double) * n * n);
+    mat_identity(inv, n);
+
+    for (int col = 0; col < n; col++) {
+        int pivot = col;
+        for (int row = col + 1; row < n; row++) {
+            if (fabs(m[row * n + col]) > fabs(m[pivot * n + col])) pivot = row;
+        }
+        if (m[pivot * n + col] == 0) return false;
+
+        if (pivot != col) {
+            for (int k = 0; k < n; k++) {
+                double t = m[col * n + k];
+                m[col * n + k] = m[pivot * n + k];
+                m[pivot * n + k] = t;
+                t = inv[col * n + k];
+                inv[col * n + k] = inv[pivot * n + k];
+                inv[pivot * n + k] = t;
+            }
+        }
+
+        double scale = 1 / m[col * n + col];
+        for (int k = 0; k < n; k++) {
+            m[col * n + k] *= scale;
+            inv[col * n + k] *= scale;
+        }
+
+        for (int row = 0; row < n; row++) {
+            if (row == col) continue;
+            double factor = m[row * n + col];
+            if (factor == 0) continue;
+            for (int k = 0; k < n; k++) {
+                m[row * n + k] -= factor * m[col * n + k];
+                inv[row * n + k] -= factor * inv[col * n + k];
+            }
+        }
+    }
+
+    memcpy(result, inv, sizeof(double) * n * n);
+    return true;
+}
+
+// Transforms `in` of length n (full) or n - 1 (point); result may alias in
+static bool mat_transform(const double *m, int n, const double *in, int len, double *result) {
+    if (len != n && len != n - 1) return false;
+
+    double tmp[MAX_LEN];
+    for (int row = 0; row < len; row++) {
+        double sum = len == n ? 0 : m[row * n + n - 1];
+        for (int k = 0; k < len; k++) {
+            sum += m[row * n + k] * in[k];
+        }
+        tmp[row] = sum;
+    }
+
+    if (len == n - 1 && n == 4) {
+        double w = m[3 * 4 + 3];
+        for (int k = 0; k < 3; k++) {
+            w += m[3 * 4 + k] * in[k];
+        }
+        if (w != 1 && w != 0) {
+            for (int k = 0; k < 3; k++) tmp[k] /= w;
+        }
+    }
+
+    memcpy(result, tmp, sizeof(double) * len);
+    return true;
+}
+
+#define MAT_DEFINE(N) \
+    EXPORT mat##N *mat##N##_identity(mat##N *result) { \
+        mat_identity(result->items, N); \
+        return result; \
+    } \
+    \
+    EXPORT mat##N *mat##N##_mul(const mat##N *self, const mat##N *other, mat##N *result) { \
+        mat_mul(self->items, other->items, result->items, N); \
+        return result; \
+    } \
+    \
+    EXPORT mat##N *mat##N##_inverse(const mat##N *self, mat##N *result) { \
+        return mat_inverse(self->items, result->items, N) ? result : NULL; \
+    } \
+    \
+    EXPORT mat##N *mat##N##_transpose(const mat##N *self, mat##N *result) { \
+        mat##N tmp; \
+        for (int row = 0; row < N; row++) { \
+            for (int col = 0; col < N; col++) { \
+                tmp.items[col * N + row] = self->items[row * N + col]; \
+            } \
+        } \
+        *result = tmp; \
+        return result; \
+    } \
+    \
+    EXPORT vector *mat##N##_transform(const mat##N *self, const vector *v, vector *result) { \
+        if (!mat_transform(self->items, N, v->items, v->len, result->items)) return NULL; \
+        result->len = v->len; \
+        return result; \
+    } \
+    \
+    /* Transforms `len` vectors at once; result may alias points. Returns false on a length */ \
+    /* mismatch, leaving the rest unprocessed */ \
+    EXPORT bool mat##N##_transform_points(const mat##N *self, const vector *points, vector *result, int32_t len) { \
+        for (int32_t i = 0; i < len; i++) { \
+            if (mat##N##_transform(self, &points[i], &result[i]) == NULL) return false; \
+        } \
+        return true; \
+    } \
+    \
+    /* Same for packed arrays; source and result must have the same shape and may be the same */ \
+    EXPORT vector_array *mat##N##_transform_array(const mat##N *self, const vector_array *source, vector_array *result) { \
+        int dim = source->dim; \
+        if (result->len != source->len || result->dim != dim || (dim != N && dim != N - 1)) return NULL; \
+        for (int32_t i = 0; i < source->len; i++) { \
+            double in[MAX_LEN], out[MAX_LEN]; \
+            for (int c = 0; c < dim; c++) in[c] = source->items[c][i]; \
+            mat_transform(self->items, N, in, dim, out); \
+            for (int c = 0; c < dim; c++) result->items[c][i] = out[c]; \
+        } \
+        return result; \
+    }
+
+MAT_DEFINE(2)
+MAT_DEFINE(3)
+MAT_DEFINE(4)
+
+EXPORT mat2 *mat2_rotation(double angle, mat2 *result) {
+    double c = cos(angle), s = sin(angle);
+    result->items[0] = c;
+    result->items[1] = -s;
+    result->items[2] = s;
+    result->items[3] = c;
+    return result;
+}
+
+EXPORT mat3 *mat3_translation(double x, double y, mat3 *result) {
+    mat3_identity(result);
+    result->items[2] = x;
+    result->items[5] = y;
+    return result;
+}
+
+EXPORT mat3 *mat3_rotation(double angle, mat3 *result) {
+    double c = cos(angle), s = sin(angle);
+    mat3_identity(result);
+    result->items[0] = c;
+    result->items[1] = -s;
+    result->items[3] = s;
+    result->items[4] = c;
+    return result;
+}
+
+EXPORT mat3 *mat3_scale(double x, double y, mat3 *result) {
+    mat3_identity(result);
+    result->items[0] = x;
+    result->items[4] = y;
+    return result;
+}
+
+// translation * rotation * scale, the usual sprite transform
+EXPORT mat3 *mat3_compose(double x, double y, double angle, double scale_x, double scale_y, mat3 *result) {
+    double c = cos(angle), s = sin(angle);
+    double items[9] = {
+        c * scale_x, -s * scale_y, x,
+        s * scale_x, c * scale_y, y,
+        0, 0, 1,
+    };
+    memcpy(result->items, items, sizeof(items));
+    return result;
+}
+
+EXPORT mat4 *mat4_translation(double x, double y, double z, mat4 *result) {
+    mat4_identity(result);
+    result->items[3] = x;
+    result->items[7] = y;
+    result->items[11] = z;
+    return result;
+}
+
+EXPORT mat4 *mat4_scale(double x, double y, double z, mat4 *result) {
+    mat4_identity(result);
+    result->items[0] = x;
+    result->items[5] = y;
+    result->items[10] = z;
+    return result;
+}
+
+// Rotation by `angle` around the axis (x, y, z), which does not need to be normalized
+EXPORT mat4 *mat4_rotation(double x, double y, double z, double angle, mat4 *result) {
+    double length = sqrt(x * x + y * y + z * z);
+    mat4_identity(result);
+    if (length == 0) return result;
+    x /= length;
+    y /= length;
+    z /= length;
+
+    double c = cos(angle), s = sin(angle), t = 1 - c;
+    double items[9] = {
+        t * x * x + c, t * x * y - s * z, t * x * z + s * y,
+        t * x * y + s * z, t * y * y + c, t * y * z - s * x,
+        t * x * z - s * y, t * y * z + s * x, t * z * z + c,
+    };
+    for (int row = 0; row < 3; row++) {
+        memcpy(&result->items[row * 4], &items[row * 3], sizeof(double) * 3);
+    }
+    return result;
+}
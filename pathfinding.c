@@ -0,0 +1,282 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vector.h"
+
+// A* and multi-source Dijkstra over a caller-supplied row-major grid of float costs, where
+// costs[y * width + x] is the price of entering the cell and a negative or infinite cost blocks
+// it. Coordinates are zero-based `vector`s {x; y}. Neighbours follow the order of
+// vector.extended_directions (up, left, down, right, then diagonals), diagonal moves cost
+// sqrt(2) times the cell cost and may not cut blocked corners.
+//
+// A pathfinder owns the scratch memory for one grid size, so repeated searches allocate nothing;
+// visit stamps avoid clearing it between searches.
+
+static const int direction_dx[8] = {0, -1, 0, 1, 1, 1, -1, -1};
+static const int direction_dy[8] = {-1, 0, 1, 0, 1, -1, -1, 1};
+
+typedef struct {
+    double priority;
+    int32_t cell;
+} path_heap_entry;
+
+typedef struct {
+    int32_t width;
+    int32_t height;
+    uint32_t stamp;
+    uint32_t *visited;
+    uint32_t *closed;
+    double *distances;
+    int32_t *parents;
+    path_heap_entry *heap;
+    int32_t heap_len;
+    int32_t heap_capacity;
+    int32_t goal;
+} pathfinder;
+
+EXPORT void pathfinder_free(pathfinder *self) {
+    if (self == NULL) return;
+    free(self->visited);
+    free(self->closed);
+    free(self->distances);
+    free(self->parents);
+    free(self->heap);
+    free(self);
+}
+
+EXPORT pathfinder *pathfinder_new(int32_t width, int32_t height) {
+    if (width <= 0 || height <= 0 || (int64_t)width * height > INT32_MAX) return NULL;
+
+    size_t n = (size_t)width * height;
+    pathfinder *self = calloc(1, sizeof(pathfinder));
+    if (self == NULL) return NULL;
+    self->width = width;
+    self->height = height;
+    self->visited = calloc(n, sizeof(uint32_t));
+    self->closed = calloc(n, sizeof(uint32_t));
+    self->distances = malloc(n * sizeof(double));
+    self->parents = malloc(n * sizeof(int32_t));
+    self->goal = -1;
+    self->heap_capacity = 1024;
+    self->heap = malloc(self->heap_capacity * sizeof(path_heap_entry));
+    if (!self->visited || !self->closed || !self->distances || !self->parents || !self->heap) {
+        pathfinder_free(self);
+        return NULL;
+    }
+    return self;
+}
+
+EXPORT int32_t pathfinder_cells(const pathfinder *self) {
+    return self->width * self->height;
+}
+
+static void path_begin(pathfinder *self) {
+    self->heap_len = 0;
+    self->goal = -1;
+    if (++self->stamp == 0) {
+        size_t n = (size_t)self->width * self->height;
+        memset(self->visited, 0, n * sizeof(uint32_t));
+        memset(self->closed, 0, n * sizeof(uint32_t));
+        self->stamp = 1;
+    }
+}
+
+static bool path_push(pathfinder *self, double priority, int32_t cell) {
+    if (self->heap_len == self->heap_capacity) {
+        path_heap_entry *heap = realloc(self->heap, 2 * self->heap_capacity * sizeof(path_heap_entry));
+        if (heap == NULL) return false;
+        self->heap = heap;
+        self->heap_capacity *= 2;
+    }
+
+    int32_t i = self->heap_len++;
+    while (i > 0 && self->heap[(i - 1) / 2].priority > priority) {
+        self->heap[i] = self->heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    self->heap[i].priority = priority;
+    self->heap[i].cell = cell;
+    return true;
+}
+
+static int32_t path_pop(pathfinder *self) {
+    int32_t result = self->heap[0].cell;
+    path_heap_entry last = self->heap[--self->heap_len];
+
+    int32_t i = 0;
+    while (true) {
+        int32_t child = 2 * i + 1;
+        if (child >= self->heap_len) break;
+        if (child + 1 < self->heap_len && self->heap[child + 1].priority < self->heap[child].priority) child++;
+        if (self->heap[child].priority >= last.priority) break;
+        self->heap[i] = self->heap[child];
+        i = child;
+    }
+    self->heap[i] = last;
+    return result;
+}
+
+static inline bool path_passable(const float *costs, int32_t cell) {
+    return costs[cell] >= 0 && isfinite(costs[cell]);
+}
+
+static bool path_cell_of(const pathfinder *self, const vector *v, int32_t *cell) {
+    if (v->len != 2) return false;
+    double x = v->items[0], y = v->items[1];
+    if (!(x >= 0 && y >= 0 && x < self->width && y < self->height)) return false;
+    *cell = (int32_t)y * self->width + (int32_t)x;
+    return true;
+}
+
+// Cost of moving from `cell` in `direction`, or -1 if the move is not allowed
+static inline double path_step_cost(const pathfinder *self, const float *costs, int32_t cell, int direction) {
+    int32_t x = cell % self->width + direction_dx[direction];
+    int32_t y = cell / self->width + direction_dy[direction];
+    if (x < 0 || y < 0 || x >= self->width || y >= self->height) return -1;
+
+    int32_t next = y * self->width + x;
+    if (!path_passable(costs, next)) return -1;
+    if (direction < 4) return costs[next];
+
+    // Diagonal: both orthogonal cells have to be open
+    if (!path_passable(costs, (cell / self->width) * self->width + x)) return -1;
+    if (!path_passable(costs, y * self->width + cell % self->width)) return -1;
+    return costs[next] * M_SQRT2;
+}
+
+static inline double path_heuristic(const pathfinder *self, int32_t cell, int32_t goal, bool diagonal) {
+    double dx = abs(cell % self->width - goal % self->width);
+    double dy = abs(cell / self->width - goal / self->width);
+    if (!diagonal) return dx + dy;
+    return dx + dy + (M_SQRT2 - 2) * fmin(dx, dy);
+}
+
+// Writes up to `capacity` unit steps {dx; dy} of the path found by the last successful
+// pathfinder_astar call; returns the number of steps, -1 if there is no such path
+EXPORT int32_t pathfinder_path(const pathfinder *self, vector *result, int32_t capacity) {
+    if (self->goal == -1) return -1;
+
+    int32_t steps = 0;
+    for (int32_t cell = self->goal; self->parents[cell] != -1; cell = self->parents[cell]) steps++;
+
+    int32_t i = steps;
+    for (int32_t cell = self->goal; self->parents[cell] != -1; cell = self->parents[cell]) {
+        i--;
+        if (i >= capacity) continue;
+        int32_t parent = self->parents[cell];
+        result[i].len = 2;
+        result[i].items[0] = cell % self->width - parent % self->width;
+        result[i].items[1] = cell / self->width - parent / self->width;
+    }
+    return steps;
+}
+
+// Finds the cheapest path and writes it as unit steps {dx; dy} from start to goal, up to
+// `capacity` of them. Returns the number of steps (0 if start == goal), which may exceed
+// capacity, or -1 if the goal is unreachable or a point is off the grid. The heuristic assumes
+// costs of at least 1; cheaper cells still give valid, but not necessarily optimal, paths.
+EXPORT int32_t pathfinder_astar(
+    pathfinder *self, const float *costs, const vector *start, const vector *goal, bool diagonal,
+    vector *result, int32_t capacity
+) {
+    int32_t from, to;
+    if (!path_cell_of(self, start, &from) || !path_cell_of(self, goal, &to)) return -1;
+    if (!path_passable(costs, to)) return -1;
+
+    path_begin(self);
+    int directions_n = diagonal ? 8 : 4;
+    self->visited[from] = self->stamp;
+    self->distances[from] = 0;
+    self->parents[from] = -1;
+    if (!path_push(self, path_heuristic(self, from, to, diagonal), from)) return -1;
+
+    bool found = false;
+    while (self->heap_len > 0) {
+        int32_t cell = path_pop(self);
+        if (self->closed[cell] == self->stamp) continue;
+        self->closed[cell] = self->stamp;
+        if (cell == to) {
+            found = true;
+            break;
+        }
+
+        for (int d = 0; d < directions_n; d++) {
+            double step = path_step_cost(self, costs, cell, d);
+            if (step < 0) continue;
+            int32_t next = cell + direction_dy[d] * self->width + direction_dx[d];
+            double distance = self->distances[cell] + step;
+            if (self->visited[next] == self->stamp && self->distances[next] <= distance) continue;
+
+            self->visited[next] = self->stamp;
+            self->distances[next] = distance;
+            self->parents[next] = cell;
+            if (!path_push(self, distance + path_heuristic(self, next, to, diagonal), next)) return -1;
+        }
+    }
+    if (!found) return -1;
+
+    self->goal = to;
+    return pathfinder_path(self, result, capacity);
+}
+
+// Multi-source Dijkstra map: distances[cell] is the cost of the cheapest path from any source
+// to the cell, INFINITY if unreachable. Sources off the grid or on blocked cells are skipped.
+// Returns false on allocation failure.
+EXPORT bool pathfinder_dijkstra(
+    pathfinder *self, const float *costs, const vector *sources, int32_t sources_len, bool diagonal,
+    double *distances
+) {
+    size_t n = (size_t)self->width * self->height;
+    for (size_t i = 0; i < n; i++) distances[i] = INFINITY;
+
+    path_begin(self);
+    for (int32_t i = 0; i < sources_len; i++) {
+        int32_t cell;
+        if (!path_cell_of(self, &sources[i], &cell) || !path_passable(costs, cell)) continue;
+        distances[cell] = 0;
+        if (!path_push(self, 0, cell)) return false;
+    }
+
+    int directions_n = diagonal ? 8 : 4;
+    while (self->heap_len > 0) {
+        int32_t cell = path_pop(self);
+        if (self->closed[cell] == self->stamp) continue;
+        self->closed[cell] = self->stamp;
+
+        for (int d = 0; d < directions_n; d++) {
+            double step = path_step_cost(self, costs, cell, d);
+            if (step < 0) continue;
+            int32_t next = cell + direction_dy[d] * self->width + direction_dx[d];
+            double distance = distances[cell] + step;
+            if (distance >= distances[next]) continue;
+            distances[next] = distance;
+            if (!path_push(self, distance, next)) return false;
+        }
+    }
+    return true;
+}
+
+// Flow field over a Dijkstra map: directions[cell] is the index (0-based, in
+// vector.extended_directions order) of the neighbour with the lowest distance, or -1 for sources,
+// unreachable cells and local minima
+EXPORT void pathfinder_flow_field(
+    const pathfinder *self, const float *costs, const double *distances, bool diagonal, int8_t *directions
+) {
+    int directions_n = diagonal ? 8 : 4;
+    int32_t n = self->width * self->height;
+    for (int32_t cell = 0; cell < n; cell++) {
+        directions[cell] = -1;
+        double best = distances[cell];
+        if (!isfinite(best)) continue;
+
+        for (int d = 0; d < directions_n; d++) {
+            if (path_step_cost(self, costs, cell, d) < 0) continue;
+            int32_t next = cell + direction_dy[d] * self->width + direction_dx[d];
+            if (distances[next] < best) {
+                best = distances[next];
+                directions[cell] = d;
+            }
+        }
+    }
+}
@@ -0,0 +1,151 @@
+#include <pthread.h>
+
+#include "vector.h"
+
+// Persistent worker pool for batched operations. Work over [0, n) is cut into fixed
+// VECTOR_POOL_CHUNK-sized chunks, and chunk c always goes to thread c % threads. Chunk boundaries
+// therefore do not depend on the thread count, and per-chunk results combined in chunk order
+// are reproducible. The calling thread works as thread 0. The pool serves one caller at a time,
+// like the rest of the library.
+
+#define VECTOR_POOL_MAX_THREADS 256
+
+static struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    pthread_t workers[VECTOR_POOL_MAX_THREADS];
+    int32_t threads;
+    int64_t threshold;
+    uint64_t generation;
+    bool stopping;
+    int32_t busy;
+    // Workers that have read the generation and can be woken
+    int32_t ready;
+    vector_pool_task task;
+    void *context;
+    size_t n;
+} pool = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .start = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER,
+    .threads = 1,
+    .threshold = 100000,
+};
+
+static void pool_work(int32_t thread, int32_t threads, vector_pool_task task, void *context, size_t n) {
+    size_t chunks = (n + VECTOR_POOL_CHUNK - 1) / VECTOR_POOL_CHUNK;
+    for (size_t c = thread; c < chunks; c += threads) {
+        size_t begin = c * VECTOR_POOL_CHUNK;
+        size_t end = begin + VECTOR_POOL_CHUNK < n ? begin + VECTOR_POOL_CHUNK : n;
+        task(context, begin, end);
+    }
+}
+
+static void *pool_worker(void *arg) {
+    int32_t thread = (int32_t)(intptr_t)arg;
+
+    pthread_mutex_lock(&pool.mutex);
+    uint64_t seen = pool.generation;
+    pool.ready++;
+    pthread_cond_signal(&pool.done);
+    while (true) {
+        while (pool.generation == seen && !pool.stopping) {
+            pthread_cond_wait(&pool.start, &pool.mutex);
+        }
+        if (pool.stopping) break;
+        seen = pool.generation;
+
+        int32_t threads = pool.threads;
+        vector_pool_task task = pool.task;
+        void *context = pool.context;
+        size_t n = pool.n;
+        pthread_mutex_unlock(&pool.mutex);
+
+        pool_work(thread, threads, task, context, n);
+
+        pthread_mutex_lock(&pool.mutex);
+        if (--pool.busy == 0) pthread_cond_signal(&pool.done);
+    }
+    pthread_mutex_unlock(&pool.mutex);
+    return NULL;
+}
+
+static void pool_stop(void) {
+    pthread_mutex_lock(&pool.mutex);
+    pool.stopping = true;
+    pthread_cond_broadcast(&pool.start);
+    pthread_mutex_unlock(&pool.mutex);
+
+    for (int32_t i = 1; i < pool.threads; i++) {
+        pthread_join(pool.workers[i], NULL);
+    }
+    pool.stopping = false;
+    pool.threads = 1;
+    pool.ready = 0;
+}
+
+// A worker that has not read the generation yet would miss the next dispatch and never report
+// back, so new workers are waited for before they can be given work
+static void pool_wait_ready(void) {
+    pthread_mutex_lock(&pool.mutex);
+    while (pool.ready < pool.threads - 1) pthread_cond_wait(&pool.done, &pool.mutex);
+    pthread_mutex_unlock(&pool.mutex);
+}
+
+void vector_pool_run(vector_pool_task task, void *context, size_t n) {
+    if (pool.threads == 1 || n < (size_t)pool.threshold || n <= VECTOR_POOL_CHUNK) {
+        pool_work(0, 1, task, context, n);
+        return;
+    }
+
+    pthread_mutex_lock(&pool.mutex);
+    pool.task = task;
+    pool.context = context;
+    pool.n = n;
+    pool.busy = pool.threads - 1;
+    pool.generation++;
+    pthread_cond_broadcast(&pool.start);
+    pthread_mutex_unlock(&pool.mutex);
+
+    pool_work(0, pool.threads, task, context, n);
+
+    pthread_mutex_lock(&pool.mutex);
+    while (pool.busy > 0) pthread_cond_wait(&pool.done, &pool.mutex);
+    pthread_mutex_unlock(&pool.mutex);
+}
+
+// Restarts the pool with `threads` threads including the caller, clamped to [1, 256]; 1 turns it
+// off. False if some workers could not be started, in which case the pool keeps the ones that did.
+EXPORT bool vector_set_threads(int32_t threads) {
+    if (threads < 1) threads = 1;
+    if (threads > VECTOR_POOL_MAX_THREADS) threads = VECTOR_POOL_MAX_THREADS;
+    if (threads == pool.threads) return true;
+
+    pool_stop();
+    bool started = true;
+    for (int32_t i = 1; i < threads && started; i++) {
+        started = pthread_create(&pool.workers[i], NULL, pool_worker, (void *)(intptr_t)i) == 0;
+        if (started) pool.threads = i + 1;
+    }
+    pool_wait_ready();
+    return started;
+}
+
+EXPORT int32_t vector_threads(void) {
+    return pool.threads;
+}
+
+// Batches with fewer elements (len * dim for flat kernels) stay on the calling thread
+EXPORT void vector_set_thread_threshold(int64_t threshold) {
+    pool.threshold = threshold;
+}
+
+EXPORT int64_t vector_thread_threshold(void) {
+    return pool.threshold;
+}
+
+__attribute__((destructor))
+static void vector_pool_destroy(void) {
+    pool_stop();
+}
@@ -0,0 +1,152 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "vector.h"
+
+// Seedable random streams filling `vector` buffers. The generator is xoshiro256** seeded through
+// splitmix64 from the seed and a stream id, so every caller can own a stream that does not depend
+// on how much the others draw. Output depends only on the seed, the stream and the call sequence,
+// which keeps replays and server simulations reproducible. Sampling stays on the calling thread.
+
+typedef struct {
+    uint64_t state[4];
+} vector_rng;
+
+static inline uint64_t rng_rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t rng_next(vector_rng *self) {
+    uint64_t *s = self->state;
+    uint64_t result = rng_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rng_rotl(s[3], 45);
+    return result;
+}
+
+// Uniform in [0, 1) with all 53 bits of precision
+static inline double rng_double(vector_rng *self) {
+    return (rng_next(self) >> 11) * 0x1.0p-53;
+}
+
+// Uniform in [-1, 1); rng_ball rejects the -1 edge along with the rest of the sphere surface
+static inline double rng_signed(vector_rng *self) {
+    return 2 * rng_double(self) - 1;
+}
+
+static uint64_t rng_splitmix(uint64_t *x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+// The stream id is mixed into a scrambled seed, so that nearby seeds and streams start far apart;
+// with a 2^256 - 1 period, overlaps between streams are practically impossible
+EXPORT void vector_rng_seed(vector_rng *self, uint64_t seed, uint64_t stream) {
+    uint64_t x = rng_splitmix(&seed) ^ stream;
+    for (int j = 0; j < 4; j++) self->state[j] = rng_splitmix(&x);
+}
+
+EXPORT vector_rng *vector_rng_new(uint64_t seed, uint64_t stream) {
+    vector_rng *self = malloc(sizeof(vector_rng));
+    if (self == NULL) return NULL;
+    vector_rng_seed(self, seed, stream);
+    return self;
+}
+
+EXPORT void vector_rng_free(vector_rng *self) {
+    free(self);
+}
+
+EXPORT double vector_rng_uniform(vector_rng *self) {
+    return rng_double(self);
+}
+
+// Point uniformly distributed in the open unit ball of `dim` dimensions, by rejection from the
+// cube; squared length into *length2
+static inline void rng_ball(vector_rng *self, int dim, double *items, double *length2) {
+    double r2;
+    do {
+        r2 = 0;
+        for (int c = 0; c < dim; c++) {
+            items[c] = rng_signed(self);
+            r2 += items[c] * items[c];
+        }
+    } while (r2 >= 1);
+    *length2 = r2;
+}
+
+// Uniform in the box [min, max) componentwise; NULL if min and max differ in length
+EXPORT vector *vector_rng_box(vector_rng *self, const vector *min, const vector *max, vector *result, int32_t len) {
+    if (min->len != max->len) return NULL;
+    for (int32_t i = 0; i < len; i++) {
+        result[i].len = min->len;
+        for (int c = 0; c < min->len; c++) {
+            result[i].items[c] = min->items[c] + (max->items[c] - min->items[c]) * rng_double(self);
+        }
+    }
+    return result;
+}
+
+// 2D points uniform in the unit disk
+EXPORT vector *vector_rng_disk(vector_rng *self, vector *result, int32_t len) {
+    double r2;
+    for (int32_t i = 0; i < len; i++) {
+        result[i].len = 2;
+        rng_ball(self, 2, result[i].items, &r2);
+    }
+    return result;
+}
+
+// 3D points uniform in the unit ball
+EXPORT vector *vector_rng_sphere(vector_rng *self, vector *result, int32_t len) {
+    double r2;
+    for (int32_t i = 0; i < len; i++) {
+        result[i].len = 3;
+        rng_ball(self, 3, result[i].items, &r2);
+    }
+    return result;
+}
+
+// Unit vectors of length `dim` (2 to 4) uniform in direction; NULL for other lengths
+EXPORT vector *vector_rng_direction(vector_rng *self, int dim, vector *result, int32_t len) {
+    if (dim < 2 || dim > MAX_LEN) return NULL;
+    for (int32_t i = 0; i < len; i++) {
+        double r2;
+        // Points too close to the center lose precision when normalized
+        do rng_ball(self, dim, result[i].items, &r2); while (r2 < 1e-12);
+
+        double k = 1 / sqrt(r2);
+        result[i].len = dim;
+        for (int c = 0; c < dim; c++) result[i].items[c] *= k;
+    }
+    return result;
+}
+
+// Normal samples around `mean` with the componentwise standard deviation `stddev`, drawn in pairs
+// by the Marsaglia polar method; NULL if mean and stddev differ in length
+EXPORT vector *vector_rng_gaussian(
+    vector_rng *self, const vector *mean, const vector *stddev, vector *result, int32_t len
+) {
+    if (mean->len != stddev->len) return NULL;
+    int dim = mean->len;
+    int64_t total = (int64_t)len * dim;
+    for (int64_t t = 0; t < total; t += 2) {
+        double pair[2], r2;
+        do rng_ball(self, 2, pair, &r2); while (r2 == 0);
+        double k = sqrt(-2 * log(r2) / r2);
+
+        for (int64_t u = t; u < t + 2 && u < total; u++) {
+            int c = u % dim;
+            result[u / dim].items[c] = mean->items[c] + stddev->items[c] * pair[u - t] * k;
+        }
+    }
+    for (int32_t i = 0; i < len; i++) result[i].len = dim;
+    return result;
+}
@@ -0,0 +1,191 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vector.h"
+
+// Reductions over arrays of `vector`s of one length. Sums are pairwise: each pool chunk is summed
+// by recursive halving down to small blocks, and the chunk sums are then combined the same way in
+// chunk order. The error grows with log(len) instead of len, and the result does not depend on the
+// thread count. Variance and covariance take a second pass over deviations from the mean.
+
+#define REDUCE_BLOCK 32
+#define REDUCE_MAX_TERMS (MAX_LEN * MAX_LEN)
+
+typedef enum {
+    REDUCE_SUM,
+    REDUCE_SQUARES,
+    REDUCE_PRODUCTS,
+} reduce_kind;
+
+typedef struct {
+    const vector *items;
+    int dim;
+    int terms;
+    reduce_kind kind;
+    double mean[MAX_LEN];
+    double *partials;
+} reduce_job;
+
+static void reduce_block(const reduce_job *job, size_t begin, size_t end, double *out) {
+    memset(out, 0, sizeof(double) * job->terms);
+    for (size_t i = begin; i < end; i++) {
+        const double *x = job->items[i].items;
+        if (job->kind == REDUCE_SUM) {
+            for (int c = 0; c < job->dim; c++) out[c] += x[c];
+        } else if (job->kind == REDUCE_SQUARES) {
+            for (int c = 0; c < job->dim; c++) {
+                double d = x[c] - job->mean[c];
+                out[c] += d * d;
+            }
+        } else {
+            double d[MAX_LEN];
+            for (int c = 0; c < job->dim; c++) d[c] = x[c] - job->mean[c];
+            for (int r = 0; r < job->dim; r++) {
+                for (int c = 0; c < job->dim; c++) out[r * job->dim + c] += d[r] * d[c];
+            }
+        }
+    }
+}
+
+static void reduce_pairwise(const reduce_job *job, size_t begin, size_t end, double *out) {
+    if (end - begin <= REDUCE_BLOCK) {
+        reduce_block(job, begin, end, out);
+        return;
+    }
+    size_t middle = begin + (end - begin) / 2;
+    double right[REDUCE_MAX_TERMS];
+    reduce_pairwise(job, begin, middle, out);
+    reduce_pairwise(job, middle, end, right);
+    for (int t = 0; t < job->terms; t++) out[t] += right[t];
+}
+
+static void reduce_task(void *context, size_t begin, size_t end) {
+    const reduce_job *job = context;
+    reduce_pairwise(job, begin, end, job->partials + begin / VECTOR_POOL_CHUNK * job->terms);
+}
+
+// Pairwise sum of the chunk sums [begin, end)
+static void reduce_combine(const double *partials, int terms, size_t begin, size_t end, double *out) {
+    if (end - begin == 1) {
+        memcpy(out, partials + begin * terms, sizeof(double) * terms);
+        return;
+    }
+    size_t middle = begin + (end - begin) / 2;
+    double right[REDUCE_MAX_TERMS];
+    reduce_combine(partials, terms, begin, middle, out);
+    reduce_combine(partials, terms, middle, end, right);
+    for (int t = 0; t < terms; t++) out[t] += right[t];
+}
+
+static bool reduce(reduce_job *job, size_t len, double *out) {
+    size_t chunks = (len + VECTOR_POOL_CHUNK - 1) / VECTOR_POOL_CHUNK;
+    double single[REDUCE_MAX_TERMS];
+    job->partials = chunks == 1 ? single : malloc(sizeof(double) * job->terms * chunks);
+    if (job->partials == NULL) return false;
+
+    vector_pool_run(reduce_task, job, len);
+    reduce_combine(job->partials, job->terms, 0, chunks, out);
+    if (job->partials != single) free(job->partials);
+    return true;
+}
+
+// Length shared by all items, -1 if there are none or the lengths differ
+static int reduce_dim(const vector *items, int64_t len) {
+    if (len <= 0) return -1;
+    for (int64_t i = 1; i < len; i++) {
+        if (items[i].len != items[0].len) return -1;
+    }
+    return items[0].len;
+}
+
+static bool reduce_mean(const vector *items, int64_t len, int dim, double *mean) {
+    reduce_job job = {.items = items, .dim = dim, .terms = dim, .kind = REDUCE_SUM};
+    if (!reduce(&job, len, mean)) return false;
+    for (int c = 0; c < dim; c++) mean[c] /= len;
+    return true;
+}
+
+// NULL for an empty array, mixed lengths or allocation failure, like the other reductions
+EXPORT vector *vector_sum(const vector *items, int64_t len, vector *result) {
+    int dim = reduce_dim(items, len);
+    if (dim < 0) return NULL;
+    reduce_job job = {.items = items, .dim = dim, .terms = dim, .kind = REDUCE_SUM};
+    double sum[MAX_LEN];
+    if (!reduce(&job, len, sum)) return NULL;
+
+    result->len = dim;
+    memcpy(result->items, sum, sizeof(double) * dim);
+    return result;
+}
+
+EXPORT vector *vector_mean(const vector *items, int64_t len, vector *result) {
+    int dim = reduce_dim(items, len);
+    double mean[MAX_LEN];
+    if (dim < 0 || !reduce_mean(items, len, dim, mean)) return NULL;
+
+    result->len = dim;
+    memcpy(result->items, mean, sizeof(double) * dim);
+    return result;
+}
+
+// Componentwise minimum and maximum, i.e. the bounding box; either output may be NULL. NaN
+// components are ignored unless a component is NaN everywhere.
+EXPORT bool vector_aabb(const vector *items, int64_t len, vector *min, vector *max) {
+    int dim = reduce_dim(items, len);
+    if (dim < 0) return false;
+
+    double lo[MAX_LEN], hi[MAX_LEN];
+    memcpy(lo, items[0].items, sizeof(double) * dim);
+    memcpy(hi, items[0].items, sizeof(double) * dim);
+    for (int64_t i = 1; i < len; i++) {
+        for (int c = 0; c < dim; c++) {
+            lo[c] = fmin(lo[c], items[i].items[c]);
+            hi[c] = fmax(hi[c], items[i].items[c]);
+        }
+    }
+
+    if (min != NULL) {
+        min->len = dim;
+        memcpy(min->items, lo, sizeof(double) * dim);
+    }
+    if (max != NULL) {
+        max->len = dim;
+        memcpy(max->items, hi, sizeof(double) * dim);
+    }
+    return true;
+}
+
+// Population variance of each component; the mean goes to `mean` unless it is NULL
+EXPORT vector *vector_variance(const vector *items, int64_t len, vector *mean, vector *result) {
+    int dim = reduce_dim(items, len);
+    if (dim < 0) return NULL;
+    reduce_job job = {.items = items, .dim = dim, .terms = dim, .kind = REDUCE_SQUARES};
+    double variance[MAX_LEN];
+    if (!reduce_mean(items, len, dim, job.mean) || !reduce(&job, len, variance)) return NULL;
+
+    if (mean != NULL) {
+        mean->len = dim;
+        memcpy(mean->items, job.mean, sizeof(double) * dim);
+    }
+    result->len = dim;
+    for (int c = 0; c < dim; c++) result->items[c] = variance[c] / len;
+    return result;
+}
+
+// Population covariance matrix, row-major into result[dim * dim], so mat2/mat3/mat4 items for
+// lengths 2 to 4; the mean goes to `mean` unless it is NULL. Returns the length, or -1.
+EXPORT int vector_covariance(const vector *items, int64_t len, vector *mean, double *result) {
+    int dim = reduce_dim(items, len);
+    if (dim < 0) return -1;
+    reduce_job job = {.items = items, .dim = dim, .terms = dim * dim, .kind = REDUCE_PRODUCTS};
+    double covariance[REDUCE_MAX_TERMS];
+    if (!reduce_mean(items, len, dim, job.mean) || !reduce(&job, len, covariance)) return -1;
+
+    if (mean != NULL) {
+        mean->len = dim;
+        memcpy(mean->items, job.mean, sizeof(double) * dim);
+    }
+    for (int t = 0; t < dim * dim; t++) result[t] = covariance[t] / len;
+    return dim;
+}
@@ -0,0 +1,229 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vector.h"
+
+// Line walks, raycasts and field of view over a row-major uint8_t grid, where a non-zero
+// blocking[y * width + x] stops sight. Cells are addressed by zero-based `vector`s {x; y}, the
+// same grid as vector_name_from_direction and pathfinding.c; cells outside the grid block.
+
+static inline bool sight_inside(int32_t width, int32_t height, int64_t x, int64_t y) {
+    return x >= 0 && y >= 0 && x < width && y < height;
+}
+
+static inline bool sight_blocks(const uint8_t *blocking, int32_t width, int32_t height, int64_t x, int64_t y) {
+    return !sight_inside(width, height, x, y) || blocking[y * width + x];
+}
+
+static inline bool sight_cell_of(const vector *v, int64_t *x, int64_t *y) {
+    if (v->len != 2 || !isfinite(v->items[0]) || !isfinite(v->items[1])) return false;
+    if (fabs(v->items[0]) > INT32_MAX || fabs(v->items[1]) > INT32_MAX) return false;
+    *x = (int64_t)floor(v->items[0] + 0.5);
+    *y = (int64_t)floor(v->items[1] + 0.5);
+    return true;
+}
+
+// Integer Bresenham walk state
+typedef struct {
+    int64_t x, y, dx, dy, sx, sy, error;
+} sight_line;
+
+static inline void sight_line_begin(sight_line *line, int64_t x0, int64_t y0, int64_t x1, int64_t y1) {
+    line->x = x0;
+    line->y = y0;
+    line->dx = llabs(x1 - x0);
+    line->dy = -llabs(y1 - y0);
+    line->sx = x0 < x1 ? 1 : -1;
+    line->sy = y0 < y1 ? 1 : -1;
+    line->error = line->dx + line->dy;
+}
+
+static inline void sight_line_step(sight_line *line) {
+    int64_t e2 = 2 * line->error;
+    if (e2 >= line->dy) {
+        line->error += line->dy;
+        line->x += line->sx;
+    }
+    if (e2 <= line->dx) {
+        line->error += line->dx;
+        line->y += line->sy;
+    }
+}
+
+// Bresenham cells from `from` to `to`, both included, rounding coordinates to the nearest cell.
+// Writes up to `capacity` of them and returns the total count, 0 for non-2D or huge input.
+EXPORT int32_t sight_line_walk(const vector *from, const vector *to, vector *result, int32_t capacity) {
+    int64_t x0, y0, x1, y1;
+    if (!sight_cell_of(from, &x0, &y0) || !sight_cell_of(to, &x1, &y1)) return 0;
+
+    int64_t n = (llabs(x1 - x0) > llabs(y1 - y0) ? llabs(x1 - x0) : llabs(y1 - y0)) + 1;
+    if (n > INT32_MAX) return 0;
+
+    sight_line line;
+    sight_line_begin(&line, x0, y0, x1, y1);
+    for (int32_t i = 0; i < n && i < capacity; i++) {
+        result[i].len = 2;
+        result[i].items[0] = (double)line.x;
+        result[i].items[1] = (double)line.y;
+        sight_line_step(&line);
+    }
+    return (int32_t)n;
+}
+
+// True if no blocking cell lies strictly between the two cells along the Bresenham line; the
+// endpoints themselves may block, so walls are visible. False if either endpoint is off the grid.
+EXPORT bool sight_line_of_sight(
+    const uint8_t *blocking, int32_t width, int32_t height, const vector *from, const vector *to
+) {
+    int64_t x0, y0, x1, y1;
+    if (!sight_cell_of(from, &x0, &y0) || !sight_cell_of(to, &x1, &y1)) return false;
+    if (!sight_inside(width, height, x0, y0) || !sight_inside(width, height, x1, y1)) return false;
+
+    sight_line line;
+    sight_line_begin(&line, x0, y0, x1, y1);
+    sight_line_step(&line);
+    while (line.x != x1 || line.y != y1) {
+        if (blocking[line.y * width + line.x]) return false;
+        sight_line_step(&line);
+    }
+    return true;
+}
+
+// DDA raycast from a continuous `origin` along `direction`, where integer coordinates are cell
+// centers. Returns true and writes the first blocking cell (leaving the grid counts as hitting its
+// edge, reported as the last cell inside) and the distance to its boundary if it is within
+// `max_distance`. The origin cell never blocks.
+EXPORT bool sight_raycast(
+    const uint8_t *blocking, int32_t width, int32_t height, const vector *origin, const vector *direction,
+    double max_distance, vector *hit, double *distance
+) {
+    if (origin->len != 2 || direction->len != 2) return false;
+    double length = hypot(direction->items[0], direction->items[1]);
+    if (!(length > 0)) return false;
+
+    // Shift so that cell (x, y) spans [x, x + 1) on both axes
+    double ox = origin->items[0] + 0.5, oy = origin->items[1] + 0.5;
+    double dx = direction->items[0] / length, dy = direction->items[1] / length;
+    int64_t x = (int64_t)floor(ox), y = (int64_t)floor(oy);
+    if (!sight_inside(width, height, x, y)) return false;
+
+    int sx = dx > 0 ? 1 : -1, sy = dy > 0 ? 1 : -1;
+    double delta_x = dx != 0 ? fabs(1 / dx) : INFINITY;
+    double delta_y = dy != 0 ? fabs(1 / dy) : INFINITY;
+    double next_x = dx > 0 ? (x + 1 - ox) * delta_x : dx < 0 ? (ox - x) * delta_x : INFINITY;
+    double next_y = dy > 0 ? (y + 1 - oy) * delta_y : dy < 0 ? (oy - y) * delta_y : INFINITY;
+
+    while (true) {
+        double t;
+        int64_t last_x = x, last_y = y;
+        if (next_x < next_y) {
+            t = next_x;
+            next_x += delta_x;
+            x += sx;
+        } else {
+            t = next_y;
+            next_y += delta_y;
+            y += sy;
+        }
+        if (t > max_distance) return false;
+        if (!sight_blocks(blocking, width, height, x, y)) continue;
+
+        if (!sight_inside(width, height, x, y)) {
+            x = last_x;
+            y = last_y;
+        }
+        if (hit != NULL) {
+            hit->len = 2;
+            hit->items[0] = (double)x;
+            hit->items[1] = (double)y;
+        }
+        if (distance != NULL) *distance = t;
+        return true;
+    }
+}
+
+// Octant transforms for shadowcasting: (column, row) -> (x, y) offsets
+static const int octant_xx[8] = {1, 0, 0, -1, -1, 0, 0, 1};
+static const int octant_xy[8] = {0, 1, -1, 0, 0, -1, 1, 0};
+static const int octant_yx[8] = {0, 1, 1, 0, 0, -1, -1, 0};
+static const int octant_yy[8] = {1, 0, 0, 1, -1, 0, 0, -1};
+
+typedef struct {
+    const uint8_t *blocking;
+    int32_t width;
+    int32_t height;
+    int64_t x;
+    int64_t y;
+    int32_t radius;
+    double radius2;
+    uint8_t *visible;
+} sight_fov;
+
+// Recursive shadowcasting of one octant between slopes start >= end, from `row` outwards
+static void sight_cast(const sight_fov *fov, int octant, int32_t row, double start, double end) {
+    if (start < end) return;
+
+    double new_start = 0;
+    for (int32_t j = row; j <= fov->radius; j++) {
+        bool blocked = false;
+        for (int32_t dx = -j; dx <= 0; dx++) {
+            int32_t dy = -j;
+            double left = (dx - 0.5) / (dy + 0.5);
+            double right = (dx + 0.5) / (dy - 0.5);
+            if (start < right) continue;
+            if (end > left) break;
+
+            int64_t x = fov->x + dx * octant_xx[octant] + dy * octant_xy[octant];
+            int64_t y = fov->y + dx * octant_yx[octant] + dy * octant_yy[octant];
+            if (sight_inside(fov->width, fov->height, x, y) && (double)dx * dx + (double)dy * dy <= fov->radius2) {
+                fov->visible[y * fov->width + x] = 1;
+            }
+
+            bool wall = sight_blocks(fov->blocking, fov->width, fov->height, x, y);
+            if (blocked) {
+                if (wall) {
+                    new_start = right;
+                } else {
+                    blocked = false;
+                    start = new_start;
+                }
+            } else if (wall && j < fov->radius) {
+                blocked = true;
+                sight_cast(fov, octant, j + 1, start, left);
+                new_start = right;
+            }
+        }
+        if (blocked) break;
+    }
+}
+
+// Shadowcasting field of view: clears `visible` (width * height bytes) and sets to 1 every cell
+// seen from `origin` within `radius`, including the origin and the walls that stop sight.
+// Returns false if the origin is off the grid.
+EXPORT bool sight_fov_compute(
+    const uint8_t *blocking, int32_t width, int32_t height, const vector *origin, double radius,
+    uint8_t *visible
+) {
+    memset(visible, 0, (size_t)width * height);
+
+    int64_t x, y;
+    if (!sight_cell_of(origin, &x, &y) || !sight_inside(width, height, x, y) || !(radius >= 0)) return false;
+
+    sight_fov fov = {
+        .blocking = blocking,
+        .width = width,
+        .height = height,
+        .x = x,
+        .y = y,
+        // Off-grid cells block, so rows past the grid add nothing
+        .radius = radius < (width > height ? width : height) ? (int32_t)radius : (width > height ? width : height),
+        .radius2 = radius * radius,
+        .visible = visible,
+    };
+    visible[y * width + x] = 1;
+    for (int octant = 0; octant < 8; octant++) {
+        sight_cast(&fov, octant, 1, 1.0, 0.0);
+    }
+    return true;
+}
@@ -0,0 +1,216 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "vector.h"
+
+// Binary snapshots of `vector` (precision 8) or `vectorf` (precision 4) arrays: a 64-byte header
+// followed by the structs exactly as they are laid out in memory, so a loaded file is usable
+// in place. Files are written in native byte order; the header records it and loading a file from
+// a machine with another order or struct layout fails instead of misreading it. Opening checks only
+// the header and that the records fit in the file, so it does not touch the records' pages; each
+// record's len is checked when it is read.
+
+#define SNAPSHOT_MAGIC "VSNP"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_BYTE_ORDER 0x01020304u
+
+typedef struct {
+    char magic[4];
+    uint32_t byte_order;
+    uint32_t version;
+    uint32_t precision;
+    uint32_t dim;
+    uint32_t record_size;
+    uint64_t count;
+    uint8_t reserved[32];
+} snapshot_header;
+
+_Static_assert(sizeof(snapshot_header) == 64, "records should start 8-byte aligned");
+
+typedef struct {
+    int32_t version;
+    int32_t dim;
+    int32_t precision;
+    int64_t count;
+    void *items;
+    void *map;
+    size_t size;
+    // Set once vector_snapshot_check has accepted every record
+    bool checked;
+} vector_snapshot;
+
+struct vector_snapshot_writer {
+    FILE *file;
+    int32_t dim;
+    int32_t precision;
+    int64_t count;
+    bool failed;
+};
+
+static inline size_t snapshot_record_size(int precision) {
+    return precision == 8 ? sizeof(vector) : sizeof(vectorf);
+}
+
+EXPORT void vector_snapshot_close(vector_snapshot *self) {
+    if (self == NULL) return;
+    if (self->map != NULL) munmap(self->map, self->size);
+    free(self);
+}
+
+// Maps the file privately: reads are zero-copy and writes to items stay in memory. NULL if the
+// file can not be read or is not a valid snapshot.
+EXPORT vector_snapshot *vector_snapshot_open(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(snapshot_header)) {
+        close(fd);
+        return NULL;
+    }
+    size_t size = info.st_size;
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+
+    const snapshot_header *header = map;
+    bool valid = memcmp(header->magic, SNAPSHOT_MAGIC, 4) == 0
+        && header->byte_order == SNAPSHOT_BYTE_ORDER
+        && header->version == SNAPSHOT_VERSION
+        && (header->precision == 4 || header->precision == 8)
+        && header->dim <= MAX_LEN
+        && header->record_size == snapshot_record_size(header->precision)
+        && header->count <= (size - sizeof(snapshot_header)) / header->record_size
+        && header->count <= INT64_MAX;
+
+    vector_snapshot *self = valid ? malloc(sizeof(vector_snapshot)) : NULL;
+    if (self == NULL) {
+        munmap(map, size);
+        return NULL;
+    }
+    self->version = header->version;
+    self->dim = header->dim;
+    self->precision = header->precision;
+    self->count = header->count;
+    self->items = (char *)map + sizeof(snapshot_header);
+    self->map = map;
+    self->size = size;
+    self->checked = false;
+    return self;
+}
+
+// Records must match the header, so that no len can index past items
+static inline bool snapshot_record_valid(const vector_snapshot *self, int64_t i) {
+    const char *record = (const char *)self->items + i * snapshot_record_size(self->precision);
+    return *(const int *)record == self->dim;
+}
+
+// Record i (zero-based) as a double precision vector; NULL if i is out of range or the record is
+// corrupt
+EXPORT vector *vector_snapshot_get(const vector_snapshot *self, int64_t i, vector *result) {
+    if (i < 0 || i >= self->count || !snapshot_record_valid(self, i)) return NULL;
+    if (self->precision == 8) {
+        *result = ((const vector *)self->items)[i];
+    } else {
+        const vectorf *record = &((const vectorf *)self->items)[i];
+        result->len = record->len;
+        for (int c = 0; c < record->len; c++) result->items[c] = record->items[c];
+    }
+    return result;
+}
+
+// Checks every record once before the caller uses the mapping directly; false if any is corrupt
+EXPORT bool vector_snapshot_check(vector_snapshot *self) {
+    for (int64_t i = 0; !self->checked && i < self->count; i++) {
+        if (!snapshot_record_valid(self, i)) return false;
+    }
+    self->checked = true;
+    return true;
+}
+
+// Until the writer is closed the magic stays zeroed, so unfinished files never load
+static bool snapshot_write_header(vector_snapshot_writer *self, bool complete) {
+    snapshot_header header = {
+        .byte_order = SNAPSHOT_BYTE_ORDER,
+        .version = SNAPSHOT_VERSION,
+        .precision = self->precision,
+        .dim = self->dim,
+        .record_size = snapshot_record_size(self->precision),
+        .count = self->count,
+    };
+    if (complete) memcpy(header.magic, SNAPSHOT_MAGIC, 4);
+    return fseek(self->file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, self->file) == 1;
+}
+
+// Starts a snapshot of vectors of length `dim` stored with `precision` 4 or 8; NULL on bad
+// arguments or if the file can not be created
+EXPORT vector_snapshot_writer *vector_snapshot_writer_open(const char *path, int32_t dim, int32_t precision) {
+    if (dim < 0 || dim > MAX_LEN || (precision != 4 && precision != 8)) return NULL;
+
+    vector_snapshot_writer *self = calloc(1, sizeof(vector_snapshot_writer));
+    if (self == NULL) return NULL;
+    self->dim = dim;
+    self->precision = precision;
+    self->file = fopen(path, "wb");
+    if (self->file == NULL || !snapshot_write_header(self, false)) {
+        if (self->file != NULL) fclose(self->file);
+        free(self);
+        return NULL;
+    }
+    setvbuf(self->file, NULL, _IOFBF, 1 << 16);
+    return self;
+}
+
+#define SNAPSHOT_CHUNK 256
+
+// Appends `len` vectors of length dim, converting them to the snapshot precision. A batch with
+// another length is rejected as a whole; a failed write poisons the writer, and
+// vector_snapshot_writer_close reports it.
+EXPORT bool vector_snapshot_writer_write(vector_snapshot_writer *self, const vector *items, int64_t len) {
+    if (self->failed) return false;
+    for (int64_t i = 0; i < len; i++) {
+        if (items[i].len != self->dim) return false;
+    }
+
+    if (self->precision == 8) {
+        // Zero the padding and unused items so that snapshots of equal data are equal files
+        vector chunk[SNAPSHOT_CHUNK];
+        for (int64_t i = 0; i < len; i += SNAPSHOT_CHUNK) {
+            size_t n = len - i < SNAPSHOT_CHUNK ? len - i : SNAPSHOT_CHUNK;
+            memset(chunk, 0, sizeof(vector) * n);
+            for (size_t j = 0; j < n; j++) {
+                chunk[j].len = self->dim;
+                memcpy(chunk[j].items, items[i + j].items, sizeof(double) * self->dim);
+            }
+            if (fwrite(chunk, sizeof(vector), n, self->file) != n) self->failed = true;
+        }
+    } else {
+        vectorf chunk[SNAPSHOT_CHUNK];
+        for (int64_t i = 0; i < len; i += SNAPSHOT_CHUNK) {
+            size_t n = len - i < SNAPSHOT_CHUNK ? len - i : SNAPSHOT_CHUNK;
+            memset(chunk, 0, sizeof(vectorf) * n);
+            for (size_t j = 0; j < n; j++) {
+                chunk[j].len = self->dim;
+                for (int c = 0; c < self->dim; c++) chunk[j].items[c] = (float)items[i + j].items[c];
+            }
+            if (fwrite(chunk, sizeof(vectorf), n, self->file) != n) self->failed = true;
+        }
+    }
+    if (!self->failed) self->count += len;
+    return !self->failed;
+}
+
+// Finalizes the header and frees the writer; false if any write failed, in which case the file
+// holds no valid snapshot
+EXPORT bool vector_snapshot_writer_close(vector_snapshot_writer *self) {
+    bool ok = !self->failed;
+    if (ok) ok = snapshot_write_header(self, true);
+    if (fclose(self->file) != 0) ok = false;
+    free(self);
+    return ok;
+}
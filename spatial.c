@@ -0,0 +1,269 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vector.h"
+
+// Uniform spatial hash over 2D or 3D `vector` positions. Entries are addressed by caller-chosen
+// non-negative integer ids, stored in a dense array indexed by id, so ids should be small and
+// dense (0 to the number of entries) rather than arbitrary keys; each non-empty cell is an ivec_map entry pointing at the head of a
+// doubly linked list of the entries inside it. Queries touch only the cells overlapping the
+// query shape and write matching ids into a caller buffer.
+
+typedef struct {
+    double position[3];
+    int32_t cell[3];
+    int32_t next;
+    int32_t prev;
+    bool used;
+} spatial_entry;
+
+typedef struct {
+    int dim;
+    double cell_size;
+    int32_t capacity;
+    int32_t count;
+    spatial_entry *entries;
+    ivec_map *cells;
+} spatial_hash;
+
+EXPORT spatial_hash *spatial_hash_new(int dim, double cell_size) {
+    if ((dim != 2 && dim != 3) || !(cell_size > 0)) return NULL;
+
+    spatial_hash *self = calloc(1, sizeof(spatial_hash));
+    if (self == NULL) return NULL;
+    self->cells = ivec_map_new(dim, 0);
+    if (self->cells == NULL) {
+        free(self);
+        return NULL;
+    }
+    self->dim = dim;
+    self->cell_size = cell_size;
+    return self;
+}
+
+EXPORT void spatial_hash_free(spatial_hash *self) {
+    if (self == NULL) return;
+    ivec_map_free(self->cells);
+    free(self->entries);
+    free(self);
+}
+
+EXPORT int32_t spatial_hash_count(const spatial_hash *self) {
+    return self->count;
+}
+
+static inline int32_t spatial_cell_of(const spatial_hash *self, double x) {
+    double cell = floor(x / self->cell_size);
+    if (cell < INT32_MIN) return INT32_MIN;
+    if (cell > INT32_MAX) return INT32_MAX;
+    return (int32_t)cell;
+}
+
+static inline bool spatial_has(const spatial_hash *self, int32_t id) {
+    return id >= 0 && id < self->capacity && self->entries[id].used;
+}
+
+// Ids up to INT32_MAX - 1, so that the capacity stays representable
+static bool spatial_reserve(spatial_hash *self, int32_t id) {
+    if (id < self->capacity) return true;
+    if (id == INT32_MAX) return false;
+
+    int64_t capacity = self->capacity > 0 ? self->capacity : 64;
+    while (capacity <= id) capacity *= 2;
+    if (capacity > INT32_MAX) capacity = INT32_MAX;
+
+    spatial_entry *entries = realloc(self->entries, sizeof(spatial_entry) * capacity);
+    if (entries == NULL) return false;
+    memset(entries + self->capacity, 0, sizeof(spatial_entry) * (capacity - self->capacity));
+    self->entries = entries;
+    self->capacity = capacity;
+    return true;
+}
+
+static inline bool spatial_finite(const spatial_hash *self, const vector *position) {
+    for (int c = 0; c < self->dim; c++) {
+        if (!isfinite(position->items[c])) return false;
+    }
+    return true;
+}
+
+static bool spatial_link(spatial_hash *self, int32_t id) {
+    spatial_entry *entry = &self->entries[id];
+    int64_t head;
+    entry->prev = -1;
+    entry->next = ivec_map_get(self->cells, entry->cell, &head) ? (int32_t)head : -1;
+    if (!ivec_map_set(self->cells, entry->cell, id)) return false;
+    if (entry->next != -1) self->entries[entry->next].prev = id;
+    return true;
+}
+
+static void spatial_unlink(spatial_hash *self, int32_t id) {
+    spatial_entry *entry = &self->entries[id];
+    if (entry->next != -1) self->entries[entry->next].prev = entry->prev;
+    if (entry->prev != -1) {
+        self->entries[entry->prev].next = entry->next;
+    } else if (entry->next != -1) {
+        ivec_map_set(self->cells, entry->cell, entry->next);
+    } else {
+        ivec_map_remove(self->cells, entry->cell);
+    }
+}
+
+// Moves the entry if the id is already present; false on bad id/dimension, a non-finite position
+// or allocation failure
+EXPORT bool spatial_hash_insert(spatial_hash *self, int32_t id, const vector *position) {
+    if (id < 0 || position->len != self->dim || !spatial_finite(self, position)) return false;
+    if (spatial_has(self, id)) {
+        spatial_unlink(self, id);
+        self->count--;
+        self->entries[id].used = false;
+    }
+    if (!spatial_reserve(self, id)) return false;
+
+    spatial_entry *entry = &self->entries[id];
+    memset(entry->cell, 0, sizeof(entry->cell));
+    for (int c = 0; c < self->dim; c++) {
+        entry->position[c] = position->items[c];
+        entry->cell[c] = spatial_cell_of(self, position->items[c]);
+    }
+    if (!spatial_link(self, id)) return false;
+    entry->used = true;
+    self->count++;
+    return true;
+}
+
+// Relinks only when the entry crosses a cell boundary
+EXPORT bool spatial_hash_move(spatial_hash *self, int32_t id, const vector *position) {
+    if (!spatial_has(self, id) || position->len != self->dim || !spatial_finite(self, position)) {
+        return false;
+    }
+
+    spatial_entry *entry = &self->entries[id];
+    int32_t cell[3] = {0, 0, 0};
+    for (int c = 0; c < self->dim; c++) {
+        entry->position[c] = position->items[c];
+        cell[c] = spatial_cell_of(self, position->items[c]);
+    }
+    if (memcmp(cell, entry->cell, sizeof(cell)) == 0) return true;
+
+    spatial_unlink(self, id);
+    memcpy(entry->cell, cell, sizeof(cell));
+    if (!spatial_link(self, id)) {
+        entry->used = false;
+        self->count--;
+        return false;
+    }
+    return true;
+}
+
+EXPORT bool spatial_hash_remove(spatial_hash *self, int32_t id) {
+    if (!spatial_has(self, id)) return false;
+    spatial_unlink(self, id);
+    self->entries[id].used = false;
+    self->count--;
+    return true;
+}
+
+EXPORT void spatial_hash_clear(spatial_hash *self) {
+    ivec_map_clear(self->cells);
+    memset(self->entries, 0, sizeof(spatial_entry) * self->capacity);
+    self->count = 0;
+}
+
+typedef struct {
+    bool is_radius;
+    double center[3];
+    double radius2;
+    double min[3];
+    double max[3];
+} spatial_query;
+
+static inline bool spatial_query_matches(const spatial_hash *self, const spatial_query *query, const spatial_entry *entry) {
+    if (query->is_radius) {
+        double distance2 = 0;
+        for (int c = 0; c < self->dim; c++) {
+            double d = entry->position[c] - query->center[c];
+            distance2 += d * d;
+        }
+        return distance2 <= query->radius2;
+    }
+    for (int c = 0; c < self->dim; c++) {
+        if (entry->position[c] < query->min[c] || entry->position[c] > query->max[c]) return false;
+    }
+    return true;
+}
+
+// Visits the cells overlapping [min, max]; falls back to a linear scan when there are more
+// cells to visit than entries. Returns the total number of matches, writing up to `capacity`.
+static int32_t spatial_run(const spatial_hash *self, const spatial_query *query, int32_t *result, int32_t capacity) {
+    int32_t lo[3] = {0, 0, 0}, hi[3] = {0, 0, 0};
+    double cells_n = 1;
+    for (int c = 0; c < self->dim; c++) {
+        // Also rejects NaN bounds, which have no cell
+        if (!(query->min[c] <= query->max[c])) return 0;
+        lo[c] = spatial_cell_of(self, query->min[c]);
+        hi[c] = spatial_cell_of(self, query->max[c]);
+        cells_n *= (double)hi[c] - lo[c] + 1;
+    }
+
+    int32_t found = 0;
+    if (cells_n > self->count) {
+        for (int32_t id = 0; id < self->capacity; id++) {
+            if (self->entries[id].used && spatial_query_matches(self, query, &self->entries[id])) {
+                if (found < capacity) result[found] = id;
+                found++;
+            }
+        }
+        return found;
+    }
+
+    int32_t cell[3];
+    for (int64_t z = lo[2]; z <= hi[2]; z++) {
+        cell[2] = (int32_t)z;
+        for (int64_t y = lo[1]; y <= hi[1]; y++) {
+            cell[1] = (int32_t)y;
+            for (int64_t x = lo[0]; x <= hi[0]; x++) {
+                cell[0] = (int32_t)x;
+                int64_t head;
+                if (!ivec_map_get(self->cells, cell, &head)) continue;
+                for (int32_t id = (int32_t)head; id != -1; id = self->entries[id].next) {
+                    if (spatial_query_matches(self, query, &self->entries[id])) {
+                        if (found < capacity) result[found] = id;
+                        found++;
+                    }
+                }
+            }
+        }
+    }
+    return found;
+}
+
+// Ids within `radius` of `center` (inclusive); returns the total count, which may exceed capacity
+EXPORT int32_t spatial_hash_query_radius(
+    const spatial_hash *self, const vector *center, double radius, int32_t *result, int32_t capacity
+) {
+    if (center->len != self->dim || !(radius >= 0)) return 0;
+
+    spatial_query query = {.is_radius = true, .radius2 = radius * radius};
+    for (int c = 0; c < self->dim; c++) {
+        query.center[c] = center->items[c];
+        query.min[c] = center->items[c] - radius;
+        query.max[c] = center->items[c] + radius;
+    }
+    return spatial_run(self, &query, result, capacity);
+}
+
+// Ids inside the box [min, max] (inclusive); returns the total count, which may exceed capacity
+EXPORT int32_t spatial_hash_query_aabb(
+    const spatial_hash *self, const vector *min, const vector *max, int32_t *result, int32_t capacity
+) {
+    if (min->len != self->dim || max->len != self->dim) return 0;
+
+    spatial_query query = {.is_radius = false};
+    for (int c = 0; c < self->dim; c++) {
+        query.min[c] = min->items[c];
+        query.max[c] = max->items[c];
+    }
+    return spatial_run(self, &query, result, capacity);
+}
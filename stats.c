@@ -0,0 +1,66 @@
+#include "vector.h"
+
+// Registry behind VECTOR_STAT: records link themselves in on their first call. Counters are plain
+// integers, so instrumented functions should only be called from one thread at a time. Without
+// VECTOR_STATS the API is still exported and reports nothing.
+
+#ifdef VECTOR_STATS
+
+static vector_stat *stat_head = NULL;
+static int32_t stat_count = 0;
+
+void vector_stat_register(vector_stat *stat) {
+    stat->registered = true;
+    stat->next = stat_head;
+    stat_head = stat;
+    stat_count++;
+}
+
+EXPORT bool vector_stats_enabled(void) {
+    return true;
+}
+
+EXPORT int32_t vector_stats_count(void) {
+    return stat_count;
+}
+
+// Functions in reverse order of their first call; false if i is out of range
+EXPORT bool vector_stats_get(int32_t i, const char **name, uint64_t *calls, uint64_t *cycles) {
+    if (i < 0 || i >= stat_count) return false;
+    vector_stat *stat = stat_head;
+    while (i-- > 0) stat = stat->next;
+    *name = stat->name;
+    *calls = stat->calls;
+    *cycles = stat->cycles;
+    return true;
+}
+
+EXPORT void vector_stats_reset(void) {
+    for (vector_stat *stat = stat_head; stat != NULL; stat = stat->next) {
+        stat->calls = 0;
+        stat->cycles = 0;
+    }
+}
+
+#else
+
+EXPORT bool vector_stats_enabled(void) {
+    return false;
+}
+
+EXPORT int32_t vector_stats_count(void) {
+    return 0;
+}
+
+EXPORT bool vector_stats_get(int32_t i, const char **name, uint64_t *calls, uint64_t *cycles) {
+    (void)i;
+    (void)name;
+    (void)calls;
+    (void)cycles;
+    return false;
+}
+
+EXPORT void vector_stats_reset(void) {
+}
+
+#endif
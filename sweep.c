@@ -0,0 +1,198 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "vector.h"
+
+// Incremental sweep-and-prune broad phase over 2D or 3D axis-aligned boxes given as min/max
+// `vector`s. Box i of the latest update is identified by i. The order of boxes along the sweep axis
+// survives between updates and is repaired with insertion sort, which is close to linear when
+// boxes move a little per frame; larger changes fall back to a full merge sort.
+
+// Box extent along the sweep axis, kept next to the order so that the sweep reads memory linearly
+typedef struct {
+    double min;
+    double max;
+    int32_t box;
+} sweep_entry;
+
+typedef struct {
+    int dim;
+    int axis;
+    int32_t len;
+    int32_t capacity;
+    double *min;
+    double *max;
+    sweep_entry *order;
+    sweep_entry *scratch;
+} sweep_prune;
+
+EXPORT sweep_prune *sweep_prune_new(int dim) {
+    if (dim != 2 && dim != 3) return NULL;
+    sweep_prune *self = calloc(1, sizeof(sweep_prune));
+    if (self == NULL) return NULL;
+    self->dim = dim;
+    return self;
+}
+
+EXPORT void sweep_prune_free(sweep_prune *self) {
+    if (self == NULL) return;
+    free(self->min);
+    free(self->max);
+    free(self->order);
+    free(self->scratch);
+    free(self);
+}
+
+EXPORT int32_t sweep_prune_len(const sweep_prune *self) {
+    return self->len;
+}
+
+static bool sweep_reserve(sweep_prune *self, int32_t len) {
+    if (len <= self->capacity) return true;
+
+    int32_t capacity = self->capacity > 0 ? self->capacity : 64;
+    while (capacity < len) capacity = capacity > INT32_MAX / 2 ? INT32_MAX : capacity * 2;
+
+    double *min = realloc(self->min, sizeof(double) * self->dim * capacity);
+    if (min != NULL) self->min = min;
+    double *max = realloc(self->max, sizeof(double) * self->dim * capacity);
+    if (max != NULL) self->max = max;
+    sweep_entry *order = realloc(self->order, sizeof(sweep_entry) * capacity);
+    if (order != NULL) self->order = order;
+    sweep_entry *scratch = realloc(self->scratch, sizeof(sweep_entry) * capacity);
+    if (scratch != NULL) self->scratch = scratch;
+    if (min == NULL || max == NULL || order == NULL || scratch == NULL) return false;
+
+    self->capacity = capacity;
+    return true;
+}
+
+// Refreshes the axis extents of the entries from the current boxes, keeping their order
+static void sweep_refresh(sweep_prune *self) {
+    for (int32_t i = 0; i < self->len; i++) {
+        sweep_entry *entry = &self->order[i];
+        entry->min = self->min[(size_t)entry->box * self->dim + self->axis];
+        entry->max = self->max[(size_t)entry->box * self->dim + self->axis];
+    }
+}
+
+static void sweep_merge_sort(sweep_prune *self) {
+    sweep_entry *from = self->order, *to = self->scratch;
+    for (int32_t width = 1; width < self->len; width *= 2) {
+        for (int32_t lo = 0; lo < self->len; lo += 2 * width) {
+            int32_t middle = lo + width < self->len ? lo + width : self->len;
+            int32_t hi = lo + 2 * width < self->len ? lo + 2 * width : self->len;
+            int32_t a = lo, b = middle, k = lo;
+            while (a < middle && b < hi) {
+                to[k++] = from[b].min < from[a].min ? from[b++] : from[a++];
+            }
+            while (a < middle) to[k++] = from[a++];
+            while (b < hi) to[k++] = from[b++];
+        }
+        sweep_entry *tmp = from;
+        from = to;
+        to = tmp;
+    }
+    if (from != self->order) memcpy(self->order, from, sizeof(sweep_entry) * self->len);
+}
+
+// Insertion sort with a budget of moves; false if the order changed too much for it
+static bool sweep_insertion_sort(sweep_prune *self) {
+    int64_t budget = 8 * (int64_t)self->len + 64;
+    for (int32_t i = 1; i < self->len; i++) {
+        sweep_entry entry = self->order[i];
+        int32_t j = i;
+        while (j > 0 && self->order[j - 1].min > entry.min) {
+            self->order[j] = self->order[j - 1];
+            j--;
+            if (--budget < 0) {
+                self->order[j] = entry;
+                return false;
+            }
+        }
+        self->order[j] = entry;
+    }
+    return true;
+}
+
+// The axis along which box centers spread the most separates boxes best
+static int sweep_best_axis(const sweep_prune *self) {
+    double spread[3] = {0, 0, 0};
+    for (int c = 0; c < self->dim; c++) {
+        double lo = 0, hi = 0;
+        for (int32_t i = 0; i < self->len; i++) {
+            double center = self->min[(size_t)i * self->dim + c] + self->max[(size_t)i * self->dim + c];
+            if (i == 0 || center < lo) lo = center;
+            if (i == 0 || center > hi) hi = center;
+        }
+        spread[c] = hi - lo;
+    }
+
+    int axis = 0;
+    for (int c = 1; c < self->dim; c++) {
+        if (spread[c] > spread[axis]) axis = c;
+    }
+    return axis;
+}
+
+// Replaces the boxes with `len` new ones; when the count is unchanged the previous order is
+// reused. False on a dimension mismatch or allocation failure, leaving the state unchanged.
+EXPORT bool sweep_prune_update(sweep_prune *self, const vector *min, const vector *max, int32_t len) {
+    if (len < 0) return false;
+    for (int32_t i = 0; i < len; i++) {
+        if (min[i].len != self->dim || max[i].len != self->dim) return false;
+    }
+    if (!sweep_reserve(self, len)) return false;
+
+    for (int32_t i = 0; i < len; i++) {
+        memcpy(self->min + (size_t)i * self->dim, min[i].items, sizeof(double) * self->dim);
+        memcpy(self->max + (size_t)i * self->dim, max[i].items, sizeof(double) * self->dim);
+    }
+
+    // A different count means different boxes, so the old order says nothing about them
+    if (len != self->len) {
+        self->len = len;
+        for (int32_t i = 0; i < len; i++) self->order[i].box = i;
+        self->axis = sweep_best_axis(self);
+        sweep_refresh(self);
+        sweep_merge_sort(self);
+        return true;
+    }
+    sweep_refresh(self);
+    if (!sweep_insertion_sort(self)) {
+        self->axis = sweep_best_axis(self);
+        sweep_refresh(self);
+        sweep_merge_sort(self);
+    }
+    return true;
+}
+
+static inline bool sweep_overlap(const sweep_prune *self, int32_t a, int32_t b) {
+    const double *min_a = self->min + (size_t)a * self->dim, *max_a = self->max + (size_t)a * self->dim;
+    const double *min_b = self->min + (size_t)b * self->dim, *max_b = self->max + (size_t)b * self->dim;
+    for (int c = 0; c < self->dim; c++) {
+        if (min_a[c] > max_b[c] || min_b[c] > max_a[c]) return false;
+    }
+    return true;
+}
+
+// Overlapping pairs (touching counts) as result[2k] < result[2k + 1], up to `capacity` pairs, in
+// sweep order; returns the total number of pairs, which may exceed capacity
+EXPORT int32_t sweep_prune_pairs(const sweep_prune *self, int32_t *result, int32_t capacity) {
+    int32_t found = 0;
+    for (int32_t i = 0; i < self->len; i++) {
+        int32_t a = self->order[i].box;
+        double end = self->order[i].max;
+        for (int32_t j = i + 1; j < self->len && self->order[j].min <= end; j++) {
+            int32_t b = self->order[j].box;
+            if (!sweep_overlap(self, a, b)) continue;
+
+            if (found < capacity) {
+                result[2 * found] = a < b ? a : b;
+                result[2 * found + 1] = a < b ? b : a;
+            }
+            found++;
+        }
+    }
+    return found;
+}
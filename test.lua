@@ -1,5 +1,9 @@
 local vector = require("vector")
 
+-- Buffers, arrays and the C modules need FFI; the C API backend covers single vectors and the
+-- batch functions over Lua sequences, which return zero-based tables instead of buffers
+local ffi_backend = vector.backend == "ffi"
+
 do
   print("Equality")
   local v = vector.new(1, 2, 3)
@@ -12,20 +16,45 @@ do
   assert(v ~= m)
 end
 
--- do
---   print("Initialization and field access")
---   local v = vector.new(10, 20)
---   assert(v.items[0] == 10)
---   assert(v.y == 20)
---   v.items[0] = 20
---   assert(v.items[0] == 20)
--- 
---   local u = vector.new(1, 2, 3, 4)
---   assert(u.z == 3)
---   assert(u.a == 4)
---   u.r = 3
---   assert(u.items[0] == 3)
--- end
+do
+  print("Initialization and field access")
+  local v = vector.new(10, 20)
+  assert(v.items[0] == 10)
+  assert(v.y == 20)
+  v.items[0] = 20
+  assert(v.items[0] == 20)
+  v.items[1] = 42
+  assert(v.items[1] == 42 and v.y == 42)
+  assert(vector.new(7, 8).items[2] == 0)
+
+  local u = vector.new(1, 2, 3, 4)
+  assert(u.z == 3)
+  assert(u.a == 4)
+  u.r = 3
+  assert(u.items[0] == 3)
+end
+
+do
+  print("Swizzles")
+  local v = vector.new(1, 2, 3)
+  assert(v.zyx == vector.new(3, 2, 1))
+  assert(v.xxy == vector.new(1, 1, 2))
+  assert(v.rg == vector.new(1, 2))
+  assert(v.w == nil and v.xw == nil and v.xg == nil)
+  assert(v:swizzle("yz") == vector.new(2, 3))
+
+  v.xy = v.yx
+  assert(v == vector.new(2, 1, 3))
+  v.b = 5
+  assert(v.z == 5)
+  assert(not pcall(function() v.xx = vector.new(1, 2) end))
+  assert(not pcall(function() v.w = 1 end))
+
+  if ffi_backend then
+    local f = vector.newf(0.5, 1)
+    assert(f.yx == vector.newf(1, 0.5))
+  end
+end
 
 do
   print("__tostring")
@@ -173,3 +202,622 @@ end
 --   assert(v[3] == 3)
 --   assert(v[4] == 7)
 -- end
+
+if ffi_backend then
+  print("Array")
+  local positions = vector.array(3, 2)
+  local velocities = vector.array(3, 2)
+  assert(#positions == 3)
+  for i = 1, 3 do
+    positions:set(i, vector.new(i, 0))
+    velocities:set(i, vector.new(0, 2 * i))
+  end
+
+  positions:add_scaled_mut(velocities, 0.5)
+  assert(positions:get(2) == vector.new(2, 2))
+
+  positions:add_mut(velocities):sub_mut(velocities):mul_mut(2)
+  assert(positions:get(3) == vector.new(6, 6))
+
+  local lengths = vector.array(1, 2):set(1, vector.new(3, 4)):abs()
+  assert(lengths[0] == 5)
+
+  velocities:normalized_mut()
+  assert(velocities:get(1) == vector.new(0, 1))
+
+  assert(not pcall(positions.add_mut, positions, vector.array(3, 3)))
+  assert(not pcall(positions.add_scaled_mut, positions, vector.array(2, 2), 1))
+  assert(rawequal(positions:mul_mut(1), positions))
+  assert(vector.array(2, 2):add_mut(vector.array(2, 2)):get(1) == vector.new(0, 0))
+end
+
+if ffi_backend then
+  print("SIMD")
+  local detected = vector.simd()
+  local reference
+  for _, name in ipairs({"scalar", "sse2", "avx2"}) do
+    if vector.set_simd(name) then
+      assert(vector.simd() == name)
+      local a = vector.array(7, 3)
+      for i = 1, 7 do
+        a:set(i, vector.new(i / 3, -i * 1.1, i % 2))
+      end
+      a:add_scaled_mut(a, 0.7):normalized_mut()
+      local lengths = a:abs()
+      local result = {}
+      for i = 1, 7 do
+        result[i] = tostring(a:get(i)) .. lengths[i - 1]
+      end
+      result = table.concat(result)
+      reference = reference or result
+      assert(result == reference)
+    end
+  end
+  assert(vector.set_simd(detected))
+end
+
+do
+  print("Into")
+  local a = vector.new(1, 2)
+  local b = vector.new(3, 5)
+  local out = vector.new()
+
+  a:add_into(b, out)
+  assert(out == vector.new(4, 7))
+  a:sub_into(b, out)
+  assert(out == vector.new(-2, -3))
+  a:mul_into(3, out)
+  assert(out == vector.new(3, 6))
+  b:div_into(2, out)
+  assert(out == vector.new(1.5, 2.5))
+  b:mod_into(3, out)
+  assert(out == vector.new(0, 2))
+  a:unm_into(out)
+  assert(out == vector.new(-1, -2))
+  vector.new(0, -3):normalized_into(out)
+  assert(out == vector.new(0, -1))
+  vector.new(2, -3):normalized2_into(out)
+  assert(out == vector.new(0, -1))
+  b:copy_into(out)
+  assert(out == b)
+
+  a:sub_into(b, b)
+  assert(b == vector.new(-2, -3))
+  assert(a == vector.new(1, 2))
+  assert(-a == vector.new(-1, -2))
+end
+
+if ffi_backend then
+  print("Single precision")
+  local v = vector.newf(1, 2, 3)
+  assert(v + vector.newf(1, 1, 1) == vector.newf(2, 3, 4))
+  assert(v * 2 - v == v)
+  assert(-v == vector.newf(-1, -2, -3))
+  assert(vector.newf(3, 4):abs() == 5)
+  assert(vector.newf(0, -3):normalized() == vector.newf(0, -1))
+  assert(tostring(vector.newf(0.5, 2)) == "{0.5; 2}")
+  assert(vector.hexf("ff00ff") == vector.newf(1, 0, 1))
+
+  assert(v:to_vector() == vector.new(1, 2, 3))
+  assert(vector.new(1.5, 2):to_vectorf() == vector.newf(1.5, 2))
+  v:map_mut(function(x) return x * 10 end)
+  assert(v == vector.newf(10, 20, 30))
+end
+
+if ffi_backend then
+  print("Fixed-width vectors")
+  local v = vector.vec(1, 2)
+  assert(#v == 2)
+  assert(v == vector.vec2(1, 2))
+  assert(v + vector.vec2(2, 3) == vector.vec2(3, 5))
+  assert(v * 2 - v == v)
+  assert(-v == vector.vec2(-1, -2))
+  assert(vector.vec2(3, 4):abs() == 5)
+  assert(vector.vec2(2, -3):normalized2() == vector.vec2(0, -1))
+  assert(tostring(vector.vec3(1, 2, 3)) == "{1; 2; 3}")
+
+  local x, y, z, w = vector.vec(1, 3, 3, 7):unpack()
+  assert(x == 1 and y == 3 and z == 3 and w == 7)
+
+  assert(vector.vec3(1, 2, 3):to_vector() == vector.new(1, 2, 3))
+  assert(vector.new(1, 2, 3, 4):to_vec() == vector.vec4(1, 2, 3, 4))
+end
+
+if ffi_backend then
+  print("Integer vectors and map")
+  local a = vector.ivec2(3, -4)
+  assert(a == vector.ivec2(3, -4))
+  assert(a:hash() == vector.ivec2(3, -4):hash())
+  assert(a + vector.ivec2(1, 1) == vector.ivec2(4, -3))
+  assert(vector.new(2.5, -0.5):to_ivec() == vector.ivec2(2, -1))
+
+  local map = vector.ivec_map(2)
+  for x = 1, 100 do
+    map:set(vector.ivec2(x, -x), x * 10)
+  end
+  assert(#map == 100)
+  assert(map:get(vector.ivec2(42, -42)) == 420)
+  assert(map:get(vector.ivec2(42, 42)) == nil)
+  assert(map:remove(vector.ivec2(42, -42)))
+  assert(not map:has(vector.ivec2(42, -42)))
+  assert(map:get(vector.ivec2(43, -43)) == 430)
+  assert(not pcall(map.get, map, vector.ivec3(43, -43, 0)))
+  assert(not pcall(map.set, map, vector.new(1, 2), 1))
+
+  local sum = 0
+  for key, value in map:each() do
+    assert(value == key.items[0] * 10)
+    sum = sum + value
+  end
+  assert(sum == 50500 - 420)
+
+  map:clear()
+  assert(#map == 0)
+  assert(not pcall(vector.ivec_map, 2, 2 ^ 63))
+end
+
+if ffi_backend then
+  print("Spatial hash")
+  local grid = vector.spatial_hash(4)
+  for i = 1, 100 do
+    grid:insert(i, vector.new(i, i % 10))
+  end
+  assert(#grid == 100)
+
+  local buffer = vector.id_buffer(16)
+  local result, n, total = grid:query_radius(vector.new(50, 0), 0.5, buffer, 16)
+  assert(rawequal(result, buffer))
+  assert(n == 1 and total == 1 and buffer[0] == 50)
+
+  grid:move(50, vector.new(1000, 1000))
+  local _, n_after = grid:query_radius(vector.new(50, 0), 0.5, buffer, 16)
+  assert(n_after == 0)
+  assert(not pcall(grid.query_radius, grid, vector.new(50, 0), 0.5, buffer))
+
+  local ids, count = grid:query_aabb(vector.new(0, 0), vector.new(20, 2))
+  assert(count == 6)
+  for i = 0, count - 1 do
+    assert(ids[i] % 10 <= 2)
+  end
+
+  assert(grid:remove(1))
+  assert(not grid:remove(1))
+  assert(#grid == 99)
+
+  assert(not pcall(grid.insert, grid, 2147483647, vector.new(0, 0)))
+  assert(not pcall(grid.insert, grid, 1, vector.new(0 / 0, 0)))
+  assert(not grid:move(2, vector.new(1 / 0, 0)))
+  local _, n_nan = grid:query_aabb(vector.new(0 / 0, 0), vector.new(20, 2), buffer, 16)
+  assert(n_nan == 0 and #grid == 99)
+end
+
+if ffi_backend then
+  print("k-d tree")
+  local points = {}
+  for x = 0, 9 do
+    for y = 0, 9 do
+      table.insert(points, vector.new(x, y))
+    end
+  end
+  local tree = vector.kd_tree(points)
+  assert(#tree == 100)
+
+  local i, distance = tree:nearest(vector.new(3.2, 6.9))
+  assert(points[i] == vector.new(3, 7))
+  assert(math.abs(distance - math.sqrt(0.05)) < 1e-12)
+
+  local nearest, n, distances = tree:k_nearest(vector.new(0, 0), 3)
+  assert(n == 3)
+  assert(points[nearest[0] + 1] == vector.new(0, 0))
+  assert(distances[1] == 1 and distances[2] == 1)
+
+  local _, inside = tree:radius(vector.new(5, 5), 1)
+  assert(inside == 5)
+  -- Large radii descend into every leaf range
+  assert(select(2, tree:radius(vector.new(4.5, 4.5), 100)) == 100)
+  local small = vector.kd_tree({vector.new(0, 0), vector.new(1, 2), vector.new(2, 1)})
+  assert(select(2, small:radius(vector.new(1, 1), 5)) == 3)
+  assert(not pcall(small.radius, small, vector.new(1, 1), 5, vector.id_buffer(3)))
+
+  local batch = tree:nearest_batch({vector.new(-1, -1), vector.new(20, 20)})
+  assert(points[batch[0] + 1] == vector.new(0, 0))
+  assert(points[batch[1] + 1] == vector.new(9, 9))
+end
+
+if ffi_backend then
+  print("Matrices")
+  local m = vector.mat3_compose(10, 20, math.pi / 2, 2, 3)
+  local p = m * vector.new(1, 1)
+  assert(math.abs(p.items[0] - 7) < 1e-12 and math.abs(p.items[1] - 22) < 1e-12)
+
+  local identity = m * m:inverse()
+  for i = 0, 8 do
+    assert(math.abs(identity.items[i] - vector.mat3().items[i]) < 1e-12)
+  end
+  assert(vector.mat2(1, 2, 2, 4):inverse() == nil)
+  assert(vector.mat2(1, 2, 3, 4):transpose() == vector.mat2(1, 3, 2, 4))
+  assert(vector.mat3_translation(1, 2) * vector.mat3_translation(3, 4) == vector.mat3_translation(4, 6))
+
+  local points = vector.mat3_translation(1, 2):transform_points({vector.new(0, 0), vector.new(1, 1)})
+  assert(points[0] == vector.new(1, 2) and points[1] == vector.new(2, 3))
+
+  local array = vector.array(2, 2):set(1, vector.new(1, 0)):set(2, vector.new(0, 1))
+  vector.mat2(0, -1, 1, 0):transform_array(array, array)
+  assert(array:get(1) == vector.new(0, 1) and array:get(2) == vector.new(-1, 0))
+
+  local q = vector.mat4_translation(1, 2, 3) * vector.new(1, 1, 1)
+  assert(q == vector.new(2, 3, 4))
+end
+
+do
+  print("Fused operations")
+  local a = vector.new(1, 2)
+  local b = vector.new(3, 6)
+  assert(a:madd(b, 2) == vector.new(7, 14))
+  assert(vector.axpy(2, a, b) == vector.new(5, 10))
+  assert(a:lerp(b, 0.5) == vector.new(2, 4))
+  assert(a:fma(b, a) == vector.new(4, 14))
+  assert(vector.new(-1, 5):clamp(vector.zero, vector.new(3, 3)) == vector.new(0, 3))
+end
+
+if ffi_backend then
+  print("Lazy expressions")
+  local pos = vector.new(1, 1)
+  local vel = vector.new(2, 4)
+  local e = vector.lazy(vel) * 0.5 + pos
+  assert(e:eval() == vector.new(2, 3))
+  assert((pos - vector.lazy(vel) / 2):eval() == vector.new(0, -1))
+  assert((-vector.lazy(pos) + vel):eval() == vector.new(1, 3))
+  assert((vector.lazy(pos) + vector.lazy(vel) * 2):eval() == vector.new(5, 9))
+  assert((2 * (vel - vector.lazy(pos))):eval() == vector.new(2, 6))
+  ;(vector.lazy(vel) * 0.5 + pos):eval(pos)
+  assert(pos == vector.new(2, 3))
+
+  -- An abandoned expression fails the next evaluation once
+  local _ = vector.lazy(vel) * 2
+  assert(not pcall(function() return (vector.lazy(pos) + vel):eval() end))
+  assert((vector.lazy(pos) + vel):eval() == vector.new(4, 7))
+  assert(not pcall(function() return vector.lazy(pos) * vel end))
+  assert((vector.lazy(pos) - vel):eval() == vector.new(0, -1))
+end
+
+if ffi_backend then
+  print("Pathfinding")
+  -- . # .
+  -- . # .
+  -- . . .
+  local costs = vector.cost_grid(3, 3)
+  costs[1] = -1
+  costs[4] = math.huge
+  local pathfinder = vector.pathfinder(3, 3)
+
+  local steps, n = pathfinder:astar(costs, vector.new(0, 0), vector.new(2, 0))
+  assert(n == 6)
+  local names = vector.path_names(steps, n)
+  assert(table.concat(names, " ") == "down down right right up up")
+
+  local _, diagonal_n = pathfinder:astar(costs, vector.new(0, 0), vector.new(2, 0), true)
+  assert(diagonal_n == 6)
+  assert(pathfinder:astar(costs, vector.new(0, 0), vector.new(1, 0)) == nil)
+
+  local distances = pathfinder:dijkstra(costs, {vector.new(2, 0)})
+  assert(distances[0] == 6 and distances[1] == math.huge)
+  local directions = pathfinder:flow_field(costs, distances)
+  assert(vector.extended_directions[directions[0] + 1] == vector.down)
+  assert(directions[2] == -1)
+end
+
+do
+  print("Lines")
+  local line, n = vector.line(vector.new(0, 0), vector.new(4, 2))
+  assert(n == 5 and line[0] == vector.new(0, 0) and line[4] == vector.new(4, 2))
+  local _, written, total = vector.line(vector.new(0, 0), vector.new(4, 2), line, 2)
+  assert(written == 2 and total == 5)
+end
+
+if ffi_backend then
+  print("Line of sight")
+
+  local blocking = vector.grid_mask(7, 7)
+  blocking[3 * 7 + 4] = 1
+  local origin = vector.new(2, 3)
+  assert(not vector.line_of_sight(blocking, 7, 7, origin, vector.new(6, 3)))
+  assert(vector.line_of_sight(blocking, 7, 7, origin, vector.new(4, 3)))
+  assert(vector.line_of_sight(blocking, 7, 7, origin, vector.new(6, 0)))
+
+  local hit, distance = vector.raycast(blocking, 7, 7, origin, vector.right)
+  assert(hit == vector.new(4, 3) and distance == 1.5)
+  assert(vector.raycast(blocking, 7, 7, origin, vector.right, 1) == nil)
+
+  local visible = vector.fov(blocking, 7, 7, origin)
+  assert(visible[3 * 7 + 2] == 1 and visible[3 * 7 + 4] == 1 and visible[3 * 7 + 5] == 0)
+  assert(visible[0] == 1)
+  vector.fov(blocking, 7, 7, origin, 1, visible)
+  assert(visible[0] == 0 and visible[2 * 7 + 2] == 1)
+end
+
+do
+  print("Stats")
+  vector.reset_stats()
+  local _ = vector.new(1, 2) + vector.new(3, 4)
+  local stats = vector.stats()
+  if next(stats.functions) ~= nil then
+    assert(stats.allocations.new == 2 and stats.allocations.__add == 1)
+    assert(stats.functions.vector_add_into.calls == 1)
+  end
+end
+
+do
+  print("Saving")
+  local path = os.tmpname()
+  vector.save(path, {vector.new(1, 2), vector.new(3, 4)}, nil, 4)
+  local file = io.open(path, "rb")
+  assert(file:read(4) == "VSNP" and file:seek("end") == 64 + 2 * 20)
+  file:close()
+  assert(not pcall(vector.save, path, {vector.new(1, 2), vector.new(1, 2, 3)}))
+  os.remove(path)
+end
+
+if ffi_backend then
+  print("Snapshots")
+  local path = os.tmpname()
+  vector.save(path, {vector.new(1, 2), vector.new(3, 4)})
+  local snapshot = vector.load(path)
+  assert(#snapshot == 2 and snapshot.dim == 2 and snapshot.precision == 8)
+  assert(snapshot:vectors()[1] == vector.new(3, 4))
+  assert(snapshot:get(2) == vector.new(3, 4) and not pcall(snapshot.get, snapshot, 3))
+  snapshot:close()
+
+  -- A corrupt record fails when it is read, not when the file is loaded
+  local file = io.open(path, "r+b")
+  file:seek("set", 64 + require("ffi").sizeof("vector"))
+  file:write("\255\255\255\127")
+  file:close()
+  local corrupt = vector.load(path)
+  assert(corrupt:get(1) == vector.new(1, 2))
+  assert(not pcall(corrupt.get, corrupt, 2) and not pcall(corrupt.vectors, corrupt))
+  corrupt:close()
+
+  local writer = vector.snapshot_writer(path, 3, 4)
+  writer:write(vector.new(0.5, 1, 2))
+  assert(not pcall(writer.write, writer, vector.new(1, 2)))
+  writer:write({vector.new(3, 4, 5)})
+  writer:close()
+  local floats = vector.load(path)
+  assert(#floats == 2 and floats:vectors()[1]:to_vector() == vector.new(3, 4, 5))
+  os.remove(path)
+end
+
+do
+  print("Text form")
+  assert(tostring(vector.new(0.5, -2, 1e20)) == "{0.5; -2; 1e+20}")
+  assert(tostring(vector.new()) == "{}")
+end
+
+do
+  print("Text batches")
+  local text = vector.format({vector.new(1, 2), vector.new(0.25, 3, 4)}, nil, ", ")
+  assert(text == "{1; 2}, {0.25; 3; 4}")
+
+  local points, n = vector.parse("a = " .. text .. "; b = {oops}")
+  assert(n == 2 and points[1] == vector.new(0.25, 3, 4))
+
+  local buffer = ffi_backend and vector.buffer(4) or {}
+  local _, m, consumed = vector.parse("{1; 2} {3;", buffer, 4)
+  assert(m == 1 and consumed == 7 and buffer[0] == vector.new(1, 2))
+end
+
+do
+  print("Threads")
+  vector.set_threads(4, 1000)
+  local threads, threshold = vector.threads()
+  assert(threads == 4 and threshold == 1000)
+  vector.set_threads(1)
+  assert(vector.threads() == 1)
+end
+
+if ffi_backend then
+  print("Threaded arrays")
+  local n = 100000
+  local a = vector.array(n, 2)
+  local b = vector.array(n, 2)
+  for i = 1, n do
+    a:set(i, vector.new(i, -i))
+    b:set(i, vector.new(1, 2))
+  end
+
+  vector.set_threads(4, 1000)
+  a:add_scaled_mut(b, 0.5)
+  local abs = a:abs()
+  vector.set_threads(1)
+
+  assert(a:get(n) == vector.new(n + 0.5, -n + 1))
+  assert(abs[0] == vector.new(1.5, 0):abs())
+
+  -- Dispatching right after starting the workers must not lose any of them
+  for i = 1, 200 do
+    vector.set_threads(2 + i % 7, 1000)
+    a:mul_mut(1)
+    vector.set_threads(1)
+  end
+  assert(a:get(n) == vector.new(n + 0.5, -n + 1))
+end
+
+if ffi_backend then
+  print("Sweep and prune")
+  local sweep = vector.sweep_prune(2)
+  local mins = {vector.new(0, 0), vector.new(1, 1), vector.new(5, 0), vector.new(2, 0)}
+  local maxs = {vector.new(2, 2), vector.new(3, 3), vector.new(6, 1), vector.new(3, 0.5)}
+  sweep:update(mins, maxs)
+  assert(#sweep == 4)
+
+  local pairs_found = {}
+  local result, n = sweep:pairs()
+  for k = 0, n - 1 do
+    pairs_found[result[2 * k] .. "-" .. result[2 * k + 1]] = true
+  end
+  assert(n == 2 and pairs_found["0-1"] and pairs_found["0-3"])
+
+  mins[3] = vector.new(2.5, 0.25)
+  maxs[3] = vector.new(3.5, 1.25)
+  sweep:update(mins, maxs)
+  local _, written, total = sweep:pairs(vector.id_buffer(2), 1)
+  assert(written == 1 and total == 4)
+  assert(not pcall(sweep.update, sweep, {vector.new(1, 2, 3)}, {vector.new(1, 2, 3)}))
+end
+
+do
+  print("Easing")
+  assert(vector.ease("quad_in", 0.5) == 0.25)
+  assert(vector.ease("bounce_out", 1) == 1 and vector.ease(vector.easings.elastic_in, 0) == 0)
+  assert(vector.ease(nil, 0.25) == 0.25 and not pcall(vector.ease, "wobbly", 0.5))
+end
+
+if ffi_backend then
+  print("Tweens")
+
+  local tweens = vector.tween_engine()
+  local a = vector.new(0, 0)
+  local b = vector.new(1, 1, 1)
+  tweens:add(a, vector.new(10, 20), 1)
+  local id = tweens:add(b, vector.new(0, 0, 0), 2, "cubic_out")
+  assert(#tweens == 2)
+
+  assert(tweens:update(0.5) == 0)
+  assert(a == vector.new(5, 10))
+  assert(tweens:update(0.5) == 1)
+  assert(a == vector.new(10, 20) and #tweens == 1)
+
+  assert(tweens:cancel(id) and not tweens:cancel(id))
+  assert(#tweens == 0 and b == vector.new(0.125, 0.125, 0.125))
+  assert(not pcall(tweens.add, tweens, a, vector.new(1, 2, 3), 1))
+  assert(not pcall(tweens.add, tweens, a, vector.new(1, 2), 1, "wobbly"))
+end
+
+if ffi_backend then
+  print("Pooling")
+  vector.set_pooling(16, 4)
+  vector.reset_pool_stats()
+
+  local a = vector.new(1, 2)
+  local b = a + a
+  b:release()
+  assert(not pcall(b.release, b))
+  local c = a * 3
+  local stats = vector.pool_stats()
+  assert(stats.hits == 3 and stats.misses == 0 and stats.free == 2)
+  assert(stats.in_use == 2 and stats.peak_in_use == 2)
+  assert(c == vector.new(3, 6) and rawequal(c, b))
+
+  local kept = vector.frame_scope(function()
+    local sum = vector.new(0, 0)
+    for i = 1, 10 do
+      sum = sum + vector.new(i, i)
+    end
+    return sum
+  end)
+  assert(kept == vector.new(55, 55))
+  stats = vector.pool_stats()
+  assert(stats.free == 15 and stats.in_use == 5 and stats.peak_in_use == 24)
+  assert(not pcall(vector.frame_scope, function() error("oops") end))
+
+  local buffer = vector.buffer(1)
+  buffer[0] = vector.new(1, 1)
+  assert(not pcall(vector.up.release, vector.up))
+  assert(not pcall(buffer[0].release, buffer[0]))
+  local d = vector.new(5, 5)
+  assert(vector.up.x == 0 and vector.up.y == -1)
+  assert(buffer[0].x == 1 and buffer[0].y == 1 and d.x == 5)
+
+  -- Swizzles allocate through the pool too
+  d:release()
+  local swapped = a.yx
+  assert(rawequal(swapped, d) and swapped.x == 2 and swapped.y == 1)
+
+  vector.set_pooling(0)
+  assert(vector.pool_stats().free == 0)
+end
+
+do
+  print("Reductions")
+  local points = {vector.new(1, 2), vector.new(3, -2), vector.new(5, 6)}
+  assert(vector.sum(points) == vector.new(9, 6))
+  assert(vector.mean(points) == vector.new(3, 2))
+
+  local min, max = vector.aabb(points)
+  assert(min == vector.new(1, -2) and max == vector.new(5, 6))
+
+  local variance, mean = vector.variance({vector.new(1, 2), vector.new(3, 6)})
+  assert(variance == vector.new(1, 4) and mean == vector.new(2, 4))
+  local covariance = vector.covariance({vector.new(1, 2), vector.new(3, 6)})
+  assert(covariance.items[1] == 2 and covariance.items[3] == 4)
+
+  local n = 100000
+  local many = {}
+  for i = 1, n do
+    many[i] = vector.new(0.1, 1)
+  end
+  assert(math.abs(vector.sum(many).x - 10000) < 1e-9)
+  if ffi_backend then
+    local buffer = vector.buffer(n)
+    for i = 0, n - 1 do
+      buffer[i] = many[i + 1]
+    end
+    assert(vector.sum(buffer, n) == vector.sum(many))
+  end
+  assert(not pcall(vector.sum, {vector.new(1, 2), vector.new(1, 2, 3)}))
+  assert(not pcall(vector.mean, {}))
+end
+
+do
+  print("Products and distances")
+  local a = vector.new(3, 4)
+  local b = vector.new(-4, 3)
+  assert(a:dot(b) == 0 and a:cross(b) == 25)
+  assert(vector.new(1, 0, 0):cross(vector.new(0, 1, 0)) == vector.new(0, 0, 1))
+  assert(not pcall(a.cross, a, vector.new(1, 2, 3)))
+  assert(vector.zero:dist(a) == 5 and vector.zero:dist2(a) == 25)
+  assert(math.abs(a:angle_between(b) - math.pi / 2) < 1e-15)
+  assert(a:angle_between(a * 2) == 0)
+  local c = vector.new(1, 2, 3)
+  assert(not pcall(c.dist, c, a) and not pcall(c.dist2, c, a))
+  assert(not pcall(c.dot, c, a) and not pcall(c.angle_between, c, a))
+end
+
+do
+  print("Batched distances")
+  local points = {vector.new(0, 0), vector.new(3, 4), vector.new(1, 1), vector.new(10, 0)}
+  local distances = vector.distances(vector.zero, points)
+  assert(distances[1] == 5 and distances[3] == 10)
+  assert(vector.distances(vector.zero, points, nil, nil, true)[1] == 25)
+  local result, n, total = vector.within_radius(vector.zero, points, nil, 5)
+  assert(n == 3 and total == 3 and result[0] == 0 and result[1] == 1 and result[2] == 2)
+  assert(not pcall(vector.within_radius, vector.zero, points, nil, 5, result))
+  table.insert(points, vector.new(1, 2, 3))
+  assert(not pcall(vector.distances, vector.zero, points))
+  assert(not pcall(vector.within_radius, vector.zero, points, nil, 5))
+end
+
+if ffi_backend then
+  print("Random streams")
+  local a = vector.rng(42)
+  local b = vector.rng(42)
+  local points = a:box(vector.new(-1, 10), vector.new(1, 20), 100)
+  assert(b:box(vector.new(-1, 10), vector.new(1, 20), 100)[99] == points[99])
+  assert(points[0].len == 2 and points[0].y >= 10 and points[0].y < 20)
+  assert(vector.rng(42, 1):uniform() ~= vector.rng(42):uniform())
+  assert(a:seed(42):uniform() == vector.rng(42):uniform())
+
+  local disk = a:disk(100)
+  local sphere = a:sphere(100)
+  local directions = a:direction(3, 100)
+  for i = 0, 99 do
+    assert(disk[i]:abs() < 1 and sphere[i].len == 3 and sphere[i]:abs() < 1)
+    assert(math.abs(directions[i]:abs() - 1) < 1e-12)
+  end
+  assert(not pcall(a.direction, a, 5, 1))
+
+  local samples = a:gaussian(vector.new(5, -5), 0.5, 1000)
+  local mean = vector.mean(samples, 1000)
+  assert(math.abs(mean.x - 5) < 0.1 and math.abs(mean.y + 5) < 0.1)
+end
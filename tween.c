@@ -0,0 +1,242 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "vector.h"
+
+// Batched tweens: each one interpolates a target `vector` from `from` to `to` over `duration` along
+// an easing curve, and tween_engine_update steps all of them at once, writing into the targets in
+// place. The engine does not own the targets; the caller keeps them alive until their tweens end.
+
+// Curve ids, in the order of vector.easings in vector.lua
+typedef enum {
+    EASE_LINEAR,
+    EASE_QUAD_IN, EASE_QUAD_OUT, EASE_QUAD_IN_OUT,
+    EASE_CUBIC_IN, EASE_CUBIC_OUT, EASE_CUBIC_IN_OUT,
+    EASE_QUART_IN, EASE_QUART_OUT, EASE_QUART_IN_OUT,
+    EASE_SINE_IN, EASE_SINE_OUT, EASE_SINE_IN_OUT,
+    EASE_EXPO_IN, EASE_EXPO_OUT, EASE_EXPO_IN_OUT,
+    EASE_BACK_IN, EASE_BACK_OUT, EASE_BACK_IN_OUT,
+    EASE_ELASTIC_IN, EASE_ELASTIC_OUT, EASE_ELASTIC_IN_OUT,
+    EASE_BOUNCE_IN, EASE_BOUNCE_OUT, EASE_BOUNCE_IN_OUT,
+    EASE_COUNT,
+} ease_curve;
+
+static double ease_bounce_out(double t) {
+    const double n = 7.5625, d = 2.75;
+    if (t < 1 / d) return n * t * t;
+    if (t < 2 / d) {
+        t -= 1.5 / d;
+        return n * t * t + 0.75;
+    }
+    if (t < 2.5 / d) {
+        t -= 2.25 / d;
+        return n * t * t + 0.9375;
+    }
+    t -= 2.625 / d;
+    return n * t * t + 0.984375;
+}
+
+// Easing curve `easing` at t in [0, 1]; every curve maps 0 to 0 and 1 to 1. Out of range t and
+// unknown curves are treated as linear.
+EXPORT double vector_ease(int32_t easing, double t) {
+    const double back = 1.70158, back_in_out = back * 1.525;
+    const double elastic = 2 * M_PI / 3, elastic_in_out = 2 * M_PI / 4.5;
+    if (!(t > 0)) return 0;
+    if (t >= 1) return 1;
+
+    double u = 1 - t;
+    switch (easing) {
+    case EASE_QUAD_IN: return t * t;
+    case EASE_QUAD_OUT: return 1 - u * u;
+    case EASE_QUAD_IN_OUT: return t < 0.5 ? 2 * t * t : 1 - 2 * u * u;
+    case EASE_CUBIC_IN: return t * t * t;
+    case EASE_CUBIC_OUT: return 1 - u * u * u;
+    case EASE_CUBIC_IN_OUT: return t < 0.5 ? 4 * t * t * t : 1 - 4 * u * u * u;
+    case EASE_QUART_IN: return t * t * t * t;
+    case EASE_QUART_OUT: return 1 - u * u * u * u;
+    case EASE_QUART_IN_OUT: return t < 0.5 ? 8 * t * t * t * t : 1 - 8 * u * u * u * u;
+    case EASE_SINE_IN: return 1 - cos(t * M_PI / 2);
+    case EASE_SINE_OUT: return sin(t * M_PI / 2);
+    case EASE_SINE_IN_OUT: return (1 - cos(t * M_PI)) / 2;
+    case EASE_EXPO_IN: return exp2(10 * t - 10);
+    case EASE_EXPO_OUT: return 1 - exp2(-10 * t);
+    case EASE_EXPO_IN_OUT: return t < 0.5 ? exp2(20 * t - 10) / 2 : 1 - exp2(-20 * t + 10) / 2;
+    case EASE_BACK_IN: return t * t * ((back + 1) * t - back);
+    case EASE_BACK_OUT: return 1 - u * u * ((back + 1) * u - back);
+    case EASE_BACK_IN_OUT:
+        return t < 0.5
+            ? 2 * t * t * ((back_in_out + 1) * 2 * t - back_in_out)
+            : 1 - 2 * u * u * ((back_in_out + 1) * 2 * u - back_in_out);
+    case EASE_ELASTIC_IN: return -exp2(10 * t - 10) * sin((10 * t - 10.75) * elastic);
+    case EASE_ELASTIC_OUT: return exp2(-10 * t) * sin((10 * t - 0.75) * elastic) + 1;
+    case EASE_ELASTIC_IN_OUT:
+        return t < 0.5
+            ? -exp2(20 * t - 10) * sin((20 * t - 11.125) * elastic_in_out) / 2
+            : exp2(-20 * t + 10) * sin((20 * t - 11.125) * elastic_in_out) / 2 + 1;
+    case EASE_BOUNCE_IN: return 1 - ease_bounce_out(u);
+    case EASE_BOUNCE_OUT: return ease_bounce_out(t);
+    case EASE_BOUNCE_IN_OUT: return t < 0.5 ? (1 - ease_bounce_out(1 - 2 * t)) / 2 : (1 + ease_bounce_out(2 * t - 1)) / 2;
+    default: return t;
+    }
+}
+
+// Ids are a slot in the low bits and the slot's generation above them, so that the id of a
+// finished tween does not refer to a later one reusing its slot
+#define TWEEN_SLOT_BITS 22
+#define TWEEN_SLOT_MASK ((1 << TWEEN_SLOT_BITS) - 1)
+#define TWEEN_GENERATION_MASK ((1 << (31 - TWEEN_SLOT_BITS)) - 1)
+
+typedef struct {
+    vector *target;
+    vector from;
+    vector to;
+    double elapsed;
+    double duration;
+    int32_t easing;
+    int32_t id;
+} tween;
+
+typedef struct {
+    // Active tweens are kept dense, so that an update is one linear pass
+    tween *items;
+    int32_t len;
+    int32_t capacity;
+    // Per slot: index into items while active, otherwise the next free slot
+    int32_t *slots;
+    int32_t *generations;
+    int32_t slots_len;
+    int32_t free_slot;
+} tween_engine;
+
+EXPORT tween_engine *tween_engine_new(void) {
+    tween_engine *self = calloc(1, sizeof(tween_engine));
+    if (self == NULL) return NULL;
+    self->free_slot = -1;
+    return self;
+}
+
+EXPORT void tween_engine_free(tween_engine *self) {
+    if (self == NULL) return;
+    free(self->items);
+    free(self->slots);
+    free(self->generations);
+    free(self);
+}
+
+EXPORT int32_t tween_engine_len(const tween_engine *self) {
+    return self->len;
+}
+
+static bool tween_reserve(tween_engine *self) {
+    if (self->len < self->capacity) return true;
+    if (self->capacity > TWEEN_SLOT_MASK) return false;
+
+    int32_t capacity = self->capacity > 0 ? self->capacity * 2 : 64;
+    if (capacity > TWEEN_SLOT_MASK + 1) capacity = TWEEN_SLOT_MASK + 1;
+
+    tween *items = realloc(self->items, sizeof(tween) * capacity);
+    if (items != NULL) self->items = items;
+    int32_t *slots = realloc(self->slots, sizeof(int32_t) * capacity);
+    if (slots != NULL) self->slots = slots;
+    int32_t *generations = realloc(self->generations, sizeof(int32_t) * capacity);
+    if (generations != NULL) self->generations = generations;
+    if (items == NULL || slots == NULL || generations == NULL) return false;
+
+    self->capacity = capacity;
+    return true;
+}
+
+// Starts tweening `target` from `from` to `to` (all of the same length) over `duration` seconds.
+// Returns the tween id, or -1 on bad arguments or allocation failure.
+EXPORT int32_t tween_engine_add(
+    tween_engine *self, vector *target, const vector *from, const vector *to, double duration, int32_t easing
+) {
+    if (target->len != from->len || target->len != to->len) return -1;
+    if (!(duration >= 0) || easing < 0 || easing >= EASE_COUNT) return -1;
+    if (!tween_reserve(self)) return -1;
+
+    int32_t slot = self->free_slot;
+    if (slot >= 0) {
+        self->free_slot = self->slots[slot];
+    } else {
+        slot = self->slots_len++;
+        self->generations[slot] = 0;
+    }
+    self->slots[slot] = self->len;
+
+    tween *item = &self->items[self->len++];
+    item->target = target;
+    item->from = *from;
+    item->to = *to;
+    item->elapsed = 0;
+    item->duration = duration;
+    item->easing = easing;
+    item->id = self->generations[slot] << TWEEN_SLOT_BITS | slot;
+    return item->id;
+}
+
+static int32_t tween_index(const tween_engine *self, int32_t id) {
+    if (id < 0) return -1;
+    int32_t slot = id & TWEEN_SLOT_MASK;
+    if (slot >= self->slots_len || self->generations[slot] != id >> TWEEN_SLOT_BITS) return -1;
+    int32_t i = self->slots[slot];
+    return i >= 0 && i < self->len && self->items[i].id == id ? i : -1;
+}
+
+static void tween_remove(tween_engine *self, int32_t i) {
+    int32_t slot = self->items[i].id & TWEEN_SLOT_MASK;
+    self->generations[slot] = (self->generations[slot] + 1) & TWEEN_GENERATION_MASK;
+    self->slots[slot] = self->free_slot;
+    self->free_slot = slot;
+
+    self->items[i] = self->items[--self->len];
+    if (i < self->len) self->slots[self->items[i].id & TWEEN_SLOT_MASK] = i;
+}
+
+// Stops the tween, leaving its target as it is; false if it is not active
+EXPORT bool tween_engine_cancel(tween_engine *self, int32_t id) {
+    int32_t i = tween_index(self, id);
+    if (i < 0) return false;
+    tween_remove(self, i);
+    return true;
+}
+
+// Cancels every tween of `target`; returns how many there were
+EXPORT int32_t tween_engine_cancel_target(tween_engine *self, const vector *target) {
+    int32_t found = 0;
+    for (int32_t i = self->len - 1; i >= 0; i--) {
+        if (self->items[i].target != target) continue;
+        tween_remove(self, i);
+        found++;
+    }
+    return found;
+}
+
+EXPORT void tween_engine_clear(tween_engine *self) {
+    while (self->len > 0) tween_remove(self, self->len - 1);
+}
+
+// Advances every tween by `dt` and writes the eased values into the targets. Finished tweens set
+// their targets exactly to `to` and are removed; their ids go to `finished`, up to `capacity`.
+// Returns the number of tweens that finished.
+EXPORT int32_t tween_engine_update(tween_engine *self, double dt, int32_t *finished, int32_t capacity) {
+    int32_t found = 0;
+    for (int32_t i = 0; i < self->len; i++) {
+        tween *item = &self->items[i];
+        item->elapsed += dt;
+        if (item->elapsed < item->duration) {
+            double e = vector_ease(item->easing, item->elapsed / item->duration);
+            for (int c = 0; c < item->from.len; c++) {
+                item->target->items[c] = item->from.items[c] + (item->to.items[c] - item->from.items[c]) * e;
+            }
+            continue;
+        }
+
+        *item->target = item->to;
+        if (found < capacity) finished[found] = item->id;
+        found++;
+        // The last tween moves into i, so look at i again
+        tween_remove(self, i--);
+    }
+    return found;
+}
@@ -0,0 +1,143 @@
+#include <math.h>
+#include <string.h>
+
+#include "vector.h"
+
+// vec2, vec3 and vec4 kernels are stamped out per width by VEC_DEFINE, so every loop has a
+// compile-time trip count and is fully unrolled; there is no len to branch on.
+
+#define VEC_FOR(N, i) _Pragma("GCC unroll 4") for (int i = 0; i < N; i++)
+
+#define VEC_DEFINE(N) \
+    EXPORT vec##N *vec##N##_unm_mut(vec##N *self) { \
+        VEC_FOR(N, i) self->items[i] *= -1; \
+        return self; \
+    } \
+    \
+    EXPORT vec##N *vec##N##_add_mut(vec##N *self, const vec##N *other) { \
+        VEC_FOR(N, i) self->items[i] += other->items[i]; \
+        return self; \
+    } \
+    \
+    EXPORT vec##N *vec##N##_sub_mut(vec##N *self, const vec##N *other) { \
+        VEC_FOR(N, i) self->items[i] -= other->items[i]; \
+        return self; \
+    } \
+    \
+    EXPORT vec##N *vec##N##_mul_mut(vec##N *self, double k) { \
+        VEC_FOR(N, i) self->items[i] *= k; \
+        return self; \
+    } \
+    \
+    EXPORT vec##N *vec##N##_div_mut(vec##N *self, double k) { \
+        VEC_FOR(N, i) self->items[i] /= k; \
+        return self; \
+    } \
+    \
+    EXPORT vec##N *vec##N##_mod_mut(vec##N *self, double k) { \
+        VEC_FOR(N, i) self->items[i] = (int)self->items[i] % (int)k; \
+        return self; \
+    } \
+    \
+    EXPORT bool vec##N##_eq(const vec##N *self, const vec##N *other) { \
+        bool result = true; \
+        VEC_FOR(N, i) result &= self->items[i] == other->items[i]; \
+        return result; \
+    } \
+    \
+    EXPORT bool vec##N##_lt(const vec##N *self, const vec##N *other) { \
+        bool result = true; \
+        VEC_FOR(N, i) result &= self->items[i] < other->items[i]; \
+        return result; \
+    } \
+    \
+    EXPORT bool vec##N##_le(const vec##N *self, const vec##N *other) { \
+        bool result = true; \
+        VEC_FOR(N, i) result &= self->items[i] <= other->items[i]; \
+        return result; \
+    } \
+    \
+    EXPORT double vec##N##_abs(const vec##N *self) { \
+        double result = 0; \
+        VEC_FOR(N, i) result += self->items[i] * self->items[i]; \
+        return sqrt(result); \
+    } \
+    \
+    EXPORT double vec##N##_abs2(const vec##N *self) { \
+        double result = 0; \
+        VEC_FOR(N, i) result += fabs(self->items[i]); \
+        return result; \
+    } \
+    \
+    EXPORT vec##N *vec##N##_normalized_mut(vec##N *self) { \
+        double abs_val = vec##N##_abs(self); \
+        if (abs_val > 0) vec##N##_div_mut(self, abs_val); \
+        return self; \
+    } \
+    \
+    EXPORT vec##N *vec##N##_unm_into(const vec##N *self, vec##N *result) { \
+        *result = *self; \
+        return vec##N##_unm_mut(result); \
+    } \
+    \
+    EXPORT vec##N *vec##N##_add_into(const vec##N *self, const vec##N *other, vec##N *result) { \
+        VEC_FOR(N, i) result->items[i] = self->items[i] + other->items[i]; \
+        return result; \
+    } \
+    \
+    EXPORT vec##N *vec##N##_sub_into(const vec##N *self, const vec##N *other, vec##N *result) { \
+        VEC_FOR(N, i) result->items[i] = self->items[i] - other->items[i]; \
+        return result; \
+    } \
+    \
+    EXPORT vec##N *vec##N##_mul_into(const vec##N *self, double k, vec##N *result) { \
+        VEC_FOR(N, i) result->items[i] = self->items[i] * k; \
+        return result; \
+    } \
+    \
+    EXPORT vec##N *vec##N##_div_into(const vec##N *self, double k, vec##N *result) { \
+        VEC_FOR(N, i) result->items[i] = self->items[i] / k; \
+        return result; \
+    } \
+    \
+    EXPORT vec##N *vec##N##_mod_into(const vec##N *self, double k, vec##N *result) { \
+        VEC_FOR(N, i) result->items[i] = (int)self->items[i] % (int)k; \
+        return result; \
+    } \
+    \
+    EXPORT vec##N *vec##N##_normalized_into(const vec##N *self, vec##N *result) { \
+        *result = *self; \
+        return vec##N##_normalized_mut(result); \
+    } \
+    \
+    EXPORT vec##N *vec##N##_from_vector(const vector *source, vec##N *result) { \
+        if (source->len != N) return NULL; \
+        memcpy(result->items, source->items, sizeof(result->items)); \
+        return result; \
+    } \
+    \
+    EXPORT vector *vector_from_vec##N(const vec##N *source, vector *result) { \
+        result->len = N; \
+        memcpy(result->items, source->items, sizeof(source->items)); \
+        return result; \
+    }
+
+VEC_DEFINE(2)
+VEC_DEFINE(3)
+VEC_DEFINE(4)
+
+EXPORT vec2 *vec2_normalized2_mut(vec2 *self) {
+    if (fabs(self->items[0]) > fabs(self->items[1])) {
+        self->items[0] = copysign(1, self->items[0]);
+        self->items[1] = 0;
+    } else if (self->items[1] != 0) {
+        self->items[0] = 0;
+        self->items[1] = copysign(1, self->items[1]);
+    }
+    return self;
+}
+
+EXPORT vec2 *vec2_normalized2_into(const vec2 *self, vec2 *result) {
+    *result = *self;
+    return vec2_normalized2_mut(result);
+}
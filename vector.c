@@ -1,23 +1,9 @@
-#include <stdbool.h>
 #include <string.h>
 #include <stdlib.h>
-#include <stddef.h>
 #include <math.h>
 #include <errno.h>
 
-// Define a cross-platform EXPORT macro for public API functions
-#if defined _WIN32 || defined __CYGWIN__
-  #define EXPORT __declspec(dllexport)
-#else
-  #define EXPORT __attribute__((visibility("default")))
-#endif
-
-#define MAX_LEN 4
-
-typedef struct {
-    int len;
-    double items[MAX_LEN];
-} vector;
+#include "vector.h"
 
 static inline int get_index(char key) {
     if (key == 'x' || key == 'r') return 0;
@@ -28,41 +14,37 @@ static inline int get_index(char key) {
 }
 
 EXPORT vector *vector_unm_mut(vector *self) {
-    for (int i = 0; i < self->len; i++) {
-        self->items[i] *= -1;
-    }
+    VECTOR_STAT;
+    vector_kernels.scale(self->items, -1, self->len);
     return self;
 }
 
 EXPORT vector *vector_add_mut(vector *self, const vector *other) {
-    for (int i = 0; i < self->len; i++) {
-        self->items[i] += other->items[i];
-    }
+    VECTOR_STAT;
+    vector_kernels.add(self->items, other->items, self->len);
     return self;
 }
 
 EXPORT vector *vector_sub_mut(vector *self, const vector *other) {
-    for (int i = 0; i < self->len; i++) {
-        self->items[i] -= other->items[i];
-    }
+    VECTOR_STAT;
+    vector_kernels.sub(self->items, other->items, self->len);
     return self;
 }
 
 EXPORT vector *vector_mul_mut(vector *self, double k) {
-    for (int i = 0; i < self->len; i++) {
-        self->items[i] *= k;
-    }
+    VECTOR_STAT;
+    vector_kernels.scale(self->items, k, self->len);
     return self;
 }
 
 EXPORT vector *vector_div_mut(vector *self, double k) {
-    for (int i = 0; i < self->len; i++) {
-        self->items[i] /= k;
-    }
+    VECTOR_STAT;
+    vector_kernels.div(self->items, k, self->len);
     return self;
 }
 
 EXPORT vector *vector_mod_mut(vector *self, double k) {
+    VECTOR_STAT;
     for (int i = 0; i < self->len; i++) {
         self->items[i] = (int)self->items[i] % (int)k;
     }
@@ -70,6 +52,7 @@ EXPORT vector *vector_mod_mut(vector *self, double k) {
 }
 
 EXPORT bool vector_eq(const vector *self, const vector *other) {
+    VECTOR_STAT;
     if (self->len != other->len) return false;
     for (int i = 0; i < self->len; i++) {
         if (self->items[i] != other->items[i]) return false;
@@ -78,6 +61,7 @@ EXPORT bool vector_eq(const vector *self, const vector *other) {
 }
 
 EXPORT bool vector_lt(const vector *self, const vector *other) {
+    VECTOR_STAT;
     for (int i = 0; i < self->len; i++) {
         if (self->items[i] >= other->items[i]) return false;
     }
@@ -85,6 +69,7 @@ EXPORT bool vector_lt(const vector *self, const vector *other) {
 }
 
 EXPORT bool vector_le(const vector *self, const vector *other) {
+    VECTOR_STAT;
     for (int i = 0; i < self->len; i++) {
         if (self->items[i] > other->items[i]) return false;
     }
@@ -92,6 +77,7 @@ EXPORT bool vector_le(const vector *self, const vector *other) {
 }
 
 EXPORT double vector_abs(const vector *self) {
+    VECTOR_STAT;
     double result = 0;
     for (int i = 0; i < self->len; i++) {
         result += self->items[i] * self->items[i];
@@ -100,6 +86,7 @@ EXPORT double vector_abs(const vector *self) {
 }
 
 EXPORT double vector_abs2(const vector *self) {
+    VECTOR_STAT;
     double result = 0;
     for (int i = 0; i < self->len; i++) {
         result += fabs(self->items[i]);
@@ -107,7 +94,73 @@ EXPORT double vector_abs2(const vector *self) {
     return result;
 }
 
+// The binary scalar products below return NaN for vectors of different lengths
+EXPORT double vector_dot(const vector *self, const vector *other) {
+    VECTOR_STAT;
+    if (self->len != other->len) return NAN;
+    double result = 0;
+    for (int i = 0; i < self->len; i++) {
+        result += self->items[i] * other->items[i];
+    }
+    return result;
+}
+
+// z of the 3D cross product of two 2D vectors, positive when other is counterclockwise from self
+// in a y-up frame
+EXPORT double vector_cross2(const vector *self, const vector *other) {
+    VECTOR_STAT;
+    return self->items[0] * other->items[1] - self->items[1] * other->items[0];
+}
+
+// NULL unless both vectors are 3D
+EXPORT vector *vector_cross3_into(const vector *self, const vector *other, vector *result) {
+    VECTOR_STAT;
+    if (self->len != 3 || other->len != 3) return NULL;
+    const double *a = self->items, *b = other->items;
+    vector tmp = {.len = 3, .items = {
+        a[1] * b[2] - a[2] * b[1],
+        a[2] * b[0] - a[0] * b[2],
+        a[0] * b[1] - a[1] * b[0],
+    }};
+    *result = tmp;
+    return result;
+}
+
+// Squared Euclidean distance, for comparisons without the sqrt
+EXPORT double vector_dist2(const vector *self, const vector *other) {
+    VECTOR_STAT;
+    if (self->len != other->len) return NAN;
+    double result = 0;
+    for (int i = 0; i < self->len; i++) {
+        double d = self->items[i] - other->items[i];
+        result += d * d;
+    }
+    return result;
+}
+
+EXPORT double vector_dist(const vector *self, const vector *other) {
+    VECTOR_STAT;
+    return sqrt(vector_dist2(self, other));
+}
+
+// Unsigned angle in [0, pi] by Kahan's formula 2 atan2(|a|b| - b|a||, |a|b| + b|a||), which stays
+// accurate for nearly parallel vectors, unlike acos of the normalized dot product. 0 if either
+// vector is zero.
+EXPORT double vector_angle_between(const vector *self, const vector *other) {
+    VECTOR_STAT;
+    if (self->len != other->len) return NAN;
+    double abs_a = vector_abs(self), abs_b = vector_abs(other);
+    double difference = 0, sum = 0;
+    for (int i = 0; i < self->len; i++) {
+        double x = self->items[i] * abs_b, y = other->items[i] * abs_a;
+        difference += (x - y) * (x - y);
+        sum += (x + y) * (x + y);
+    }
+    return 2 * atan2(sqrt(difference), sqrt(sum));
+}
+
 EXPORT vector *vector_normalized_mut(vector *self) {
+    VECTOR_STAT;
     double abs_val = vector_abs(self);
     if (abs_val > 0) {
         vector_div_mut(self, abs_val);
@@ -116,6 +169,7 @@ EXPORT vector *vector_normalized_mut(vector *self) {
 }
 
 EXPORT vector *vector_normalized2_mut(vector *self) {
+    VECTOR_STAT;
     if (self->len != 2) return NULL;
 
     if (fabs(self->items[0]) > fabs(self->items[1])) {
@@ -128,16 +182,225 @@ EXPORT vector *vector_normalized2_mut(vector *self) {
     return self;
 }
 
-EXPORT vector *vector_swizzle(const vector *self, const char *swizzle_str, vector *result) {
+// *_into functions write the result into a caller-owned vector, which may alias either argument
+
+EXPORT vector *vector_copy_into(const vector *self, vector *result) {
+    VECTOR_STAT;
+    memmove(result, self, sizeof(vector));
+    return result;
+}
+
+EXPORT vector *vector_unm_into(const vector *self, vector *result) {
+    VECTOR_STAT;
+    return vector_unm_mut(vector_copy_into(self, result));
+}
+
+EXPORT vector *vector_add_into(const vector *self, const vector *other, vector *result) {
+    VECTOR_STAT;
+    vector tmp = *self;
+    *result = *vector_add_mut(&tmp, other);
+    return result;
+}
+
+EXPORT vector *vector_sub_into(const vector *self, const vector *other, vector *result) {
+    VECTOR_STAT;
+    vector tmp = *self;
+    *result = *vector_sub_mut(&tmp, other);
+    return result;
+}
+
+EXPORT vector *vector_mul_into(const vector *self, double k, vector *result) {
+    VECTOR_STAT;
+    return vector_mul_mut(vector_copy_into(self, result), k);
+}
+
+EXPORT vector *vector_div_into(const vector *self, double k, vector *result) {
+    VECTOR_STAT;
+    return vector_div_mut(vector_copy_into(self, result), k);
+}
+
+EXPORT vector *vector_mod_into(const vector *self, double k, vector *result) {
+    VECTOR_STAT;
+    return vector_mod_mut(vector_copy_into(self, result), k);
+}
+
+EXPORT vector *vector_normalized_into(const vector *self, vector *result) {
+    VECTOR_STAT;
+    return vector_normalized_mut(vector_copy_into(self, result));
+}
+
+EXPORT vector *vector_normalized2_into(const vector *self, vector *result) {
+    VECTOR_STAT;
+    if (self->len != 2) return NULL;
+    return vector_normalized2_mut(vector_copy_into(self, result));
+}
+
+// Fused kernels: one call and no temporaries for the common multi-operator expressions
+
+// result = self + other * k
+EXPORT vector *vector_madd_into(const vector *self, const vector *other, double k, vector *result) {
+    VECTOR_STAT;
+    vector tmp = *self;
+    for (int i = 0; i < self->len; i++) {
+        tmp.items[i] += other->items[i] * k;
+    }
+    *result = tmp;
+    return result;
+}
+
+// result = a * x + y
+EXPORT vector *vector_axpy_into(double a, const vector *x, const vector *y, vector *result) {
+    VECTOR_STAT;
+    vector tmp = *x;
+    for (int i = 0; i < x->len; i++) {
+        tmp.items[i] = a * x->items[i] + y->items[i];
+    }
+    *result = tmp;
+    return result;
+}
+
+// result = self + (other - self) * t
+EXPORT vector *vector_lerp_into(const vector *self, const vector *other, double t, vector *result) {
+    VECTOR_STAT;
+    vector tmp = *self;
+    for (int i = 0; i < self->len; i++) {
+        tmp.items[i] += (other->items[i] - self->items[i]) * t;
+    }
+    *result = tmp;
+    return result;
+}
+
+// Componentwise result = self * other + addend
+EXPORT vector *vector_fma_into(const vector *self, const vector *other, const vector *addend, vector *result) {
+    VECTOR_STAT;
+    vector tmp = *self;
+    for (int i = 0; i < self->len; i++) {
+        tmp.items[i] = self->items[i] * other->items[i] + addend->items[i];
+    }
+    *result = tmp;
+    return result;
+}
+
+// Componentwise clamp between min and max
+EXPORT vector *vector_clamp_into(const vector *self, const vector *min, const vector *max, vector *result) {
+    VECTOR_STAT;
+    vector tmp = *self;
+    for (int i = 0; i < self->len; i++) {
+        if (tmp.items[i] < min->items[i]) tmp.items[i] = min->items[i];
+        if (tmp.items[i] > max->items[i]) tmp.items[i] = max->items[i];
+    }
+    *result = tmp;
+    return result;
+}
+
+// Stack machine behind the lazy expressions of vector.lua. PUSH takes operands[arg], MUL/DIV
+// take scalars[arg], binary operators pop two vectors and push the result.
+enum {
+    VECTOR_OP_PUSH,
+    VECTOR_OP_ADD,
+    VECTOR_OP_SUB,
+    VECTOR_OP_MUL,
+    VECTOR_OP_DIV,
+    VECTOR_OP_UNM,
+};
+
+typedef struct {
+    int32_t op;
+    int32_t arg;
+} vector_op;
+
+#define VECTOR_EVAL_DEPTH 16
+
+// NULL on malformed programs and length mismatches
+EXPORT vector *vector_eval(
+    const vector_op *ops, int32_t len, const vector *const *operands, const double *scalars, vector *result
+) {
+    VECTOR_STAT;
+    vector stack[VECTOR_EVAL_DEPTH];
+    int top = -1;
+
+    for (int32_t i = 0; i < len; i++) {
+        const vector_op *op = &ops[i];
+        if (op->op == VECTOR_OP_PUSH) {
+            if (top + 1 == VECTOR_EVAL_DEPTH) return NULL;
+            stack[++top] = *operands[op->arg];
+            continue;
+        }
+
+        if (top < 0) return NULL;
+        vector *a = &stack[top];
+        switch (op->op) {
+            case VECTOR_OP_ADD:
+            case VECTOR_OP_SUB:
+                if (top < 1 || stack[top - 1].len != a->len) return NULL;
+                if (op->op == VECTOR_OP_ADD) {
+                    vector_add_mut(&stack[top - 1], a);
+                } else {
+                    vector_sub_mut(&stack[top - 1], a);
+                }
+                top--;
+                break;
+            case VECTOR_OP_MUL:
+                vector_mul_mut(a, scalars[op->arg]);
+                break;
+            case VECTOR_OP_DIV:
+                vector_div_mut(a, scalars[op->arg]);
+                break;
+            case VECTOR_OP_UNM:
+                vector_unm_mut(a);
+                break;
+            default:
+                return NULL;
+        }
+    }
+
+    if (top != 0) return NULL;
+    *result = stack[0];
+    return result;
+}
+
+// Swizzle masks: 2 bits per source index from the lowest bits up, the length in bits 8 and up.
+// Patterns are 1 to MAX_LEN letters, all from either xyzw or rgba; -1 otherwise.
+EXPORT int32_t vector_swizzle_compile(const char *swizzle_str) {
+    VECTOR_STAT;
     size_t swizzle_len = strlen(swizzle_str);
-    result->len = swizzle_len;
+    if (swizzle_len == 0 || swizzle_len > MAX_LEN) return -1;
+
+    bool is_color = strchr("rgba", swizzle_str[0]) != NULL;
+    int32_t mask = swizzle_len << 8;
     for (size_t i = 0; i < swizzle_len; i++) {
-        result->items[i] = self->items[get_index(swizzle_str[i])];
+        int index = get_index(swizzle_str[i]);
+        if (index < 0 || (strchr("rgba", swizzle_str[i]) != NULL) != is_color) return -1;
+        mask |= index << (2 * i);
+    }
+    return mask;
+}
+
+// NULL if the mask is invalid or reads past self->len; result may be self
+EXPORT vector *vector_swizzle_mask(const vector *self, int32_t mask, vector *result) {
+    VECTOR_STAT;
+    int len = mask >> 8;
+    if (mask < 0 || len == 0 || len > MAX_LEN) return NULL;
+
+    double items[MAX_LEN];
+    for (int i = 0; i < len; i++) {
+        int index = (mask >> (2 * i)) & 3;
+        if (index >= self->len) return NULL;
+        items[i] = self->items[index];
     }
+    result->len = len;
+    memcpy(result->items, items, sizeof(double) * len);
     return result;
 }
 
+// NULL on an invalid pattern, see vector_swizzle_compile
+EXPORT vector *vector_swizzle(const vector *self, const char *swizzle_str, vector *result) {
+    VECTOR_STAT;
+    return vector_swizzle_mask(self, vector_swizzle_compile(swizzle_str), result);
+}
+
 EXPORT const char* vector_name_from_direction(const vector *self) {
+    VECTOR_STAT;
     if (self->len != 2) return NULL;
     if (self->items[0] == 0) {
         if (self->items[1] == 1) return "down";
@@ -150,6 +413,7 @@ EXPORT const char* vector_name_from_direction(const vector *self) {
 }
 
 EXPORT bool vector_from_hex(const char *hex_str, vector *result) {
+    VECTOR_STAT;
     size_t str_len = strlen(hex_str);
     if (str_len % 2 != 0 || str_len == 0 || str_len > (MAX_LEN * 2)) {
         return false;
@@ -171,3 +435,207 @@ EXPORT bool vector_from_hex(const char *hex_str, vector *result) {
 
     return true;
 }
+
+EXPORT vector_array *vector_array_new(int len, int dim) {
+    VECTOR_STAT;
+    if (len < 0 || dim < 1 || dim > MAX_LEN) return NULL;
+
+    vector_array *self = calloc(1, sizeof(vector_array) + sizeof(double) * len * dim);
+    if (self == NULL) return NULL;
+
+    self->len = len;
+    self->dim = dim;
+    double *data = (double *)(self + 1);
+    for (int c = 0; c < dim; c++) {
+        self->items[c] = data + (size_t)c * len;
+    }
+    return self;
+}
+
+EXPORT void vector_array_free(vector_array *self) {
+    VECTOR_STAT;
+    free(self);
+}
+
+static inline bool vector_array_same_shape(const vector_array *self, const vector_array *other) {
+    return self->len == other->len && self->dim == other->dim;
+}
+
+EXPORT vector *vector_array_get(const vector_array *self, int i, vector *result) {
+    VECTOR_STAT;
+    if (i < 0 || i >= self->len) return NULL;
+    result->len = self->dim;
+    for (int c = 0; c < self->dim; c++) {
+        result->items[c] = self->items[c][i];
+    }
+    return result;
+}
+
+EXPORT vector_array *vector_array_set(vector_array *self, int i, const vector *value) {
+    VECTOR_STAT;
+    if (i < 0 || i >= self->len || value->len != self->dim) return NULL;
+    for (int c = 0; c < self->dim; c++) {
+        self->items[c][i] = value->items[c];
+    }
+    return self;
+}
+
+// Components are stored back to back, so shape-independent kernels run over a single flat span
+static inline double *vector_array_data(const vector_array *self) {
+    return self->items[0];
+}
+
+static inline size_t vector_array_size(const vector_array *self) {
+    return (size_t)self->len * self->dim;
+}
+
+// Batched kernels go through vector_pool_run; every element is computed independently, so the
+// results do not depend on the thread count
+typedef struct {
+    double *dst;
+    const double *src;
+    double k;
+    double *const *columns;
+    int dim;
+} vector_array_job;
+
+static void vector_array_add_task(void *context, size_t begin, size_t end) {
+    vector_array_job *job = context;
+    vector_kernels.add(job->dst + begin, job->src + begin, end - begin);
+}
+
+static void vector_array_sub_task(void *context, size_t begin, size_t end) {
+    vector_array_job *job = context;
+    vector_kernels.sub(job->dst + begin, job->src + begin, end - begin);
+}
+
+static void vector_array_scale_task(void *context, size_t begin, size_t end) {
+    vector_array_job *job = context;
+    vector_kernels.scale(job->dst + begin, job->k, end - begin);
+}
+
+static void vector_array_add_scaled_task(void *context, size_t begin, size_t end) {
+    vector_array_job *job = context;
+    vector_kernels.add_scaled(job->dst + begin, job->src + begin, job->k, end - begin);
+}
+
+static void vector_array_normalize_task(void *context, size_t begin, size_t end) {
+    vector_array_job *job = context;
+    double *columns[MAX_LEN];
+    for (int c = 0; c < job->dim; c++) columns[c] = job->columns[c] + begin;
+    vector_kernels.normalize_columns(columns, job->dim, end - begin);
+}
+
+static void vector_array_abs_task(void *context, size_t begin, size_t end) {
+    vector_array_job *job = context;
+    double *columns[MAX_LEN];
+    for (int c = 0; c < job->dim; c++) columns[c] = job->columns[c] + begin;
+    vector_kernels.abs_columns(columns, job->dim, job->dst + begin, end - begin);
+}
+
+EXPORT vector_array *vector_array_add_mut(vector_array *self, const vector_array *other) {
+    VECTOR_STAT;
+    if (!vector_array_same_shape(self, other)) return NULL;
+    vector_array_job job = {.dst = vector_array_data(self), .src = vector_array_data(other)};
+    vector_pool_run(vector_array_add_task, &job, vector_array_size(self));
+    return self;
+}
+
+EXPORT vector_array *vector_array_sub_mut(vector_array *self, const vector_array *other) {
+    VECTOR_STAT;
+    if (!vector_array_same_shape(self, other)) return NULL;
+    vector_array_job job = {.dst = vector_array_data(self), .src = vector_array_data(other)};
+    vector_pool_run(vector_array_sub_task, &job, vector_array_size(self));
+    return self;
+}
+
+EXPORT vector_array *vector_array_mul_mut(vector_array *self, double k) {
+    VECTOR_STAT;
+    vector_array_job job = {.dst = vector_array_data(self), .k = k};
+    vector_pool_run(vector_array_scale_task, &job, vector_array_size(self));
+    return self;
+}
+
+// self += other * k, i.e. `positions:add_scaled_mut(velocities, dt)`
+EXPORT vector_array *vector_array_add_scaled_mut(vector_array *self, const vector_array *other, double k) {
+    VECTOR_STAT;
+    if (!vector_array_same_shape(self, other)) return NULL;
+    vector_array_job job = {.dst = vector_array_data(self), .src = vector_array_data(other), .k = k};
+    vector_pool_run(vector_array_add_scaled_task, &job, vector_array_size(self));
+    return self;
+}
+
+EXPORT vector_array *vector_array_normalized_mut(vector_array *self) {
+    VECTOR_STAT;
+    vector_array_job job = {.columns = self->items, .dim = self->dim};
+    vector_pool_run(vector_array_normalize_task, &job, self->len);
+    return self;
+}
+
+EXPORT double *vector_array_abs(const vector_array *self, double *result) {
+    VECTOR_STAT;
+    vector_array_job job = {.dst = result, .columns = self->items, .dim = self->dim};
+    vector_pool_run(vector_array_abs_task, &job, self->len);
+    return result;
+}
+
+typedef struct {
+    const vector *origin;
+    const vector *items;
+    double *result;
+    bool squared;
+} vector_distances_job;
+
+static void vector_distances_task(void *context, size_t begin, size_t end) {
+    vector_distances_job *job = context;
+    int len = job->origin->len;
+    const double *o = job->origin->items;
+    for (size_t i = begin; i < end; i++) {
+        double d2 = 0;
+        for (int c = 0; c < len; c++) {
+            double d = job->items[i].items[c] - o[c];
+            d2 += d * d;
+        }
+        job->result[i] = job->squared ? d2 : sqrt(d2);
+    }
+}
+
+// Distances (squared ones if `squared`) from origin to each of items[0, len) into result[0, len);
+// NULL if any item differs in length from origin
+EXPORT double *vector_distances(
+    const vector *origin, const vector *items, int32_t len, bool squared, double *result
+) {
+    VECTOR_STAT;
+    for (int32_t i = 0; i < len; i++) {
+        if (items[i].len != origin->len) return NULL;
+    }
+    vector_distances_job job = {.origin = origin, .items = items, .result = result, .squared = squared};
+    vector_pool_run(vector_distances_task, &job, len > 0 ? len : 0);
+    return result;
+}
+
+// Zero-based indices of the items within `radius` of origin (boundary included), compared
+// squared; writes up to `capacity` of them in order and returns the total count, or -1 if an item
+// differs in length from origin
+EXPORT int32_t vector_within_radius(
+    const vector *origin, const vector *items, int32_t len, double radius, int32_t *result, int32_t capacity
+) {
+    VECTOR_STAT;
+    if (!(radius >= 0)) return 0;
+    double radius2 = radius * radius;
+    int dim = origin->len;
+    const double *o = origin->items;
+    int32_t found = 0;
+    for (int32_t i = 0; i < len; i++) {
+        if (items[i].len != dim) return -1;
+        double d2 = 0;
+        for (int c = 0; c < dim; c++) {
+            double d = items[i].items[c] - o[c];
+            d2 += d * d;
+        }
+        if (d2 > radius2) continue;
+        if (found < capacity) result[found] = i;
+        found++;
+    }
+    return found;
+}
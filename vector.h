@@ -0,0 +1,222 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Define a cross-platform EXPORT macro for public API functions
+#if defined _WIN32 || defined __CYGWIN__
+  #define EXPORT __declspec(dllexport)
+#else
+  #define EXPORT __attribute__((visibility("default")))
+#endif
+
+#define MAX_LEN 4
+
+typedef struct {
+    int len;
+    double items[MAX_LEN];
+} vector;
+
+typedef struct {
+    int len;
+    int dim;
+    double *items[MAX_LEN];
+} vector_array;
+
+// Single precision counterpart of `vector`, see vectorf.c
+typedef struct {
+    int len;
+    float items[MAX_LEN];
+} vectorf;
+
+// Fixed-width vectors without a len field, see vec.c
+typedef struct {
+    double items[2];
+} vec2;
+
+typedef struct {
+    double items[3];
+} vec3;
+
+typedef struct {
+    double items[4];
+} vec4;
+
+// Integer grid vectors, see ivec.c
+typedef struct {
+    int32_t items[2];
+} ivec2;
+
+typedef struct {
+    int32_t items[3];
+} ivec3;
+
+// Row-major square matrices, see matrix.c; mat3 doubles as a 2D affine transform
+typedef struct {
+    double items[4];
+} mat2;
+
+typedef struct {
+    double items[9];
+} mat3;
+
+typedef struct {
+    double items[16];
+} mat4;
+
+typedef struct ivec_map ivec_map;
+
+EXPORT ivec_map *ivec_map_new(int dim, size_t capacity);
+EXPORT void ivec_map_free(ivec_map *self);
+EXPORT bool ivec_map_set(ivec_map *self, const int32_t *key, int64_t value);
+EXPORT bool ivec_map_get(const ivec_map *self, const int32_t *key, int64_t *value);
+EXPORT bool ivec_map_remove(ivec_map *self, const int32_t *key);
+EXPORT void ivec_map_clear(ivec_map *self);
+
+EXPORT bool vector_from_hex(const char *hex_str, vector *result);
+
+// Single-vector API of vector.c, format.c and vector_simd.c, shared with the Lua C API module
+// vector_old.c
+EXPORT vector *vector_unm_mut(vector *self);
+EXPORT vector *vector_add_mut(vector *self, const vector *other);
+EXPORT vector *vector_sub_mut(vector *self, const vector *other);
+EXPORT vector *vector_mul_mut(vector *self, double k);
+EXPORT vector *vector_div_mut(vector *self, double k);
+EXPORT vector *vector_mod_mut(vector *self, double k);
+EXPORT bool vector_eq(const vector *self, const vector *other);
+EXPORT bool vector_lt(const vector *self, const vector *other);
+EXPORT bool vector_le(const vector *self, const vector *other);
+EXPORT double vector_abs(const vector *self);
+EXPORT double vector_abs2(const vector *self);
+EXPORT vector *vector_normalized_mut(vector *self);
+EXPORT vector *vector_normalized2_mut(vector *self);
+EXPORT double vector_dot(const vector *self, const vector *other);
+EXPORT double vector_cross2(const vector *self, const vector *other);
+EXPORT vector *vector_cross3_into(const vector *self, const vector *other, vector *result);
+EXPORT double vector_dist(const vector *self, const vector *other);
+EXPORT double vector_dist2(const vector *self, const vector *other);
+EXPORT double vector_angle_between(const vector *self, const vector *other);
+EXPORT vector *vector_copy_into(const vector *self, vector *result);
+EXPORT vector *vector_unm_into(const vector *self, vector *result);
+EXPORT vector *vector_add_into(const vector *self, const vector *other, vector *result);
+EXPORT vector *vector_sub_into(const vector *self, const vector *other, vector *result);
+EXPORT vector *vector_mul_into(const vector *self, double k, vector *result);
+EXPORT vector *vector_div_into(const vector *self, double k, vector *result);
+EXPORT vector *vector_mod_into(const vector *self, double k, vector *result);
+EXPORT vector *vector_normalized_into(const vector *self, vector *result);
+EXPORT vector *vector_normalized2_into(const vector *self, vector *result);
+EXPORT vector *vector_madd_into(const vector *self, const vector *other, double k, vector *result);
+EXPORT vector *vector_axpy_into(double a, const vector *x, const vector *y, vector *result);
+EXPORT vector *vector_lerp_into(const vector *self, const vector *other, double t, vector *result);
+EXPORT vector *vector_fma_into(const vector *self, const vector *other, const vector *addend, vector *result);
+EXPORT vector *vector_clamp_into(const vector *self, const vector *min, const vector *max, vector *result);
+EXPORT int32_t vector_swizzle_compile(const char *swizzle_str);
+EXPORT vector *vector_swizzle_mask(const vector *self, int32_t mask, vector *result);
+EXPORT const char *vector_name_from_direction(const vector *self);
+EXPORT int32_t vector_format(const vector *self, char *buffer, int32_t capacity);
+EXPORT bool vector_simd_set(const char *name);
+EXPORT const char *vector_simd_name(void);
+
+// Batch functions over plain `vector` buffers that vector_old.c also exposes, taking Lua
+// sequences instead of buffers; see the files defining them
+EXPORT int64_t vector_format_batch(
+    const vector *items, int64_t len, const char *separator, char *buffer, int64_t capacity
+);
+EXPORT int64_t vector_parse(const char *text, int64_t len, vector *result, int64_t capacity, int64_t *consumed);
+EXPORT vector *vector_sum(const vector *items, int64_t len, vector *result);
+EXPORT vector *vector_mean(const vector *items, int64_t len, vector *result);
+EXPORT bool vector_aabb(const vector *items, int64_t len, vector *min, vector *max);
+EXPORT vector *vector_variance(const vector *items, int64_t len, vector *mean, vector *result);
+EXPORT int vector_covariance(const vector *items, int64_t len, vector *mean, double *result);
+EXPORT double *vector_distances(
+    const vector *origin, const vector *items, int32_t len, bool squared, double *result
+);
+EXPORT int32_t vector_within_radius(
+    const vector *origin, const vector *items, int32_t len, double radius, int32_t *result, int32_t capacity
+);
+EXPORT int32_t sight_line_walk(const vector *from, const vector *to, vector *result, int32_t capacity);
+EXPORT double vector_ease(int32_t easing, double t);
+EXPORT bool vector_set_threads(int32_t threads);
+EXPORT int32_t vector_threads(void);
+EXPORT void vector_set_thread_threshold(int64_t threshold);
+EXPORT int64_t vector_thread_threshold(void);
+typedef struct vector_snapshot_writer vector_snapshot_writer;
+
+EXPORT vector_snapshot_writer *vector_snapshot_writer_open(const char *path, int32_t dim, int32_t precision);
+EXPORT bool vector_snapshot_writer_write(vector_snapshot_writer *self, const vector *items, int64_t len);
+EXPORT bool vector_snapshot_writer_close(vector_snapshot_writer *self);
+EXPORT bool vector_stats_enabled(void);
+EXPORT int32_t vector_stats_count(void);
+EXPORT bool vector_stats_get(int32_t i, const char **name, uint64_t *calls, uint64_t *cycles);
+EXPORT void vector_stats_reset(void);
+
+// Flat kernels shared by single vectors (n = len) and packed arrays (n = len * dim). Every
+// implementation performs the same IEEE operations in the same order as the scalar one, so all
+// of them produce bit-identical results.
+typedef struct {
+    const char *name;
+    void (*add)(double *dst, const double *src, size_t n);
+    void (*sub)(double *dst, const double *src, size_t n);
+    void (*scale)(double *dst, double k, size_t n);
+    void (*div)(double *dst, double k, size_t n);
+    void (*add_scaled)(double *dst, const double *src, double k, size_t n);
+    void (*abs_columns)(double *const *columns, int dim, double *result, size_t n);
+    void (*normalize_columns)(double *const *columns, int dim, size_t n);
+} vector_kernel_table;
+
+// Selected once at load time, see vector_simd.c
+extern vector_kernel_table vector_kernels;
+
+// Runs task(context, begin, end) over [0, n) on the worker pool, in chunks of VECTOR_POOL_CHUNK
+// elements; small batches run inline. See pool.c.
+#define VECTOR_POOL_CHUNK 16384
+
+typedef void (*vector_pool_task)(void *context, size_t begin, size_t end);
+
+void vector_pool_run(vector_pool_task task, void *context, size_t n);
+
+// Instrumentation, compiled in with `make STATS=1`, see stats.c. VECTOR_STAT at the top of a
+// function counts its calls and the cycles spent in it, including nested instrumented calls.
+#ifdef VECTOR_STATS
+  #if (defined __x86_64__ || defined __i386__) && defined __GNUC__
+    #include <x86intrin.h>
+    #define vector_stat_clock() __rdtsc()
+  #else
+    #include <time.h>
+    static inline uint64_t vector_stat_clock(void) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (uint64_t)now.tv_sec * 1000000000u + now.tv_nsec;
+    }
+  #endif
+
+  typedef struct vector_stat {
+      const char *name;
+      uint64_t calls;
+      uint64_t cycles;
+      bool registered;
+      struct vector_stat *next;
+  } vector_stat;
+
+  typedef struct {
+      vector_stat *stat;
+      uint64_t start;
+  } vector_stat_scope;
+
+  void vector_stat_register(vector_stat *stat);
+
+  static inline void vector_stat_end(vector_stat_scope *scope) {
+      scope->stat->cycles += vector_stat_clock() - scope->start;
+  }
+
+  #define VECTOR_STAT \
+      static vector_stat vector_stat_record = {.name = __func__}; \
+      if (!vector_stat_record.registered) vector_stat_register(&vector_stat_record); \
+      vector_stat_record.calls++; \
+      __attribute__((cleanup(vector_stat_end))) vector_stat_scope vector_stat_scope_ = { \
+          &vector_stat_record, vector_stat_clock() \
+      }
+#else
+  #define VECTOR_STAT
+#endif
@@ -1,9 +1,26 @@
-local ffi = require("ffi")
+-- Backends, fastest first: FFI over libvector.so under LuaJIT, then the Lua C API module
+-- vector_old.so (`make capi`), which also loads into PUC Lua. VECTOR_BACKEND=ffi or capi forces one.
+local backend = os.getenv("VECTOR_BACKEND")
+local has_ffi, ffi = pcall(require, "ffi")
+local has_lib, C
+if has_ffi and backend ~= "capi" then
+  has_lib, C = pcall(ffi.load, "./libvector.so")
+end
 
-local vector = {}
+if not has_lib then
+  if backend == "ffi" then
+    error("Can not load the FFI backend: " .. tostring(has_ffi and C or ffi))
+  end
+  local open, err = package.loadlib("./vector_old.so", "luaopen_vector")
+  if not open then
+    error("Can not load a vector backend, build libvector.so or vector_old.so: " .. tostring(err))
+  end
+  return open()
+end
 
+local vector = {}
+vector.backend = "ffi"
 
-local C = ffi.load("./libvector.so")
 ffi.cdef[[
     typedef struct {
         int len;
@@ -26,17 +43,191 @@ ffi.cdef[[
     vector *vector_normalized_mut(vector *self);
     vector *vector_normalized2_mut(vector *self);
 
+    double vector_dot(const vector *self, const vector *other);
+    double vector_cross2(const vector *self, const vector *other);
+    vector *vector_cross3_into(const vector *self, const vector *other, vector *result);
+    double vector_dist(const vector *self, const vector *other);
+    double vector_dist2(const vector *self, const vector *other);
+    double vector_angle_between(const vector *self, const vector *other);
+    double *vector_distances(
+        const vector *origin, const vector *items, int32_t len, bool squared, double *result
+    );
+    int32_t vector_within_radius(
+        const vector *origin, const vector *items, int32_t len, double radius, int32_t *result, int32_t capacity
+    );
+
+    vector *vector_copy_into(const vector *self, vector *result);
+    vector *vector_unm_into(const vector *self, vector *result);
+    vector *vector_add_into(const vector *self, const vector *other, vector *result);
+    vector *vector_sub_into(const vector *self, const vector *other, vector *result);
+    vector *vector_mul_into(const vector *self, double k, vector *result);
+    vector *vector_div_into(const vector *self, double k, vector *result);
+    vector *vector_mod_into(const vector *self, double k, vector *result);
+    vector *vector_normalized_into(const vector *self, vector *result);
+    vector *vector_normalized2_into(const vector *self, vector *result);
+
+    vector *vector_madd_into(const vector *self, const vector *other, double k, vector *result);
+    vector *vector_axpy_into(double a, const vector *x, const vector *y, vector *result);
+    vector *vector_lerp_into(const vector *self, const vector *other, double t, vector *result);
+    vector *vector_fma_into(const vector *self, const vector *other, const vector *addend, vector *result);
+    vector *vector_clamp_into(const vector *self, const vector *min, const vector *max, vector *result);
+
+    typedef struct {
+        int32_t op;
+        int32_t arg;
+    } vector_op;
+
+    vector *vector_eval(
+        const vector_op *ops, int32_t len, const vector *const *operands, const double *scalars, vector *result
+    );
+
+    int32_t vector_swizzle_compile(const char *swizzle_str);
+    vector *vector_swizzle_mask(const vector *self, int32_t mask, vector *result);
     vector *vector_swizzle(const vector *self, const char *swizzle_str, vector *result);
     const char* vector_name_from_direction(const vector *self);
     bool vector_from_hex(const char *hex_str, vector *result);
+
+    int32_t vector_format(const vector *self, char *buffer, int32_t capacity);
+    int64_t vector_format_batch(
+        const vector *items, int64_t len, const char *separator, char *buffer, int64_t capacity
+    );
+    int64_t vector_parse(const char *text, int64_t len, vector *result, int64_t capacity, int64_t *consumed);
+
+    typedef struct {
+        int len;
+        int dim;
+        double *items[4];
+    } vector_array;
+
+    vector_array *vector_array_new(int len, int dim);
+    void vector_array_free(vector_array *self);
+    vector *vector_array_get(const vector_array *self, int i, vector *result);
+    vector_array *vector_array_set(vector_array *self, int i, const vector *value);
+
+    vector_array *vector_array_add_mut(vector_array *self, const vector_array *other);
+    vector_array *vector_array_sub_mut(vector_array *self, const vector_array *other);
+    vector_array *vector_array_mul_mut(vector_array *self, double k);
+    vector_array *vector_array_add_scaled_mut(vector_array *self, const vector_array *other, double k);
+    vector_array *vector_array_normalized_mut(vector_array *self);
+    double *vector_array_abs(const vector_array *self, double *result);
+
+    bool vector_simd_set(const char *name);
+    const char *vector_simd_name(void);
 ]]
 
+-- Named fields and swizzles: v.x, v.rgb, v.zyx = u. Each pattern is compiled into Lua source
+-- with constant indices on first use and cached, so traces see plain field loads and stores.
+-- Patterns take 1 to 4 letters, all from either xyzw or rgba.
+local swizzle_letters = {x = 0, y = 1, z = 2, w = 3, r = 0, g = 1, b = 2, a = 3}
+
+local swizzle_indices = function(key)
+  if type(key) ~= "string" or #key == 0 or #key > 4 then return nil end
+  if not key:find("^[xyzw]+$") and not key:find("^[rgba]+$") then return nil end
+
+  local result = {}
+  for i = 1, #key do
+    result[i] = swizzle_letters[key:sub(i, i)]
+  end
+  return result
+end
+
+local compile_getter = function(indices, allocate)
+  local lines = {
+    "local allocate = ...",
+    "return function(self)",
+    "  if self.len <= " .. math.max(unpack(indices)) .. " then return nil end",
+  }
+  if #indices == 1 then
+    table.insert(lines, "  return self.items[" .. indices[1] .. "]")
+  else
+    table.insert(lines, "  local result = allocate()")
+    table.insert(lines, "  result.len = " .. #indices)
+    for i, index in ipairs(indices) do
+      table.insert(lines, "  result.items[" .. (i - 1) .. "] = self.items[" .. index .. "]")
+    end
+    table.insert(lines, "  return result")
+  end
+  table.insert(lines, "end")
+  return loadstring(table.concat(lines, "\n"))(allocate)
+end
+
+-- nil for patterns repeating a letter
+local compile_setter = function(indices)
+  local seen = {}
+  for _, index in ipairs(indices) do
+    if seen[index] then return nil end
+    seen[index] = true
+  end
+
+  local lines = {
+    "return function(self, value)",
+    "  if self.len <= " .. math.max(unpack(indices)) .. " then",
+    "    error(\"Can not assign a component past the length of \" .. tostring(self))",
+    "  end",
+  }
+  if #indices == 1 then
+    table.insert(lines, "  self.items[" .. indices[1] .. "] = value")
+  else
+    -- Read everything first, so that v.xy = v.yx works
+    table.insert(lines, "  if value.len ~= " .. #indices .. " then")
+    table.insert(lines, "    error(\"Expected a vector of length " .. #indices .. ", got \" .. tostring(value))")
+    table.insert(lines, "  end")
+    for i = 1, #indices do
+      table.insert(lines, "  local item" .. i .. " = value.items[" .. (i - 1) .. "]")
+    end
+    for i, index in ipairs(indices) do
+      table.insert(lines, "  self.items[" .. index .. "] = item" .. i)
+    end
+  end
+  table.insert(lines, "end")
+  return loadstring(table.concat(lines, "\n"))()
+end
+
+-- __index and __newindex for a vector-like ctype: methods first, then swizzles, whose results
+-- come from allocate()
+local swizzle_access = function(methods, allocate)
+  local getters = {}
+  local setters = {}
+
+  local index = function(self, key)
+    local method = methods[key]
+    if method ~= nil then return method end
+
+    local getter = getters[key]
+    if getter == nil then
+      local indices = swizzle_indices(key)
+      getter = indices and compile_getter(indices, allocate) or false
+      getters[key] = getter
+    end
+    if getter then return getter(self) end
+  end
+
+  local newindex = function(self, key, value)
+    local setter = setters[key]
+    if setter == nil then
+      local indices = swizzle_indices(key)
+      setter = indices and compile_setter(indices) or false
+      setters[key] = setter
+    end
+    if not setter then
+      error("Can not assign field " .. tostring(key) .. " of " .. tostring(self))
+    end
+    setter(self, value)
+  end
+
+  return index, newindex
+end
+
+-- Allocates result vectors; swapped for the pooled allocator by vector.set_pooling
+local new_vector
+
 local vector_methods = {}
 vector.mt = {}
-vector.mt.__index = vector_methods
+vector.mt.__index, vector.mt.__newindex = swizzle_access(vector_methods, function() return new_vector() end)
 vector.mt.__eq = C.vector_eq
 
 local vector_cdata_type = ffi.metatype("vector", vector.mt)
+new_vector = vector_cdata_type
 
 
 vector.new = function(...)
@@ -45,7 +236,7 @@ vector.new = function(...)
     error("Too many arguments, max is " .. 4)
   end
 
-  local v = vector_cdata_type()
+  local v = new_vector()
   v.len = n
 
   for i = 1, n do
@@ -56,7 +247,7 @@ vector.new = function(...)
 end
 
 vector.hex = function(hex)
-  local result = vector_cdata_type()
+  local result = new_vector()
   if not C.vector_from_hex(hex, result) then
     error("Wrong hex format")
   end
@@ -80,6 +271,14 @@ vector.extended_directions = {
   vector.new(1, 1), vector.new(1, -1), vector.new(-1, -1), vector.new(-1, 1)
 }
 
+vector.simd = function()
+  return ffi.string(C.vector_simd_name())
+end
+
+vector.set_simd = function(name)
+  return C.vector_simd_set(name)
+end
+
 vector.name_from_direction = function(v)
   if v == vector.up then return "up" end
   if v == vector.down then return "down" end
@@ -87,12 +286,11 @@ vector.name_from_direction = function(v)
   if v == vector.right then return "right" end
 end
 
+local vector_size = ffi.sizeof(vector_cdata_type)
+
 vector_methods.copy = function(self)
-  local v = vector_cdata_type()
-  v.len = self.len
-  for i = 0, v.len - 1 do
-    v.items[i] = self.items[i]
-  end
+  local v = new_vector()
+  ffi.copy(v, self, vector_size)
   return v
 end
 
@@ -114,44 +312,162 @@ vector_methods.abs = C.vector_abs
 vector_methods.abs2 = C.vector_abs2
 vector_methods.normalized_mut = C.vector_normalized_mut
 vector_methods.normalized2_mut = C.vector_normalized2_mut
+
+-- The C kernels return NaN for different lengths, which would pass silently through arithmetic
+local same_len = function(f, name)
+  return function(self, other)
+    if self.len ~= other.len then
+      error("Can not take the " .. name .. " of " .. tostring(self) .. " and " .. tostring(other) .. ": lengths differ")
+    end
+    return f(self, other)
+  end
+end
+
+vector_methods.dot = same_len(C.vector_dot, "dot product")
+vector_methods.dist = same_len(C.vector_dist, "distance")
+vector_methods.dist2 = same_len(C.vector_dist2, "distance")
+vector_methods.angle_between = same_len(C.vector_angle_between, "angle")
 vector.mt.__lt = C.vector_lt
 vector.mt.__le = C.vector_le
 
+vector_methods.copy_into = C.vector_copy_into
+vector_methods.unm_into = C.vector_unm_into
+vector_methods.add_into = C.vector_add_into
+vector_methods.sub_into = C.vector_sub_into
+vector_methods.mul_into = C.vector_mul_into
+vector_methods.div_into = C.vector_div_into
+vector_methods.mod_into = C.vector_mod_into
+vector_methods.normalized_into = C.vector_normalized_into
+vector_methods.normalized2_into = C.vector_normalized2_into
+
+vector.mt.__unm = function(self)
+  local result = new_vector()
+  C.vector_unm_into(self, result)
+  return result
+end
+
+-- Lazy expressions are a recorder table, see vector.lazy
+local expression_mt = {}
+
 vector.mt.__add = function(self, other)
-  return self:copy():add_mut(other)
+  if type(other) == "table" then
+    return expression_mt.__add(self, other)
+  end
+  local result = new_vector()
+  C.vector_add_into(self, other, result)
+  return result
 end
 
 vector.mt.__sub = function(self, other)
-  return self:copy():sub_mut(other)
+  if type(other) == "table" then
+    return expression_mt.__sub(self, other)
+  end
+  local result = new_vector()
+  C.vector_sub_into(self, other, result)
+  return result
 end
 
 vector.mt.__mul = function(self, other)
-  return self:copy():mul_mut(other)
+  local result = new_vector()
+  C.vector_mul_into(self, other, result)
+  return result
 end
 
 vector.mt.__div = function(self, other)
-  return self:copy():div_mut(other)
+  local result = new_vector()
+  C.vector_div_into(self, other, result)
+  return result
 end
 
 vector.mt.__mod = function(self, other)
-  return self:copy():mod_mut(other)
+  local result = new_vector()
+  C.vector_mod_into(self, other, result)
+  return result
 end
 
 vector_methods.normalized = function(self)
-  return self:copy():normalized_mut()
+  local result = new_vector()
+  C.vector_normalized_into(self, result)
+  return result
 end
 
 vector_methods.normalized2 = function(self)
-  return self:copy():normalized2_mut()
+  local result = new_vector()
+  if C.vector_normalized2_into(self, result) == nil then return nil end
+  return result
+end
+
+-- A number for 2D vectors (z of the 3D product), a vector for 3D ones
+vector_methods.cross = function(self, other, result)
+  if self.len == 2 and other.len == 2 then
+    return C.vector_cross2(self, other)
+  end
+  result = result or new_vector()
+  if C.vector_cross3_into(self, other, result) == nil then
+    error("Can not cross " .. tostring(self) .. " and " .. tostring(other) .. ": expected two 2D or 3D vectors")
+  end
+  return result
+end
+
+vector_methods.madd_into = C.vector_madd_into
+vector_methods.lerp_into = C.vector_lerp_into
+vector_methods.fma_into = C.vector_fma_into
+vector_methods.clamp_into = C.vector_clamp_into
+
+vector_methods.madd = function(self, other, k)
+  local result = new_vector()
+  C.vector_madd_into(self, other, k, result)
+  return result
+end
+
+vector_methods.lerp = function(self, other, t)
+  local result = new_vector()
+  C.vector_lerp_into(self, other, t, result)
+  return result
+end
+
+vector_methods.fma = function(self, other, addend)
+  local result = new_vector()
+  C.vector_fma_into(self, other, addend, result)
+  return result
+end
+
+vector_methods.clamp = function(self, min, max)
+  local result = new_vector()
+  C.vector_clamp_into(self, min, max, result)
+  return result
+end
+
+vector.axpy = function(a, x, y, result)
+  result = result or new_vector()
+  C.vector_axpy_into(a, x, y, result)
+  return result
 end
 
 vector_methods.map_mut = function(self, f)
-  for i = 0, self.len do
+  for i = 0, self.len - 1 do
     self.items[i] = f(self.items[i])
   end
   return self
 end
 
+local swizzle_masks = {}
+
+-- Pattern string as in v:swizzle("zyx"), compiled once into a mask; also works for patterns held
+-- in variables, where the field syntax does not apply
+vector_methods.swizzle = function(self, pattern, result)
+  local mask = swizzle_masks[pattern]
+  if mask == nil then
+    mask = C.vector_swizzle_compile(pattern)
+    swizzle_masks[pattern] = mask
+  end
+  result = result or new_vector()
+  if mask < 0 or C.vector_swizzle_mask(self, mask, result) == nil then
+    error("Can not swizzle " .. tostring(self) .. " with " .. pattern)
+  end
+  return result
+end
+
 vector_methods.map = function(self, f)
   return self:copy():map_mut(f)
 end
@@ -160,15 +476,1869 @@ vector.mt.__len = function(self)
   return self.len
 end
 
+-- Fits 4 components of the longest %.14g form; see format.c
+local format_capacity = 128
+local format_buffer = ffi.new("char[?]", format_capacity)
+
 vector.mt.__tostring = function(self)
-  local result = "{"
-  for i = 0, self.len - 1 do
-    if i > 0 then
-      result = result .. "; "
-    end
-    result = result .. self.items[i]
+  return ffi.string(format_buffer, C.vector_format(self, format_buffer, format_capacity))
+end
+
+-- Lazy expressions record +, -, * k, / k and unary minus over vectors and evaluate them with a
+-- single vector_eval call, allocating at most the result:
+--   (vector.lazy(vel) * dt + pos):eval(pos)
+-- Lua evaluates both operands of an operator before calling its metamethod, so appending each
+-- operation as it happens yields the postfix program directly. Every expression therefore is
+-- the same recorder writing into one reusable program, and building one allocates nothing. It
+-- also means one expression is built at a time and :eval consumes it; an abandoned one makes
+-- the next :eval fail once, after which the program starts over.
+local OP_PUSH, OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_UNM = 0, 1, 2, 3, 4, 5
+
+local PROGRAM_SIZE = 64
+local program = ffi.new("vector_op[?]", PROGRAM_SIZE)
+local program_operands = ffi.new("const vector *[?]", PROGRAM_SIZE)
+local program_scalars = ffi.new("double[?]", PROGRAM_SIZE)
+-- program_operands holds bare pointers, this keeps the operands themselves alive until eval
+local operand_refs = {}
+local program_len, operands_len, scalars_len = 0, 0, 0
+
+local expression_methods = {}
+expression_mt.__index = expression_methods
+local recorder = setmetatable({}, expression_mt)
+
+local reset_program = function()
+  for i = 0, operands_len - 1 do
+    operand_refs[i] = nil
+  end
+  program_len, operands_len, scalars_len = 0, 0, 0
+end
+
+local emit = function(op, arg)
+  if program_len == PROGRAM_SIZE then
+    reset_program()
+    error("Expression is too long, max is " .. PROGRAM_SIZE .. " operations")
+  end
+  program[program_len].op = op
+  program[program_len].arg = arg or 0
+  program_len = program_len + 1
+  return recorder
+end
+
+local push = function(v)
+  if not ffi.istype(vector_cdata_type, v) then
+    reset_program()
+    error("Can not use " .. tostring(v) .. " in a lazy expression, expected a vector")
+  end
+  emit(OP_PUSH, operands_len)
+  program_operands[operands_len] = v
+  operand_refs[operands_len] = v
+  operands_len = operands_len + 1
+end
+
+local scale = function(op, k)
+  if type(k) ~= "number" then
+    reset_program()
+    error("Lazy expressions can only be multiplied and divided by numbers")
+  end
+  program_scalars[scalars_len] = k
+  scalars_len = scalars_len + 1
+  return emit(op, scalars_len - 1)
+end
+
+vector.lazy = function(v)
+  push(v)
+  return recorder
+end
+
+-- An operand that is not the recorder is a plain vector pushed after the recorded side
+expression_mt.__add = function(a, b)
+  if not rawequal(a, recorder) then
+    push(a)
+  elseif not rawequal(b, recorder) then
+    push(b)
+  end
+  return emit(OP_ADD)
+end
+
+expression_mt.__sub = function(a, b)
+  if not rawequal(a, recorder) then
+    -- a - e computed as -e + a, which is exact
+    emit(OP_UNM)
+    push(a)
+    return emit(OP_ADD)
+  end
+  if not rawequal(b, recorder) then
+    push(b)
   end
-  return result .. "}"
+  return emit(OP_SUB)
+end
+
+expression_mt.__mul = function(a, b)
+  return scale(OP_MUL, rawequal(a, recorder) and b or a)
+end
+
+expression_mt.__div = function(a, k)
+  if not rawequal(a, recorder) then
+    reset_program()
+    error("Can not divide by a lazy expression")
+  end
+  return scale(OP_DIV, k)
+end
+
+expression_mt.__unm = function()
+  return emit(OP_UNM)
+end
+
+expression_methods.eval = function(_, result)
+  result = result or new_vector()
+  local ok = C.vector_eval(program, program_len, program_operands, program_scalars, result) ~= nil
+  reset_program()
+  if not ok then
+    error("Can not evaluate expression: vector lengths differ, it is nested too deep or another one was left unevaluated")
+  end
+  return result
+end
+
+expression_mt.__tostring = function(self)
+  return tostring(self:eval())
+end
+
+
+local array_methods = {}
+vector.array_mt = {}
+vector.array_mt.__index = array_methods
+
+ffi.metatype("vector_array", vector.array_mt)
+
+vector.array = function(n, dim)
+  local result = C.vector_array_new(n, dim or 2)
+  if result == nil then
+    error("Can not allocate vector array of " .. n .. " elements with dimension " .. tostring(dim))
+  end
+  return ffi.gc(result, C.vector_array_free)
+end
+
+array_methods.get = function(self, i, result)
+  result = result or new_vector()
+  if C.vector_array_get(self, i - 1, result) == nil then
+    error("Index " .. i .. " is out of bounds for vector array of length " .. self.len)
+  end
+  return result
+end
+
+array_methods.set = function(self, i, v)
+  if C.vector_array_set(self, i - 1, v) == nil then
+    error("Can not set vector " .. tostring(v) .. " at index " .. i)
+  end
+  return self
+end
+
+array_methods.abs = function(self, result)
+  result = result or ffi.new("double[?]", self.len)
+  C.vector_array_abs(self, result)
+  return result
+end
+
+-- Return self rather than the pointer C hands back, which carries no finalizer
+local array_shape_error = function(self, other)
+  error(
+    "Can not combine vector array of " .. self.len .. " elements with dimension " .. self.dim
+    .. " and one of " .. other.len .. " elements with dimension " .. other.dim
+  )
+end
+
+array_methods.add_mut = function(self, other)
+  if C.vector_array_add_mut(self, other) == nil then array_shape_error(self, other) end
+  return self
+end
+
+array_methods.sub_mut = function(self, other)
+  if C.vector_array_sub_mut(self, other) == nil then array_shape_error(self, other) end
+  return self
+end
+
+array_methods.mul_mut = function(self, k)
+  C.vector_array_mul_mut(self, k)
+  return self
+end
+
+array_methods.add_scaled_mut = function(self, other, k)
+  if C.vector_array_add_scaled_mut(self, other, k) == nil then array_shape_error(self, other) end
+  return self
+end
+
+array_methods.normalized_mut = function(self)
+  C.vector_array_normalized_mut(self)
+  return self
+end
+
+vector.array_mt.__len = function(self)
+  return self.len
+end
+
+
+ffi.cdef[[
+    typedef struct {
+        int len;
+        float items[4];
+    } vectorf;
+
+    vectorf *vectorf_unm_mut(vectorf *self);
+    vectorf *vectorf_add_mut(vectorf *self, const vectorf *other);
+    vectorf *vectorf_sub_mut(vectorf *self, const vectorf *other);
+    vectorf *vectorf_mul_mut(vectorf *self, double k);
+    vectorf *vectorf_div_mut(vectorf *self, double k);
+    vectorf *vectorf_mod_mut(vectorf *self, double k);
+
+    bool vectorf_eq(const vectorf *self, const vectorf *other);
+    bool vectorf_lt(const vectorf *self, const vectorf *other);
+    bool vectorf_le(const vectorf *self, const vectorf *other);
+
+    double vectorf_abs(const vectorf *self);
+    double vectorf_abs2(const vectorf *self);
+    vectorf *vectorf_normalized_mut(vectorf *self);
+    vectorf *vectorf_normalized2_mut(vectorf *self);
+
+    vectorf *vectorf_copy_into(const vectorf *self, vectorf *result);
+    vectorf *vectorf_unm_into(const vectorf *self, vectorf *result);
+    vectorf *vectorf_add_into(const vectorf *self, const vectorf *other, vectorf *result);
+    vectorf *vectorf_sub_into(const vectorf *self, const vectorf *other, vectorf *result);
+    vectorf *vectorf_mul_into(const vectorf *self, double k, vectorf *result);
+    vectorf *vectorf_div_into(const vectorf *self, double k, vectorf *result);
+    vectorf *vectorf_mod_into(const vectorf *self, double k, vectorf *result);
+    vectorf *vectorf_normalized_into(const vectorf *self, vectorf *result);
+    vectorf *vectorf_normalized2_into(const vectorf *self, vectorf *result);
+
+    vectorf *vectorf_from_vector(const vector *source, vectorf *result);
+    vector *vector_from_vectorf(const vectorf *source, vector *result);
+    bool vectorf_from_hex(const char *hex_str, vectorf *result);
+]]
+
+local vectorf_methods = {}
+vector.f_mt = {}
+vector.f_mt.__index, vector.f_mt.__newindex = swizzle_access(vectorf_methods, ffi.typeof("vectorf"))
+vector.f_mt.__eq = C.vectorf_eq
+vector.f_mt.__lt = C.vectorf_lt
+vector.f_mt.__le = C.vectorf_le
+
+local vectorf_cdata_type = ffi.metatype("vectorf", vector.f_mt)
+local vectorf_size = ffi.sizeof(vectorf_cdata_type)
+
+vector.newf = function(...)
+  local n = select('#', ...)
+  if n > 4 then
+    error("Too many arguments, max is " .. 4)
+  end
+
+  local v = vectorf_cdata_type()
+  v.len = n
+
+  for i = 1, n do
+    v.items[i - 1] = select(i, ...)
+  end
+
+  return v
+end
+
+vector.hexf = function(hex)
+  local result = vectorf_cdata_type()
+  if not C.vectorf_from_hex(hex, result) then
+    error("Wrong hex format")
+  end
+  return result
+end
+
+for _, name in ipairs({
+  "unm_mut", "add_mut", "sub_mut", "mul_mut", "div_mut", "mod_mut",
+  "abs", "abs2", "normalized_mut", "normalized2_mut",
+  "copy_into", "unm_into", "add_into", "sub_into", "mul_into", "div_into", "mod_into",
+  "normalized_into", "normalized2_into",
+}) do
+  vectorf_methods[name] = C["vectorf_" .. name]
+end
+
+vectorf_methods.copy = function(self)
+  local v = vectorf_cdata_type()
+  ffi.copy(v, self, vectorf_size)
+  return v
+end
+
+vectorf_methods.unpack = vector_methods.unpack
+vectorf_methods.map_mut = vector_methods.map_mut
+vectorf_methods.map = vector_methods.map
+
+vectorf_methods.to_vector = function(self, result)
+  result = result or new_vector()
+  C.vector_from_vectorf(self, result)
+  return result
+end
+
+vector_methods.to_vectorf = function(self, result)
+  result = result or vectorf_cdata_type()
+  C.vectorf_from_vector(self, result)
+  return result
+end
+
+local binary_operator = function(ctype, f)
+  return function(self, other)
+    local result = ctype()
+    f(self, other, result)
+    return result
+  end
+end
+
+vector.f_mt.__add = binary_operator(vectorf_cdata_type, C.vectorf_add_into)
+vector.f_mt.__sub = binary_operator(vectorf_cdata_type, C.vectorf_sub_into)
+vector.f_mt.__mul = binary_operator(vectorf_cdata_type, C.vectorf_mul_into)
+vector.f_mt.__div = binary_operator(vectorf_cdata_type, C.vectorf_div_into)
+vector.f_mt.__mod = binary_operator(vectorf_cdata_type, C.vectorf_mod_into)
+
+vector.f_mt.__unm = function(self)
+  local result = vectorf_cdata_type()
+  C.vectorf_unm_into(self, result)
+  return result
+end
+
+vectorf_methods.normalized = function(self)
+  local result = vectorf_cdata_type()
+  C.vectorf_normalized_into(self, result)
+  return result
+end
+
+vectorf_methods.normalized2 = function(self)
+  local result = vectorf_cdata_type()
+  if C.vectorf_normalized2_into(self, result) == nil then return nil end
+  return result
+end
+
+vector.f_mt.__len = vector.mt.__len
+vector.f_mt.__tostring = function(self)
+  return tostring(self:to_vector())
+end
+
+
+local vec_cdef = [[
+    typedef struct {
+        double items[N];
+    } vecN;
+
+    vecN *vecN_unm_mut(vecN *self);
+    vecN *vecN_add_mut(vecN *self, const vecN *other);
+    vecN *vecN_sub_mut(vecN *self, const vecN *other);
+    vecN *vecN_mul_mut(vecN *self, double k);
+    vecN *vecN_div_mut(vecN *self, double k);
+    vecN *vecN_mod_mut(vecN *self, double k);
+
+    bool vecN_eq(const vecN *self, const vecN *other);
+    bool vecN_lt(const vecN *self, const vecN *other);
+    bool vecN_le(const vecN *self, const vecN *other);
+
+    double vecN_abs(const vecN *self);
+    double vecN_abs2(const vecN *self);
+    vecN *vecN_normalized_mut(vecN *self);
+
+    vecN *vecN_unm_into(const vecN *self, vecN *result);
+    vecN *vecN_add_into(const vecN *self, const vecN *other, vecN *result);
+    vecN *vecN_sub_into(const vecN *self, const vecN *other, vecN *result);
+    vecN *vecN_mul_into(const vecN *self, double k, vecN *result);
+    vecN *vecN_div_into(const vecN *self, double k, vecN *result);
+    vecN *vecN_mod_into(const vecN *self, double k, vecN *result);
+    vecN *vecN_normalized_into(const vecN *self, vecN *result);
+
+    vecN *vecN_from_vector(const vector *source, vecN *result);
+    vector *vector_from_vecN(const vecN *source, vector *result);
+]]
+
+-- vec2, vec3 and vec4 are fixed-width vectors without len; their kernels are unrolled per width
+local vec_cdata_types = {}
+
+local vec_unpack = {
+  [2] = function(self) return self.items[0], self.items[1] end,
+  [3] = function(self) return self.items[0], self.items[1], self.items[2] end,
+  [4] = function(self) return self.items[0], self.items[1], self.items[2], self.items[3] end,
+}
+
+for n = 2, 4 do
+  local name = "vec" .. n
+  ffi.cdef((vec_cdef:gsub("N", n)))
+
+  local methods = {}
+  local mt = {__index = methods}
+  vector[name .. "_mt"] = mt
+  mt.__eq = C[name .. "_eq"]
+  mt.__lt = C[name .. "_lt"]
+  mt.__le = C[name .. "_le"]
+
+  local ctype = ffi.metatype(name, mt)
+  vec_cdata_types[n] = ctype
+  local size = ffi.sizeof(ctype)
+
+  for _, method in ipairs({
+    "unm_mut", "add_mut", "sub_mut", "mul_mut", "div_mut", "mod_mut",
+    "abs", "abs2", "normalized_mut",
+    "unm_into", "add_into", "sub_into", "mul_into", "div_into", "mod_into", "normalized_into",
+  }) do
+    methods[method] = C[name .. "_" .. method]
+  end
+
+  methods.copy = function(self)
+    local v = ctype()
+    ffi.copy(v, self, size)
+    return v
+  end
+
+  methods.copy_into = function(self, result)
+    ffi.copy(result, self, size)
+    return result
+  end
+
+  methods.unpack = vec_unpack[n]
+
+  methods.map_mut = function(self, f)
+    for i = 0, n - 1 do
+      self.items[i] = f(self.items[i])
+    end
+    return self
+  end
+
+  methods.map = function(self, f)
+    return self:copy():map_mut(f)
+  end
+
+  methods.to_vector = function(self, result)
+    result = result or new_vector()
+    C["vector_from_" .. name](self, result)
+    return result
+  end
+
+  mt.__add = binary_operator(ctype, C[name .. "_add_into"])
+  mt.__sub = binary_operator(ctype, C[name .. "_sub_into"])
+  mt.__mul = binary_operator(ctype, C[name .. "_mul_into"])
+  mt.__div = binary_operator(ctype, C[name .. "_div_into"])
+  mt.__mod = binary_operator(ctype, C[name .. "_mod_into"])
+
+  mt.__unm = function(self)
+    local result = ctype()
+    C[name .. "_unm_into"](self, result)
+    return result
+  end
+
+  methods.normalized = function(self)
+    local result = ctype()
+    C[name .. "_normalized_into"](self, result)
+    return result
+  end
+
+  mt.__len = function()
+    return n
+  end
+
+  mt.__tostring = function(self)
+    local result = "{"
+    for i = 0, n - 1 do
+      if i > 0 then
+        result = result .. "; "
+      end
+      result = result .. self.items[i]
+    end
+    return result .. "}"
+  end
+end
+
+ffi.cdef[[
+    vec2 *vec2_normalized2_mut(vec2 *self);
+    vec2 *vec2_normalized2_into(const vec2 *self, vec2 *result);
+]]
+
+vector.vec2_mt.__index.normalized2_mut = C.vec2_normalized2_mut
+vector.vec2_mt.__index.normalized2_into = C.vec2_normalized2_into
+vector.vec2_mt.__index.normalized2 = function(self)
+  local result = vec_cdata_types[2]()
+  C.vec2_normalized2_into(self, result)
+  return result
+end
+
+-- Picks vec2, vec3 or vec4 by the number of arguments
+vector.vec = function(...)
+  local n = select('#', ...)
+  local ctype = vec_cdata_types[n]
+  if not ctype then
+    error("Fixed-width vectors have 2 to 4 components, got " .. n)
+  end
+
+  local v = ctype()
+  for i = 1, n do
+    v.items[i - 1] = select(i, ...)
+  end
+  return v
+end
+
+vector.vec2 = function(x, y)
+  local v = vec_cdata_types[2]()
+  v.items[0], v.items[1] = x, y
+  return v
+end
+
+vector.vec3 = function(x, y, z)
+  local v = vec_cdata_types[3]()
+  v.items[0], v.items[1], v.items[2] = x, y, z
+  return v
+end
+
+vector.vec4 = function(x, y, z, w)
+  local v = vec_cdata_types[4]()
+  v.items[0], v.items[1], v.items[2], v.items[3] = x, y, z, w
+  return v
+end
+
+vector_methods.to_vec = function(self, result)
+  local ctype = vec_cdata_types[self.len]
+  if not ctype then
+    error("Fixed-width vectors have 2 to 4 components, got " .. self.len)
+  end
+  result = result or ctype()
+  C["vec" .. self.len .. "_from_vector"](self, result)
+  return result
+end
+
+
+ffi.cdef[[
+    typedef struct {
+        int32_t items[2];
+    } ivec2;
+
+    typedef struct {
+        int32_t items[3];
+    } ivec3;
+
+    uint32_t ivec2_hash(const ivec2 *self);
+    uint32_t ivec3_hash(const ivec3 *self);
+    bool ivec2_eq(const ivec2 *self, const ivec2 *other);
+    bool ivec3_eq(const ivec3 *self, const ivec3 *other);
+    ivec2 *ivec2_add_mut(ivec2 *self, const ivec2 *other);
+    ivec3 *ivec3_add_mut(ivec3 *self, const ivec3 *other);
+    ivec2 *ivec2_sub_mut(ivec2 *self, const ivec2 *other);
+    ivec3 *ivec3_sub_mut(ivec3 *self, const ivec3 *other);
+    ivec2 *ivec2_from_vector(const vector *source, ivec2 *result);
+    ivec3 *ivec3_from_vector(const vector *source, ivec3 *result);
+
+    typedef struct ivec_map ivec_map;
+
+    ivec_map *ivec_map_new(int dim, size_t capacity);
+    void ivec_map_free(ivec_map *self);
+    int ivec_map_dim(const ivec_map *self);
+    size_t ivec_map_count(const ivec_map *self);
+    void ivec_map_clear(ivec_map *self);
+    bool ivec_map_set(ivec_map *self, const int32_t *key, int64_t value);
+    bool ivec_map_get(const ivec_map *self, const int32_t *key, int64_t *value);
+    bool ivec_map_remove(ivec_map *self, const int32_t *key);
+    bool ivec_map_next(const ivec_map *self, size_t *cursor, int32_t *key, int64_t *value);
+]]
+
+-- Integer grid vectors, hashable by value and usable as keys of vector.ivec_map
+local ivec_cdata_types = {}
+
+for n = 2, 3 do
+  local name = "ivec" .. n
+  local methods = {}
+  local mt = {__index = methods}
+  vector[name .. "_mt"] = mt
+  mt.__eq = C[name .. "_eq"]
+
+  local ctype = ffi.metatype(name, mt)
+  ivec_cdata_types[n] = ctype
+
+  methods.hash = C[name .. "_hash"]
+  methods.add_mut = C[name .. "_add_mut"]
+  methods.sub_mut = C[name .. "_sub_mut"]
+  methods.unpack = vec_unpack[n]
+
+  local size = ffi.sizeof(ctype)
+
+  methods.copy = function(self)
+    local v = ctype()
+    ffi.copy(v, self, size)
+    return v
+  end
+
+  methods.to_vector = function(self)
+    return vector.new(self:unpack())
+  end
+
+  mt.__add = function(self, other)
+    return self:copy():add_mut(other)
+  end
+
+  mt.__sub = function(self, other)
+    return self:copy():sub_mut(other)
+  end
+
+  mt.__len = function()
+    return n
+  end
+
+  mt.__tostring = vector["vec" .. n .. "_mt"].__tostring
+end
+
+vector.ivec2 = function(x, y)
+  local v = ivec_cdata_types[2]()
+  v.items[0], v.items[1] = x, y
+  return v
+end
+
+vector.ivec3 = function(x, y, z)
+  local v = ivec_cdata_types[3]()
+  v.items[0], v.items[1], v.items[2] = x, y, z
+  return v
+end
+
+-- Floors the coordinates
+vector_methods.to_ivec = function(self, result)
+  local ctype = ivec_cdata_types[self.len]
+  if not ctype then
+    error("Integer vectors have 2 or 3 components, got " .. self.len)
+  end
+  result = result or ctype()
+  C["ivec" .. self.len .. "_from_vector"](self, result)
+  return result
+end
+
+local map_methods = {}
+vector.ivec_map_mt = {__index = map_methods}
+ffi.metatype("ivec_map", vector.ivec_map_mt)
+
+local map_value = ffi.new("int64_t[1]")
+
+vector.ivec_map = function(dim, capacity)
+  local result = C.ivec_map_new(dim or 2, capacity or 0)
+  if result == nil then
+    error("Can not allocate map with " .. tostring(dim) .. "-dimensional keys and capacity " .. tostring(capacity))
+  end
+  return ffi.gc(result, C.ivec_map_free)
+end
+
+-- C reads dim int32 items from the key, so anything but an ivec of the map's dimension is refused
+local map_key = function(self, key)
+  local dim = C.ivec_map_dim(self)
+  if not ffi.istype(ivec_cdata_types[dim], key) then
+    error("Expected an ivec" .. dim .. " key, got " .. tostring(key))
+  end
+  return key.items
+end
+
+map_methods.set = function(self, key, value)
+  if not C.ivec_map_set(self, map_key(self, key), value) then
+    error("Out of memory")
+  end
+  return self
+end
+
+map_methods.get = function(self, key)
+  if C.ivec_map_get(self, map_key(self, key), map_value) then
+    return tonumber(map_value[0])
+  end
+end
+
+map_methods.has = function(self, key)
+  return C.ivec_map_get(self, map_key(self, key), nil)
+end
+
+map_methods.remove = function(self, key)
+  return C.ivec_map_remove(self, map_key(self, key))
+end
+
+map_methods.clear = C.ivec_map_clear
+
+-- for key, value in map:each() do ... end; keys are fresh ivecs
+map_methods.each = function(self)
+  local cursor = ffi.new("size_t[1]")
+  local value = ffi.new("int64_t[1]")
+  local key_type = ivec_cdata_types[C.ivec_map_dim(self)]
+  return function()
+    local key = key_type()
+    if C.ivec_map_next(self, cursor, key.items, value) then
+      return key, tonumber(value[0])
+    end
+  end
+end
+
+vector.ivec_map_mt.__len = function(self)
+  return tonumber(C.ivec_map_count(self))
+end
+
+
+ffi.cdef[[
+    typedef struct spatial_hash spatial_hash;
+
+    spatial_hash *spatial_hash_new(int dim, double cell_size);
+    void spatial_hash_free(spatial_hash *self);
+    int32_t spatial_hash_count(const spatial_hash *self);
+    bool spatial_hash_insert(spatial_hash *self, int32_t id, const vector *position);
+    bool spatial_hash_move(spatial_hash *self, int32_t id, const vector *position);
+    bool spatial_hash_remove(spatial_hash *self, int32_t id);
+    void spatial_hash_clear(spatial_hash *self);
+    int32_t spatial_hash_query_radius(
+        const spatial_hash *self, const vector *center, double radius, int32_t *result, int32_t capacity
+    );
+    int32_t spatial_hash_query_aabb(
+        const spatial_hash *self, const vector *min, const vector *max, int32_t *result, int32_t capacity
+    );
+]]
+
+local spatial_methods = {}
+vector.spatial_hash_mt = {__index = spatial_methods}
+ffi.metatype("spatial_hash", vector.spatial_hash_mt)
+
+vector.spatial_hash = function(cell_size, dim)
+  local result = C.spatial_hash_new(dim or 2, cell_size)
+  if result == nil then
+    error("Can not create spatial hash with cell size " .. tostring(cell_size))
+  end
+  return ffi.gc(result, C.spatial_hash_free)
+end
+
+vector.id_buffer = function(capacity)
+  return ffi.new("int32_t[?]", capacity)
+end
+
+spatial_methods.insert = function(self, id, position)
+  if not C.spatial_hash_insert(self, id, position) then
+    error("Can not insert " .. tostring(position) .. " with id " .. id)
+  end
+  return self
+end
+
+spatial_methods.move = C.spatial_hash_move
+spatial_methods.remove = C.spatial_hash_remove
+spatial_methods.clear = C.spatial_hash_clear
+
+-- Without a buffer counts the matches first and allocates an exact one
+local query = function(f)
+  return function(self, a, b, result, capacity)
+    if result == nil then
+      capacity = f(self, a, b, nil, 0)
+      result = vector.id_buffer(capacity)
+    elseif capacity == nil then
+      error("Missing capacity for the result buffer")
+    end
+    local n = f(self, a, b, result, capacity)
+    return result, math.min(n, capacity), n
+  end
+end
+
+spatial_methods.query_radius = query(C.spatial_hash_query_radius)
+spatial_methods.query_aabb = query(C.spatial_hash_query_aabb)
+
+vector.spatial_hash_mt.__len = function(self)
+  return C.spatial_hash_count(self)
+end
+
+
+ffi.cdef[[
+    typedef struct kd_tree kd_tree;
+
+    kd_tree *kd_tree_new(const vector *points, int32_t len);
+    void kd_tree_free(kd_tree *self);
+    int32_t kd_tree_len(const kd_tree *self);
+    int32_t kd_tree_nearest(const kd_tree *self, const vector *query, double *distance);
+    int32_t kd_tree_k_nearest(
+        const kd_tree *self, const vector *query, int32_t k, int32_t *result, double *distances
+    );
+    void kd_tree_nearest_batch(
+        const kd_tree *self, const vector *queries, int32_t len, int32_t *result, double *distances
+    );
+    int32_t kd_tree_radius(
+        const kd_tree *self, const vector *query, double radius, int32_t *result, int32_t capacity
+    );
+]]
+
+-- Packs a Lua sequence of vectors into a contiguous vector[?]; cdata buffers pass through
+local vector_buffer_type = ffi.typeof("vector[?]")
+
+local pack_vectors = function(points, n)
+  if type(points) ~= "table" then
+    return points, n
+  end
+  n = #points
+  local buffer = vector_buffer_type(n)
+  for i = 1, n do
+    ffi.copy(buffer + (i - 1), points[i], vector_size)
+  end
+  return buffer, n
+end
+
+vector.buffer = function(n)
+  return vector_buffer_type(n)
+end
+
+local kd_methods = {}
+vector.kd_tree_mt = {__index = kd_methods}
+ffi.metatype("kd_tree", vector.kd_tree_mt)
+
+vector.kd_tree = function(points, n)
+  local buffer
+  buffer, n = pack_vectors(points, n)
+  local result = C.kd_tree_new(buffer, n)
+  if result == nil then
+    error("Can not build k-d tree: points should all have the same length between 2 and 4")
+  end
+  return ffi.gc(result, C.kd_tree_free)
+end
+
+local kd_distance = ffi.new("double[1]")
+
+kd_methods.nearest = function(self, query)
+  local i = C.kd_tree_nearest(self, query, kd_distance)
+  if i < 0 then return nil end
+  return i + 1, kd_distance[0]
+end
+
+kd_methods.k_nearest = function(self, query, k, result, distances)
+  result = result or vector.id_buffer(k)
+  distances = distances or ffi.new("double[?]", k)
+  local n = C.kd_tree_k_nearest(self, query, k, result, distances)
+  return result, n, distances
+end
+
+kd_methods.radius = function(self, query, radius, result, capacity)
+  if result == nil then
+    capacity = C.kd_tree_radius(self, query, radius, nil, 0)
+    result = vector.id_buffer(capacity)
+  elseif capacity == nil then
+    error("Missing capacity for the result buffer")
+  end
+  local n = C.kd_tree_radius(self, query, radius, result, capacity)
+  return result, math.min(n, capacity), n
+end
+
+kd_methods.nearest_batch = function(self, queries, n, result, distances)
+  queries, n = pack_vectors(queries, n)
+  result = result or vector.id_buffer(n)
+  C.kd_tree_nearest_batch(self, queries, n, result, distances)
+  return result, distances
+end
+
+vector.kd_tree_mt.__len = function(self)
+  return C.kd_tree_len(self)
+end
+
+
+local mat_cdef = [[
+    typedef struct {
+        double items[SIZE];
+    } matN;
+
+    matN *matN_identity(matN *result);
+    matN *matN_mul(const matN *self, const matN *other, matN *result);
+    matN *matN_inverse(const matN *self, matN *result);
+    matN *matN_transpose(const matN *self, matN *result);
+    vector *matN_transform(const matN *self, const vector *v, vector *result);
+    bool matN_transform_points(const matN *self, const vector *points, vector *result, int32_t len);
+    vector_array *matN_transform_array(const matN *self, const vector_array *source, vector_array *result);
+]]
+
+-- Row-major mat2, mat3 (2D affine) and mat4; `m * m` composes, `m * v` transforms
+local mat_cdata_types = {}
+
+for n = 2, 4 do
+  local name = "mat" .. n
+  ffi.cdef((mat_cdef:gsub("SIZE", n * n):gsub("N", n)))
+
+  local methods = {}
+  local mt = {__index = methods}
+  vector[name .. "_mt"] = mt
+
+  local ctype = ffi.metatype(name, mt)
+  mat_cdata_types[n] = ctype
+
+  vector[name] = function(...)
+    local result = ctype()
+    local count = select('#', ...)
+    if count == 0 then
+      C[name .. "_identity"](result)
+      return result
+    end
+    if count ~= n * n then
+      error(name .. " takes 0 or " .. n * n .. " arguments, got " .. count)
+    end
+    for i = 1, count do
+      result.items[i - 1] = select(i, ...)
+    end
+    return result
+  end
+
+  methods.inverse = function(self)
+    local result = ctype()
+    if C[name .. "_inverse"](self, result) == nil then return nil end
+    return result
+  end
+
+  methods.transpose = function(self)
+    local result = ctype()
+    C[name .. "_transpose"](self, result)
+    return result
+  end
+
+  methods.mul_into = C[name .. "_mul"]
+  methods.transform_into = C[name .. "_transform"]
+
+  methods.transform_points = function(self, points, n_points, result)
+    points, n_points = pack_vectors(points, n_points)
+    result = result or vector_buffer_type(n_points)
+    if not C[name .. "_transform_points"](self, points, result, n_points) then
+      error(name .. " can not transform vectors of this length")
+    end
+    return result
+  end
+
+  methods.transform_array = function(self, source, result)
+    result = result or vector.array(source.len, source.dim)
+    if C[name .. "_transform_array"](self, source, result) == nil then
+      error(name .. " can not transform arrays of dimension " .. source.dim)
+    end
+    return result
+  end
+
+  mt.__mul = function(self, other)
+    if ffi.istype(ctype, other) then
+      local result = ctype()
+      C[name .. "_mul"](self, other, result)
+      return result
+    end
+
+    local result = new_vector()
+    if C[name .. "_transform"](self, other, result) == nil then
+      error(name .. " can not transform " .. tostring(other))
+    end
+    return result
+  end
+
+  mt.__eq = function(self, other)
+    if not ffi.istype(ctype, other) then return false end
+    for i = 0, n * n - 1 do
+      if self.items[i] ~= other.items[i] then return false end
+    end
+    return true
+  end
+
+  mt.__tostring = function(self)
+    local rows = {}
+    for row = 0, n - 1 do
+      local items = {}
+      for col = 0, n - 1 do
+        items[col + 1] = self.items[row * n + col]
+      end
+      rows[row + 1] = "{" .. table.concat(items, "; ") .. "}"
+    end
+    return "{" .. table.concat(rows, "; ") .. "}"
+  end
+end
+
+ffi.cdef[[
+    mat2 *mat2_rotation(double angle, mat2 *result);
+    mat3 *mat3_translation(double x, double y, mat3 *result);
+    mat3 *mat3_rotation(double angle, mat3 *result);
+    mat3 *mat3_scale(double x, double y, mat3 *result);
+    mat3 *mat3_compose(double x, double y, double angle, double scale_x, double scale_y, mat3 *result);
+    mat4 *mat4_translation(double x, double y, double z, mat4 *result);
+    mat4 *mat4_scale(double x, double y, double z, mat4 *result);
+    mat4 *mat4_rotation(double x, double y, double z, double angle, mat4 *result);
+]]
+
+vector.mat2_rotation = function(angle)
+  local result = mat_cdata_types[2]()
+  C.mat2_rotation(angle, result)
+  return result
+end
+
+vector.mat3_translation = function(x, y)
+  local result = mat_cdata_types[3]()
+  C.mat3_translation(x, y, result)
+  return result
+end
+
+vector.mat3_rotation = function(angle)
+  local result = mat_cdata_types[3]()
+  C.mat3_rotation(angle, result)
+  return result
+end
+
+vector.mat3_scale = function(x, y)
+  local result = mat_cdata_types[3]()
+  C.mat3_scale(x, y or x, result)
+  return result
+end
+
+vector.mat3_compose = function(x, y, angle, scale_x, scale_y)
+  local result = mat_cdata_types[3]()
+  scale_x = scale_x or 1
+  C.mat3_compose(x, y, angle or 0, scale_x, scale_y or scale_x, result)
+  return result
+end
+
+vector.mat4_translation = function(x, y, z)
+  local result = mat_cdata_types[4]()
+  C.mat4_translation(x, y, z, result)
+  return result
+end
+
+vector.mat4_scale = function(x, y, z)
+  local result = mat_cdata_types[4]()
+  C.mat4_scale(x, y or x, z or x, result)
+  return result
+end
+
+vector.mat4_rotation = function(x, y, z, angle)
+  local result = mat_cdata_types[4]()
+  C.mat4_rotation(x, y, z, angle, result)
+  return result
+end
+
+
+ffi.cdef[[
+    typedef struct pathfinder pathfinder;
+
+    pathfinder *pathfinder_new(int32_t width, int32_t height);
+    void pathfinder_free(pathfinder *self);
+    int32_t pathfinder_cells(const pathfinder *self);
+    int32_t pathfinder_path(const pathfinder *self, vector *result, int32_t capacity);
+    int32_t pathfinder_astar(
+        pathfinder *self, const float *costs, const vector *start, const vector *goal, bool diagonal,
+        vector *result, int32_t capacity
+    );
+    bool pathfinder_dijkstra(
+        pathfinder *self, const float *costs, const vector *sources, int32_t sources_len, bool diagonal,
+        double *distances
+    );
+    void pathfinder_flow_field(
+        const pathfinder *self, const float *costs, const double *distances, bool diagonal, int8_t *directions
+    );
+]]
+
+-- Grid pathfinding over a row-major float[width * height] of entering costs, see pathfinding.c.
+-- Coordinates are zero-based; negative or infinite costs block a cell.
+local pathfinder_methods = {}
+vector.pathfinder_mt = {__index = pathfinder_methods}
+ffi.metatype("pathfinder", vector.pathfinder_mt)
+
+vector.pathfinder = function(width, height)
+  local result = C.pathfinder_new(width, height)
+  if result == nil then
+    error("Can not create pathfinder for a " .. width .. "x" .. height .. " grid")
+  end
+  return ffi.gc(result, C.pathfinder_free)
+end
+
+vector.cost_grid = function(width, height, cost)
+  local result = ffi.new("float[?]", width * height)
+  cost = cost or 1
+  if cost ~= 0 then
+    for i = 0, width * height - 1 do
+      result[i] = cost
+    end
+  end
+  return result
+end
+
+-- Without a buffer allocates an exact one from the found path; nil if there is no path
+pathfinder_methods.astar = function(self, costs, start, goal, diagonal, result, capacity)
+  if result == nil then
+    local n = C.pathfinder_astar(self, costs, start, goal, diagonal == true, nil, 0)
+    if n < 0 then return nil end
+    result = vector_buffer_type(n)
+    C.pathfinder_path(self, result, n)
+    return result, n, n
+  elseif capacity == nil then
+    error("Missing capacity for the result buffer")
+  end
+  local n = C.pathfinder_astar(self, costs, start, goal, diagonal == true, result, capacity)
+  if n < 0 then return nil end
+  return result, math.min(n, capacity), n
+end
+
+pathfinder_methods.dijkstra = function(self, costs, sources, diagonal, distances)
+  local buffer, n = pack_vectors(sources)
+  distances = distances or ffi.new("double[?]", C.pathfinder_cells(self))
+  if not C.pathfinder_dijkstra(self, costs, buffer, n, diagonal == true, distances) then
+    error("Not enough memory for the Dijkstra map")
+  end
+  return distances
+end
+
+-- Directions are zero-based indices into vector.extended_directions, -1 where there is no step
+pathfinder_methods.flow_field = function(self, costs, distances, diagonal, directions)
+  directions = directions or ffi.new("int8_t[?]", C.pathfinder_cells(self))
+  C.pathfinder_flow_field(self, costs, distances, diagonal == true, directions)
+  return directions
+end
+
+vector.path_names = function(steps, n)
+  local result = {}
+  for i = 0, n - 1 do
+    local name = C.vector_name_from_direction(steps + i)
+    if name == nil then
+      error("Step " .. tostring(steps[i]) .. " has no direction name")
+    end
+    result[i + 1] = ffi.string(name)
+  end
+  return result
+end
+
+ffi.cdef[[
+    int32_t sight_line_walk(const vector *from, const vector *to, vector *result, int32_t capacity);
+    bool sight_line_of_sight(
+        const uint8_t *blocking, int32_t width, int32_t height, const vector *from, const vector *to
+    );
+    bool sight_raycast(
+        const uint8_t *blocking, int32_t width, int32_t height, const vector *origin, const vector *direction,
+        double max_distance, vector *hit, double *distance
+    );
+    bool sight_fov_compute(
+        const uint8_t *blocking, int32_t width, int32_t height, const vector *origin, double radius,
+        uint8_t *visible
+    );
+]]
+
+-- Line of sight over a row-major uint8_t[width * height] mask where non-zero cells block, see
+-- sight.c; cells are zero-based like in vector.pathfinder
+vector.grid_mask = function(width, height)
+  return ffi.new("uint8_t[?]", width * height)
+end
+
+vector.line = function(from, to, result, capacity)
+  if result == nil then
+    capacity = C.sight_line_walk(from, to, nil, 0)
+    result = vector_buffer_type(capacity)
+  elseif capacity == nil then
+    error("Missing capacity for the result buffer")
+  end
+  local n = C.sight_line_walk(from, to, result, capacity)
+  return result, math.min(n, capacity), n
+end
+
+vector.line_of_sight = C.sight_line_of_sight
+
+local raycast_distance = ffi.new("double[1]")
+
+vector.raycast = function(blocking, width, height, origin, direction, max_distance)
+  local hit = new_vector()
+  if not C.sight_raycast(
+    blocking, width, height, origin, direction, max_distance or math.huge, hit, raycast_distance
+  ) then
+    return nil
+  end
+  return hit, raycast_distance[0]
+end
+
+vector.fov = function(blocking, width, height, origin, radius, visible)
+  visible = visible or vector.grid_mask(width, height)
+  if not C.sight_fov_compute(blocking, width, height, origin, radius or math.huge, visible) then
+    error("FOV origin " .. tostring(origin) .. " is outside the grid")
+  end
+  return visible
+end
+
+ffi.cdef[[
+    bool vector_stats_enabled(void);
+    int32_t vector_stats_count(void);
+    bool vector_stats_get(int32_t i, const char **name, uint64_t *calls, uint64_t *cycles);
+    void vector_stats_reset(void);
+]]
+
+-- Call counters and cycles of vector.c functions plus counts of Lua-side vector allocations, both
+-- only in a library built with `make STATS=1`; otherwise vector.stats() returns empty tables.
+-- Allocation counting wraps the allocating functions, so the regular build pays nothing for it.
+local allocations = {}
+
+if C.vector_stats_enabled() then
+  local count = function(name, f)
+    allocations[name] = 0
+    return function(...)
+      allocations[name] = allocations[name] + 1
+      return f(...)
+    end
+  end
+
+  vector.new = count("new", vector.new)
+  vector.hex = count("hex", vector.hex)
+  vector_methods.copy = count("copy", vector_methods.copy)
+  vector_methods.normalized = count("normalized", vector_methods.normalized)
+  vector_methods.normalized2 = count("normalized2", vector_methods.normalized2)
+  for _, operator in ipairs({"__unm", "__add", "__sub", "__mul", "__div", "__mod"}) do
+    vector.mt[operator] = count(operator, vector.mt[operator])
+  end
+end
+
+local stat_name = ffi.new("const char *[1]")
+local stat_calls = ffi.new("uint64_t[1]")
+local stat_cycles = ffi.new("uint64_t[1]")
+
+vector.stats = function()
+  local result = {functions = {}, allocations = {}}
+  for i = 0, C.vector_stats_count() - 1 do
+    C.vector_stats_get(i, stat_name, stat_calls, stat_cycles)
+    result.functions[ffi.string(stat_name[0])] = {
+      calls = tonumber(stat_calls[0]),
+      cycles = tonumber(stat_cycles[0]),
+    }
+  end
+  for name, n in pairs(allocations) do
+    result.allocations[name] = n
+  end
+  return result
+end
+
+vector.reset_stats = function()
+  C.vector_stats_reset()
+  for name in pairs(allocations) do
+    allocations[name] = 0
+  end
+end
+
+ffi.cdef[[
+    typedef struct {
+        int32_t version;
+        int32_t dim;
+        int32_t precision;
+        int64_t count;
+        void *items;
+        void *map;
+        size_t size;
+        bool checked;
+    } vector_snapshot;
+
+    typedef struct vector_snapshot_writer vector_snapshot_writer;
+
+    vector_snapshot *vector_snapshot_open(const char *path);
+    void vector_snapshot_close(vector_snapshot *self);
+    vector *vector_snapshot_get(const vector_snapshot *self, int64_t i, vector *result);
+    bool vector_snapshot_check(vector_snapshot *self);
+    vector_snapshot_writer *vector_snapshot_writer_open(const char *path, int32_t dim, int32_t precision);
+    bool vector_snapshot_writer_write(vector_snapshot_writer *self, const vector *items, int64_t len);
+    bool vector_snapshot_writer_close(vector_snapshot_writer *self);
+]]
+
+-- Binary snapshots, see snapshot.c. A loaded snapshot is memory-mapped: snapshot:vectors() points
+-- straight into the mapping and stays valid only while the snapshot object is alive.
+local snapshot_methods = {}
+vector.snapshot_mt = {__index = snapshot_methods}
+ffi.metatype("vector_snapshot", vector.snapshot_mt)
+
+vector.load = function(path)
+  local result = C.vector_snapshot_open(path)
+  if result == nil then
+    error("Can not load vector snapshot " .. path)
+  end
+  return ffi.gc(result, C.vector_snapshot_close)
+end
+
+-- Checks every record on the first call, so that loading itself stays lazy
+snapshot_methods.vectors = function(self)
+  if not C.vector_snapshot_check(self) then
+    error("Vector snapshot has corrupt records")
+  end
+  return ffi.cast(self.precision == 8 and "vector *" or "vectorf *", self.items)
+end
+
+-- Vector i as a double precision vector, checking only that record
+snapshot_methods.get = function(self, i, result)
+  result = result or new_vector()
+  if C.vector_snapshot_get(self, i - 1, result) == nil then
+    error("Index " .. i .. " is out of bounds or corrupt in vector snapshot of length " .. tonumber(self.count))
+  end
+  return result
+end
+
+snapshot_methods.close = function(self)
+  ffi.gc(self, nil)
+  C.vector_snapshot_close(self)
+end
+
+vector.snapshot_mt.__len = function(self)
+  return tonumber(self.count)
+end
+
+local writer_methods = {}
+vector.snapshot_writer_mt = {__index = writer_methods}
+ffi.metatype("vector_snapshot_writer", vector.snapshot_writer_mt)
+
+vector.snapshot_writer = function(path, dim, precision)
+  local result = C.vector_snapshot_writer_open(path, dim, precision or 8)
+  if result == nil then
+    error("Can not write vector snapshot " .. path)
+  end
+  return ffi.gc(result, C.vector_snapshot_writer_close)
+end
+
+writer_methods.write = function(self, points, n)
+  if ffi.istype(vector_cdata_type, points) then
+    points, n = points, 1
+  else
+    points, n = pack_vectors(points, n)
+  end
+  if not C.vector_snapshot_writer_write(self, points, n) then
+    error("Can not write vectors to the snapshot")
+  end
+  return self
+end
+
+writer_methods.close = function(self)
+  ffi.gc(self, nil)
+  if not C.vector_snapshot_writer_close(self) then
+    error("Can not finish the vector snapshot")
+  end
+end
+
+vector.save = function(path, points, n, precision)
+  local buffer
+  buffer, n = pack_vectors(points, n)
+  local writer = vector.snapshot_writer(path, n > 0 and buffer[0].len or 0, precision)
+  writer:write(buffer, n)
+  writer:close()
+end
+
+-- Text form, see format.c
+
+-- Whole sequence or buffer in one string, vectors joined by `separator` ("\n" by default)
+vector.format = function(points, n, separator)
+  local buffer
+  buffer, n = pack_vectors(points, n)
+  local len = tonumber(C.vector_format_batch(buffer, n, separator, nil, 0))
+  local text = ffi.new("char[?]", len + 1)
+  C.vector_format_batch(buffer, n, separator, text, len + 1)
+  return ffi.string(text, len)
+end
+
+local parse_consumed = ffi.new("int64_t[1]")
+
+-- Reads every `{...}` vector in `text`, ignoring the text around them. With a buffer reads at most
+-- `capacity` and also returns the zero-based offset to continue from, so large files can be
+-- parsed chunk by chunk: an incomplete vector at the end of the text is left unconsumed.
+vector.parse = function(text, result, capacity)
+  if result == nil then
+    capacity = tonumber(C.vector_parse(text, #text, nil, 0, nil))
+    result = vector_buffer_type(capacity)
+  end
+  local n = C.vector_parse(text, #text, result, capacity, parse_consumed)
+  return result, tonumber(n), tonumber(parse_consumed[0])
+end
+
+
+ffi.cdef[[
+    bool vector_set_threads(int32_t threads);
+    int32_t vector_threads(void);
+    void vector_set_thread_threshold(int64_t threshold);
+    int64_t vector_thread_threshold(void);
+]]
+
+-- Worker pool for vector.array operations, see pool.c. Results are the same for any thread count.
+vector.set_threads = function(n, threshold)
+  if threshold ~= nil then
+    C.vector_set_thread_threshold(threshold)
+  end
+  if not C.vector_set_threads(n) then
+    error("Can only start " .. C.vector_threads() .. " of " .. n .. " threads")
+  end
+end
+
+vector.threads = function()
+  return C.vector_threads(), tonumber(C.vector_thread_threshold())
+end
+
+
+ffi.cdef[[
+    typedef struct sweep_prune sweep_prune;
+
+    sweep_prune *sweep_prune_new(int dim);
+    void sweep_prune_free(sweep_prune *self);
+    int32_t sweep_prune_len(const sweep_prune *self);
+    bool sweep_prune_update(sweep_prune *self, const vector *min, const vector *max, int32_t len);
+    int32_t sweep_prune_pairs(const sweep_prune *self, int32_t *result, int32_t capacity);
+]]
+
+-- Broad phase over boxes given as min/max vectors, see sweep.c. Update it every frame with the
+-- boxes in the same order to keep the sort incremental.
+local sweep_methods = {}
+vector.sweep_prune_mt = {__index = sweep_methods}
+ffi.metatype("sweep_prune", vector.sweep_prune_mt)
+
+vector.sweep_prune = function(dim)
+  local result = C.sweep_prune_new(dim or 2)
+  if result == nil then
+    error("Can not create sweep and prune for dimension " .. tostring(dim))
+  end
+  return ffi.gc(result, C.sweep_prune_free)
+end
+
+sweep_methods.update = function(self, mins, maxs, n)
+  local min_buffer, max_buffer, max_n
+  min_buffer, n = pack_vectors(mins, n)
+  max_buffer, max_n = pack_vectors(maxs, n)
+  if n ~= max_n or not C.sweep_prune_update(self, min_buffer, max_buffer, n) then
+    error("Can not update sweep and prune: mins and maxs should be equally many vectors of its dimension")
+  end
+  return self
+end
+
+-- Overlapping pairs as zero-based box indices, pair k at result[2k] < result[2k + 1]; capacity
+-- counts pairs. Without a buffer counts the pairs first and allocates an exact one.
+sweep_methods.pairs = function(self, result, capacity)
+  if result == nil then
+    capacity = C.sweep_prune_pairs(self, nil, 0)
+    result = vector.id_buffer(2 * capacity)
+  elseif capacity == nil then
+    error("Missing capacity for the result buffer")
+  end
+  local n = C.sweep_prune_pairs(self, result, capacity)
+  return result, math.min(n, capacity), n
+end
+
+vector.sweep_prune_mt.__len = function(self)
+  return C.sweep_prune_len(self)
+end
+
+
+ffi.cdef[[
+    typedef struct tween_engine tween_engine;
+
+    double vector_ease(int32_t easing, double t);
+    tween_engine *tween_engine_new(void);
+    void tween_engine_free(tween_engine *self);
+    int32_t tween_engine_len(const tween_engine *self);
+    int32_t tween_engine_add(
+        tween_engine *self, vector *target, const vector *from, const vector *to, double duration, int32_t easing
+    );
+    bool tween_engine_cancel(tween_engine *self, int32_t id);
+    int32_t tween_engine_cancel_target(tween_engine *self, const vector *target);
+    void tween_engine_clear(tween_engine *self);
+    int32_t tween_engine_update(tween_engine *self, double dt, int32_t *finished, int32_t capacity);
+]]
+
+-- Easing curve ids, see tween.c
+vector.easings = {}
+for i, name in ipairs({
+  "linear",
+  "quad_in", "quad_out", "quad_in_out",
+  "cubic_in", "cubic_out", "cubic_in_out",
+  "quart_in", "quart_out", "quart_in_out",
+  "sine_in", "sine_out", "sine_in_out",
+  "expo_in", "expo_out", "expo_in_out",
+  "back_in", "back_out", "back_in_out",
+  "elastic_in", "elastic_out", "elastic_in_out",
+  "bounce_in", "bounce_out", "bounce_in_out",
+}) do
+  vector.easings[name] = i - 1
+end
+
+local easing_id = function(easing)
+  if easing == nil then return 0 end
+  local id = type(easing) == "string" and vector.easings[easing] or easing
+  if id == nil then
+    error("Unknown easing " .. easing)
+  end
+  return id
+end
+
+vector.ease = function(easing, t)
+  return C.vector_ease(easing_id(easing), t)
+end
+
+-- Batched tweens writing into target vectors in place, see tween.c. The engine keeps its targets
+-- referenced until their tweens finish or are cancelled.
+local tween_methods = {}
+vector.tween_engine_mt = {__index = tween_methods}
+ffi.metatype("tween_engine", vector.tween_engine_mt)
+
+-- Per engine: targets by tween id and the buffer for finished ids
+local tween_anchors = setmetatable({}, {__mode = "k"})
+
+vector.tween_engine = function()
+  local result = C.tween_engine_new()
+  if result == nil then
+    error("Can not create tween engine")
+  end
+  result = ffi.gc(result, C.tween_engine_free)
+  tween_anchors[result] = {targets = {}, finished = vector.id_buffer(0), capacity = 0}
+  return result
+end
+
+-- Tweens `target` to `to` over `duration` seconds, starting from its current value or `from`
+tween_methods.add = function(self, target, to, duration, easing, from)
+  local id = C.tween_engine_add(self, target, from or target, to, duration, easing_id(easing))
+  if id < 0 then
+    error("Can not tween " .. tostring(target) .. " to " .. tostring(to) .. " over " .. tostring(duration))
+  end
+  tween_anchors[self].targets[id] = target
+  return id
+end
+
+tween_methods.cancel = function(self, id)
+  tween_anchors[self].targets[id] = nil
+  return C.tween_engine_cancel(self, id)
+end
+
+tween_methods.cancel_target = function(self, target)
+  local targets = tween_anchors[self].targets
+  local address = ffi.cast("const vector *", target)
+  for id, t in pairs(targets) do
+    if ffi.cast("const vector *", t) == address then
+      targets[id] = nil
+    end
+  end
+  return C.tween_engine_cancel_target(self, target)
+end
+
+tween_methods.clear = function(self)
+  tween_anchors[self].targets = {}
+  C.tween_engine_clear(self)
+end
+
+-- Returns the number of tweens that finished during this step
+tween_methods.update = function(self, dt)
+  local anchor = tween_anchors[self]
+  local len = C.tween_engine_len(self)
+  if anchor.capacity < len then
+    anchor.capacity = len
+    anchor.finished = vector.id_buffer(len)
+  end
+  local n = C.tween_engine_update(self, dt, anchor.finished, anchor.capacity)
+  for i = 0, n - 1 do
+    anchor.targets[anchor.finished[i]] = nil
+  end
+  return n
+end
+
+vector.tween_engine_mt.__len = function(self)
+  return C.tween_engine_len(self)
+end
+
+
+-- Optional pooling of result vectors. While it is on, every vector the library allocates comes
+-- from a free list that v:release() and vector.frame_scope refill, so per-frame temporaries are
+-- reused instead of collected. A released vector must not be used again.
+local pool_free = {}
+local pool_free_len = 0
+local pool_capacity = 0
+local pool_hits = 0
+local pool_misses = 0
+-- Vectors handed out and not released yet, and the most of them at once
+local pool_in_use = 0
+local pool_peak_in_use = 0
+-- "out" for vectors handed out by the pool, "released" once they are given back, to catch a
+-- second release
+local pool_state = setmetatable({}, {__mode = "k"})
+local scope_vectors = {}
+local scope_len = 0
+local scope_depth = 0
+
+local pooled_new_vector = function()
+  local v
+  if pool_free_len > 0 then
+    v = pool_free[pool_free_len]
+    pool_free[pool_free_len] = nil
+    pool_free_len = pool_free_len - 1
+    pool_hits = pool_hits + 1
+  else
+    v = vector_cdata_type()
+    pool_misses = pool_misses + 1
+  end
+  pool_state[v] = "out"
+  pool_in_use = pool_in_use + 1
+  if pool_in_use > pool_peak_in_use then
+    pool_peak_in_use = pool_in_use
+  end
+  if scope_depth > 0 then
+    scope_len = scope_len + 1
+    scope_vectors[scope_len] = v
+  end
+  return v
+end
+
+-- Vectors past the capacity are left to the GC
+local pool_put = function(v)
+  pool_state[v] = "released"
+  if pool_free_len >= pool_capacity then return end
+  pool_free_len = pool_free_len + 1
+  pool_free[pool_free_len] = v
+end
+
+local pool_return = function(v)
+  pool_in_use = pool_in_use - 1
+  pool_put(v)
+end
+
+-- Turns pooling on with a free list of up to `capacity` vectors, `preallocate` of them allocated
+-- right away; 0 turns it off and drops the free list
+vector.set_pooling = function(capacity, preallocate)
+  pool_capacity = capacity or 0
+  while pool_free_len > pool_capacity do
+    pool_free[pool_free_len] = nil
+    pool_free_len = pool_free_len - 1
+  end
+  for _ = pool_free_len + 1, math.min(preallocate or 0, pool_capacity) do
+    pool_put(vector_cdata_type())
+  end
+  new_vector = pool_capacity > 0 and pooled_new_vector or vector_cdata_type
+end
+
+-- Returns the vector to the pool. A no-op while pooling is off and inside vector.frame_scope,
+-- which reclaims its vectors itself. Only vectors the pool handed out can go back: constants,
+-- buffer elements and vectors allocated before pooling was turned on are rejected.
+vector_methods.release = function(self)
+  if pool_capacity > 0 and scope_depth == 0 then
+    local state = pool_state[self]
+    if state == "released" then
+      error("Vector " .. tostring(self) .. " is already released")
+    elseif state ~= "out" then
+      error("Vector " .. tostring(self) .. " was not allocated by the pool")
+    end
+    pool_return(self)
+  end
+end
+
+local pack = function(...)
+  return {n = select("#", ...), ...}
+end
+
+-- Calls fn(...) and then releases every vector allocated during the call except the vectors it
+-- returns, also when it errors; vectors that should outlive the call have to be returned. Scopes
+-- nest.
+vector.frame_scope = function(fn, ...)
+  if pool_capacity == 0 then
+    return fn(...)
+  end
+
+  local start = scope_len
+  scope_depth = scope_depth + 1
+  local results = pack(pcall(fn, ...))
+  scope_depth = scope_depth - 1
+
+  local kept = {}
+  for i = 2, results.n do
+    if type(results[i]) == "cdata" then
+      kept[results[i]] = true
+    end
+  end
+  for i = start + 1, scope_len do
+    local v = scope_vectors[i]
+    scope_vectors[i] = nil
+    if kept[v] then
+      -- Returned from a nested scope, it is a temporary of the outer one
+      if scope_depth > 0 then
+        start = start + 1
+        scope_vectors[start] = v
+      end
+    else
+      pool_return(v)
+    end
+  end
+  scope_len = start
+
+  if not results[1] then
+    error(results[2], 0)
+  end
+  return unpack(results, 2, results.n)
+end
+
+vector.pool_stats = function()
+  return {
+    hits = pool_hits,
+    misses = pool_misses,
+    in_use = pool_in_use,
+    peak_in_use = pool_peak_in_use,
+    free = pool_free_len,
+    capacity = pool_capacity,
+  }
+end
+
+vector.reset_pool_stats = function()
+  pool_hits, pool_misses, pool_peak_in_use = 0, 0, 0
+end
+
+
+ffi.cdef[[
+    vector *vector_sum(const vector *items, int64_t len, vector *result);
+    vector *vector_mean(const vector *items, int64_t len, vector *result);
+    bool vector_aabb(const vector *items, int64_t len, vector *min, vector *max);
+    vector *vector_variance(const vector *items, int64_t len, vector *mean, vector *result);
+    int vector_covariance(const vector *items, int64_t len, vector *mean, double *result);
+]]
+
+-- Reductions over a sequence or buffer of vectors of one length, see reduce.c. Sums are pairwise,
+-- so they stay accurate for large inputs.
+local reduction = function(name, f)
+  return function(points, n, result)
+    local buffer
+    buffer, n = pack_vectors(points, n)
+    result = result or new_vector()
+    if f(buffer, n, result) == nil then
+      error("Can not compute the " .. name .. ": expected one or more vectors of the same length")
+    end
+    return result
+  end
+end
+
+vector.sum = reduction("sum", C.vector_sum)
+vector.mean = reduction("mean", C.vector_mean)
+
+-- Componentwise minimum and maximum
+vector.aabb = function(points, n, min, max)
+  local buffer
+  buffer, n = pack_vectors(points, n)
+  min = min or new_vector()
+  max = max or new_vector()
+  if not C.vector_aabb(buffer, n, min, max) then
+    error("Can not compute the bounding box: expected one or more vectors of the same length")
+  end
+  return min, max
+end
+
+-- Componentwise population variance and the mean
+vector.variance = function(points, n, result, mean)
+  local buffer
+  buffer, n = pack_vectors(points, n)
+  result = result or new_vector()
+  mean = mean or new_vector()
+  if C.vector_variance(buffer, n, mean, result) == nil then
+    error("Can not compute the variance: expected one or more vectors of the same length")
+  end
+  return result, mean
+end
+
+-- Population covariance as a mat2, mat3 or mat4, and the mean
+vector.covariance = function(points, n, mean)
+  local buffer
+  buffer, n = pack_vectors(points, n)
+  local dim = n > 0 and buffer[0].len or 0
+  if mat_cdata_types[dim] == nil then
+    error("Covariance is defined for vectors of length 2 to 4, got " .. dim)
+  end
+  local result = mat_cdata_types[dim]()
+  mean = mean or new_vector()
+  if C.vector_covariance(buffer, n, mean, result.items) < 0 then
+    error("Can not compute the covariance: expected one or more vectors of the same length")
+  end
+  return result, mean
+end
+
+-- Distances from `origin` to every vector, squared ones if `squared`, as a double buffer
+vector.distances = function(origin, points, n, result, squared)
+  local buffer
+  buffer, n = pack_vectors(points, n)
+  result = result or ffi.new("double[?]", n)
+  if C.vector_distances(origin, buffer, n, squared == true, result) == nil then
+    error("Can not measure distances from " .. tostring(origin) .. ": lengths differ")
+  end
+  return result
+end
+
+-- Zero-based indices of the vectors within `radius` of `origin`; without a buffer counts them first
+-- and allocates an exact one
+vector.within_radius = function(origin, points, n, radius, result, capacity)
+  local buffer
+  buffer, n = pack_vectors(points, n)
+  if result == nil then
+    capacity = C.vector_within_radius(origin, buffer, n, radius, nil, 0)
+    if capacity < 0 then
+      error("Can not filter by distance from " .. tostring(origin) .. ": lengths differ")
+    end
+    result = vector.id_buffer(capacity)
+  elseif capacity == nil then
+    error("Missing capacity for the result buffer")
+  end
+  local found = C.vector_within_radius(origin, buffer, n, radius, result, capacity)
+  if found < 0 then
+    error("Can not filter by distance from " .. tostring(origin) .. ": lengths differ")
+  end
+  return result, math.min(found, capacity), found
+end
+
+
+ffi.cdef[[
+    typedef struct vector_rng vector_rng;
+
+    vector_rng *vector_rng_new(uint64_t seed, uint64_t stream);
+    void vector_rng_free(vector_rng *self);
+    void vector_rng_seed(vector_rng *self, uint64_t seed, uint64_t stream);
+    double vector_rng_uniform(vector_rng *self);
+    vector *vector_rng_box(vector_rng *self, const vector *min, const vector *max, vector *result, int32_t len);
+    vector *vector_rng_disk(vector_rng *self, vector *result, int32_t len);
+    vector *vector_rng_sphere(vector_rng *self, vector *result, int32_t len);
+    vector *vector_rng_direction(vector_rng *self, int dim, vector *result, int32_t len);
+    vector *vector_rng_gaussian(
+        vector_rng *self, const vector *mean, const vector *stddev, vector *result, int32_t len
+    );
+]]
+
+-- Seedable random streams filling vector buffers, see random.c. The same seed and stream give the
+-- same samples for the same calls, independently of other streams.
+local rng_methods = {}
+vector.rng_mt = {__index = rng_methods}
+ffi.metatype("vector_rng", vector.rng_mt)
+
+vector.rng = function(seed, stream)
+  local result = C.vector_rng_new(seed or 0, stream or 0)
+  if result == nil then
+    error("Can not create a random stream")
+  end
+  return ffi.gc(result, C.vector_rng_free)
+end
+
+rng_methods.seed = function(self, seed, stream)
+  C.vector_rng_seed(self, seed or 0, stream or 0)
+  return self
+end
+
+-- In [0, 1), or in [lo, hi) if they are given
+rng_methods.uniform = function(self, lo, hi)
+  local u = C.vector_rng_uniform(self)
+  if lo == nil then return u end
+  return lo + (hi - lo) * u
+end
+
+rng_methods.box = function(self, min, max, n, result)
+  result = result or vector_buffer_type(n)
+  if C.vector_rng_box(self, min, max, result, n) == nil then
+    error("Can not sample between " .. tostring(min) .. " and " .. tostring(max) .. ": expected vectors of the same length")
+  end
+  return result
+end
+
+rng_methods.disk = function(self, n, result)
+  result = result or vector_buffer_type(n)
+  C.vector_rng_disk(self, result, n)
+  return result
+end
+
+rng_methods.sphere = function(self, n, result)
+  result = result or vector_buffer_type(n)
+  C.vector_rng_sphere(self, result, n)
+  return result
+end
+
+rng_methods.direction = function(self, dim, n, result)
+  result = result or vector_buffer_type(n)
+  if C.vector_rng_direction(self, dim, result, n) == nil then
+    error("Can not sample directions of length " .. tostring(dim) .. ", expected 2 to 4")
+  end
+  return result
+end
+
+-- `stddev` is a vector of the length of `mean` or a number for all components
+rng_methods.gaussian = function(self, mean, stddev, n, result)
+  if type(stddev) == "number" then
+    local k = stddev
+    stddev = new_vector()
+    stddev.len = mean.len
+    for i = 0, mean.len - 1 do
+      stddev.items[i] = k
+    end
+  end
+  result = result or vector_buffer_type(n)
+  if C.vector_rng_gaussian(self, mean, stddev, result, n) == nil then
+    error("Can not sample around " .. tostring(mean) .. " with deviation " .. tostring(stddev) .. ": expected vectors of the same length")
+  end
+  return result
 end
 
 return vector
@@ -1,777 +1,1127 @@
-#include <errno.h>
 #include <lua.h>
 #include <lauxlib.h>
-#include <lua5.3/lauxlib.h>
-#include <lualib.h>
-#include <math.h>
-#include <stddef.h>
-#include <stdlib.h>
 #include <string.h>
 
-#define MAX_LEN 4
+#include "vector.h"
+
+// Lua C API backend for interpreters without FFI: PUC Lua 5.1 to 5.4, or LuaJIT with
+// VECTOR_BACKEND=capi. Built by `make capi` into vector_old.so, which vector.lua loads when FFI is
+// not available, and tested by `make test-capi`. It wraps the same C functions as vector.lua, so
+// both backends give bit-identical results.
+//
+// Covered: the single-vector API (constructors, constants, methods, operators, swizzles and
+// v.items), and the module functions working on numbers and Lua sequences of vectors: format and
+// parse, sum/mean/aabb/variance/covariance, distances, within_radius, line, save, ease and
+// easings, threads/set_threads and stats/reset_stats. Results that are C buffers in vector.lua
+// are zero-based tables here. Not available, since they hand out C buffers or other ctypes:
+//   - vector.lazy expressions, vector.array, vector.buffer and vector.id_buffer
+//   - vectorf, vec2-vec4, ivec2/ivec3 and ivec_map, mat2-mat4, and the to_* conversions; the
+//     covariance is a table with the matrix items
+//   - spatial_hash, kd_tree, pathfinder, cost_grid, path_names, sweep_prune, tween_engine, rng
+//   - grid_mask and the grid functions taking one: line_of_sight, raycast and fov
+//   - vector.load and vector.snapshot_writer
+//   - pooling: set_pooling, pool_stats, v:release() and vector.frame_scope exist but pool nothing
+
+// Every function of the module closes over the vector metatable, the method table and the
+// metatable of `items` proxies
+#define VECTOR_MT lua_upvalueindex(1)
+#define VECTOR_METHODS lua_upvalueindex(2)
+#define ITEMS_MT lua_upvalueindex(3)
+#define UPVALUES 3
+
+// Fits 4 components of the longest %.14g form; see format.c
+#define FORMAT_CAPACITY 128
+
+#if LUA_VERSION_NUM < 502
+  #define lua_rawlen lua_objlen
+#endif
+
+// Counts of allocating calls by name, kept like vector.lua does in a `make STATS=1` build
+enum {
+    ALLOCATION_NEW, ALLOCATION_HEX, ALLOCATION_COPY, ALLOCATION_NORMALIZED, ALLOCATION_NORMALIZED2,
+    ALLOCATION_UNM, ALLOCATION_ADD, ALLOCATION_SUB, ALLOCATION_MUL, ALLOCATION_DIV, ALLOCATION_MOD,
+    ALLOCATION_COUNT,
+};
 
-typedef struct {
-    int len;
-    double items[MAX_LEN];
-} vector;
+static const char *const allocation_names[ALLOCATION_COUNT] = {
+    "new", "hex", "copy", "normalized", "normalized2", "__unm", "__add", "__sub", "__mul", "__div", "__mod",
+};
 
-static inline int get_index(char key) {
-    if (key == 'x') return 0;
-    if (key == 'y') return 1;
-    if (key == 'z') return 2;
-    if (key == 'w') return 3;
-    if (key == 'r') return 0;
-    if (key == 'g') return 1;
-    if (key == 'b') return 2;
-    if (key == 'a') return 3;
-    return -1;
-}
+static uint64_t allocations[ALLOCATION_COUNT];
 
-static inline int check_index(lua_State *L, int argument_i) {
-    if (lua_isnumber(L, argument_i)) {
-        int index = lua_tointeger(L, argument_i);
-        if (index < 1 || index > MAX_LEN) return -1;
-        return index - 1;
-    }
+#ifdef VECTOR_STATS
+  #define COUNT_ALLOCATION(i) (allocations[i]++)
+#else
+  #define COUNT_ALLOCATION(i) ((void)0)
+#endif
 
-    size_t len;
-    const char *key = luaL_checklstring(L, argument_i, &len);
-    if (len != 1) return -1;
-    return get_index(key[0]);
+static vector *test_vector(lua_State *L, int i) {
+    vector *self = lua_touserdata(L, i);
+    if (self == NULL || !lua_getmetatable(L, i)) return NULL;
+    bool is_vector = lua_rawequal(L, -1, VECTOR_MT);
+    lua_pop(L, 1);
+    return is_vector ? self : NULL;
 }
 
-static vector* check_vector(lua_State *L, int index) {
-    void *ud = luaL_checkudata(L, index, "vector_metatable");
-    return (vector*)ud;
+static vector *check_vector(lua_State *L, int i) {
+    vector *self = test_vector(L, i);
+    if (self == NULL) luaL_argerror(L, i, "vector expected");
+    return self;
 }
 
-inline static vector *vector_allocate(lua_State *L) {
-    vector *result = (vector *)lua_newuserdata(L, sizeof(vector));
-    luaL_getmetatable(L, "vector_metatable");
+// Zero-filled like a new FFI vector, so items past len read as 0
+static vector *push_vector(lua_State *L) {
+    vector *result = lua_newuserdata(L, sizeof(vector));
+    memset(result, 0, sizeof(vector));
+    lua_pushvalue(L, VECTOR_MT);
     lua_setmetatable(L, -2);
     return result;
 }
 
-static int vector_new(lua_State *L) {
-    int n = lua_gettop(L);
+// The vector at i if it is given, otherwise a new one; either way it ends up on top of the stack
+static vector *opt_result(lua_State *L, int i) {
+    if (lua_isnoneornil(L, i)) return push_vector(L);
+    vector *result = check_vector(L, i);
+    lua_pushvalue(L, i);
+    return result;
+}
+
+static void push_vector_string(lua_State *L, const vector *self) {
+    char buffer[FORMAT_CAPACITY];
+    int32_t len = vector_format(self, buffer, FORMAT_CAPACITY);
+    lua_pushlstring(L, buffer, len < FORMAT_CAPACITY ? len : FORMAT_CAPACITY - 1);
+}
 
-    if (n > MAX_LEN) {
-        return luaL_error(L, "Got %d arguments, expected %d (x, y)", n, MAX_LEN);
+// tostring() of the value at i for error messages, left on the stack
+static const char *to_string(lua_State *L, int i) {
+    const vector *v = test_vector(L, i);
+    if (v != NULL) {
+        push_vector_string(L, v);
+    } else if (lua_isstring(L, i)) {
+        lua_pushvalue(L, i);
+        lua_tostring(L, -1);
+    } else {
+        lua_pushstring(L, luaL_typename(L, i));
     }
+    return lua_tostring(L, -1);
+}
 
-    vector *v = vector_allocate(L);
+static int vector_new(lua_State *L) {
+    COUNT_ALLOCATION(ALLOCATION_NEW);
+    int n = lua_gettop(L);
+    if (n > MAX_LEN) return luaL_error(L, "Too many arguments, max is %d", MAX_LEN);
 
-    v->len = n;
+    vector *result = push_vector(L);
+    result->len = n;
     for (int i = 0; i < n; i++) {
-        v->items[i] = luaL_checknumber(L, i + 1);
+        result->items[i] = luaL_checknumber(L, i + 1);
     }
-
     return 1;
 }
 
 static int vector_hex(lua_State *L) {
-    size_t str_len;
-    const char *str = luaL_checklstring(L, 1, &str_len);
-
-    if (str_len % 2 != 0) {
-        return luaL_error(L, "Hex length should be divisible by 2, got %d", str_len);
-    }
-
-    char *endptr;
-    long int all_value = strtol(str, &endptr, 16);
+    COUNT_ALLOCATION(ALLOCATION_HEX);
+    const char *hex = luaL_checkstring(L, 1);
+    if (!vector_from_hex(hex, push_vector(L))) return luaL_error(L, "Wrong hex format");
+    return 1;
+}
 
-    if (*endptr != '\0') {
-        return luaL_error(L, "Unable to parse the hex '%s'", str);
-    }
+static int module_name_from_direction(lua_State *L) {
+    const vector *v = test_vector(L, 1);
+    const char *name = v != NULL ? vector_name_from_direction(v) : NULL;
+    if (name == NULL) return 0;
+    lua_pushstring(L, name);
+    return 1;
+}
 
-    if (errno == ERANGE) {
-        return luaL_error(L, "Hex value '%s' too big", str);
-    }
+static int module_axpy(lua_State *L) {
+    double a = luaL_checknumber(L, 1);
+    vector *x = check_vector(L, 2);
+    vector *y = check_vector(L, 3);
+    vector_axpy_into(a, x, y, opt_result(L, 4));
+    return 1;
+}
 
-    vector *result = vector_allocate(L);
-    result->len = str_len / 2;
-    for (int i = 0; i < result->len; i++) {
-        result->items[i] = ((double) ((all_value >> (8 * i)) % 256)) / 255;
-    }
+static int module_simd(lua_State *L) {
+    lua_pushstring(L, vector_simd_name());
+    return 1;
+}
 
+static int module_set_simd(lua_State *L) {
+    lua_pushboolean(L, vector_simd_set(luaL_checkstring(L, 1)));
     return 1;
 }
 
-static int vector_name_from_direction(lua_State *L) {
-    vector *self = check_vector(L, 1);
-    if (self->len != 2) {
-        lua_pushnil(L);
-        return 1;
-    }
-    if (self->items[0] == 0) {
-        if (self->items[1] == 1) {
-            lua_pushstring(L, "down");
-            return 1;
-        }
-        if (self->items[1] == -1) {
-            lua_pushstring(L, "up");
-            return 1;
-        }
-    } else if (self->items[1] == 0) {
-        if (self->items[0] == 1) {
-            lua_pushstring(L, "right");
-            return 1;
-        }
-        if (self->items[0] == -1) {
-            lua_pushstring(L, "left");
-            return 1;
-        }
-    }
-    lua_pushnil(L);
-    return 1;
-}
-
-static vector *vector_copy_raw(lua_State *L, vector *self) {
-    vector *result = vector_allocate(L);
-    result->len = self->len;
-    for (int i = 0; i < self->len; i++) {
-        result->items[i] = self->items[i];
-    }
+// Pooling is an FFI backend feature; these keep code written for it running
+static int module_frame_scope(lua_State *L) {
+    luaL_checktype(L, 1, LUA_TFUNCTION);
+    lua_call(L, lua_gettop(L) - 1, LUA_MULTRET);
+    return lua_gettop(L);
+}
 
-    return result;
+static int method_release(lua_State *L) {
+    check_vector(L, 1);
+    return 0;
 }
 
-static int vector_copy(lua_State *L) {
+static int method_copy(lua_State *L) {
+    COUNT_ALLOCATION(ALLOCATION_COPY);
     vector *self = check_vector(L, 1);
-    vector_copy_raw(L, self);
+    *push_vector(L) = *self;
     return 1;
 }
 
-static int vector_unpack(lua_State *L) {
+static int method_unpack(lua_State *L) {
     vector *self = check_vector(L, 1);
+    luaL_checkstack(L, self->len, NULL);
     for (int i = 0; i < self->len; i++) {
         lua_pushnumber(L, self->items[i]);
     }
     return self->len;
 }
 
-static int vector_swizzle(lua_State *L) {
+// Mutating methods return self; NULL from C, e.g. normalized2 of a non-2D vector, is nil
+static int return_self(lua_State *L, const vector *result) {
+    if (result == NULL) return 0;
+    lua_settop(L, 1);
+    return 1;
+}
+
+static int method_unm_mut(lua_State *L) {
+    return return_self(L, vector_unm_mut(check_vector(L, 1)));
+}
+
+static int method_add_mut(lua_State *L) {
     vector *self = check_vector(L, 1);
-    size_t swizzle_len;
-    const char *swizzle_str = luaL_checklstring(L, 2, &swizzle_len);
+    return return_self(L, vector_add_mut(self, check_vector(L, 2)));
+}
 
-    if (swizzle_len > MAX_LEN) {
-        return luaL_error(L, "Maximal allowed swizzle length is %d, got %d", MAX_LEN, swizzle_len);
-    }
+static int method_sub_mut(lua_State *L) {
+    vector *self = check_vector(L, 1);
+    return return_self(L, vector_sub_mut(self, check_vector(L, 2)));
+}
 
-    vector *result = vector_allocate(L);
-    result->len = swizzle_len;
-    for (size_t i = 0; i < swizzle_len; i++) {
-        result->items[i] = self->items[get_index(swizzle_str[i])];
-    }
+static int method_mul_mut(lua_State *L) {
+    vector *self = check_vector(L, 1);
+    return return_self(L, vector_mul_mut(self, luaL_checknumber(L, 2)));
+}
 
-    return 1;
+static int method_div_mut(lua_State *L) {
+    vector *self = check_vector(L, 1);
+    return return_self(L, vector_div_mut(self, luaL_checknumber(L, 2)));
 }
 
-static int vector_eq(lua_State *L) {
+static int method_mod_mut(lua_State *L) {
     vector *self = check_vector(L, 1);
-    vector *other = check_vector(L, 2);
+    return return_self(L, vector_mod_mut(self, luaL_checknumber(L, 2)));
+}
 
-    if (self->len != other->len) {
-        lua_pushboolean(L, 0);
-        return 1;
-    }
+static int method_normalized_mut(lua_State *L) {
+    return return_self(L, vector_normalized_mut(check_vector(L, 1)));
+}
 
+static int method_normalized2_mut(lua_State *L) {
+    return return_self(L, vector_normalized2_mut(check_vector(L, 1)));
+}
+
+static int method_map_mut(lua_State *L) {
+    vector *self = check_vector(L, 1);
+    luaL_checktype(L, 2, LUA_TFUNCTION);
     for (int i = 0; i < self->len; i++) {
-        if (self->items[i] != other->items[i]) {
-            lua_pushboolean(L, 0);
-            return 1;
-        }
+        lua_pushvalue(L, 2);
+        lua_pushnumber(L, self->items[i]);
+        lua_call(L, 1, 1);
+        if (!lua_isnumber(L, -1)) return luaL_error(L, "map function should return a number");
+        self->items[i] = lua_tonumber(L, -1);
+        lua_pop(L, 1);
     }
+    return return_self(L, self);
+}
+
+static int method_map(lua_State *L) {
+    vector *self = check_vector(L, 1);
+    luaL_checktype(L, 2, LUA_TFUNCTION);
+    lua_settop(L, 2);
+    *push_vector(L) = *self;
+    lua_replace(L, 1);
+    return method_map_mut(L);
+}
 
-    lua_pushboolean(L, 1);
+static int push_number(lua_State *L, double x) {
+    lua_pushnumber(L, x);
     return 1;
 }
 
-static int vector_lt(lua_State *L) {
-    vector *self = check_vector(L, 1);
-    vector *other = check_vector(L, 2);
+static int method_abs(lua_State *L) {
+    return push_number(L, vector_abs(check_vector(L, 1)));
+}
 
-    if (self->len != other->len) {
-        return luaL_error(
-            L, "Argument vectors have different lengths %d and %d",
-            self->len, other->len
-        );
-    }
+static int method_abs2(lua_State *L) {
+    return push_number(L, vector_abs2(check_vector(L, 1)));
+}
 
-    for (int i = 0; i < self->len; i++) {
-        if (self->items[i] >= other->items[i]) {
-            lua_pushboolean(L, 0);
-            return 1;
-        }
+// The C products return NaN for vectors of different lengths; raise instead, as vector.lua does
+static vector *check_same_len(lua_State *L, const vector *self, const char *name) {
+    vector *other = check_vector(L, 2);
+    if (other->len != self->len) {
+        luaL_error(L, "Can not take the %s of %s and %s: lengths differ", name, to_string(L, 1), to_string(L, 2));
     }
-
-    lua_pushboolean(L, 1);
-    return 1;
+    return other;
 }
 
-static int vector_gt(lua_State *L) {
+static int method_dot(lua_State *L) {
     vector *self = check_vector(L, 1);
-    vector *other = check_vector(L, 2);
+    return push_number(L, vector_dot(self, check_same_len(L, self, "dot product")));
+}
 
-    if (self->len != other->len) {
-        return luaL_error(
-            L, "Argument vectors have different lengths %d and %d",
-            self->len, other->len
-        );
-    }
+static int method_dist(lua_State *L) {
+    vector *self = check_vector(L, 1);
+    return push_number(L, vector_dist(self, check_same_len(L, self, "distance")));
+}
 
-    for (int i = 0; i < self->len; i++) {
-        if (self->items[i] <= other->items[i]) {
-            lua_pushboolean(L, 0);
-            return 1;
-        }
-    }
+static int method_dist2(lua_State *L) {
+    vector *self = check_vector(L, 1);
+    return push_number(L, vector_dist2(self, check_same_len(L, self, "distance")));
+}
 
-    lua_pushboolean(L, 1);
-    return 1;
+static int method_angle_between(lua_State *L) {
+    vector *self = check_vector(L, 1);
+    return push_number(L, vector_angle_between(self, check_same_len(L, self, "angle")));
 }
 
-static int vector_le(lua_State *L) {
+// A number for 2D vectors (z of the 3D product), a vector for 3D ones
+static int method_cross(lua_State *L) {
     vector *self = check_vector(L, 1);
     vector *other = check_vector(L, 2);
-
-    if (self->len != other->len) {
+    if (self->len == 2 && other->len == 2) return push_number(L, vector_cross2(self, other));
+    if (vector_cross3_into(self, other, opt_result(L, 3)) == NULL) {
         return luaL_error(
-            L, "Argument vectors have different lengths %d and %d",
-            self->len, other->len
+            L, "Can not cross %s and %s: expected two 2D or 3D vectors", to_string(L, 1), to_string(L, 2)
         );
     }
+    return 1;
+}
 
-    for (int i = 0; i < self->len; i++) {
-        if (self->items[i] > other->items[i]) {
-            lua_pushboolean(L, 0);
-            return 1;
-        }
-    }
-
-    lua_pushboolean(L, 1);
+// *_into methods return their result argument, or nil where the C function returns NULL
+static int return_result(lua_State *L, int i, const vector *result) {
+    if (result == NULL) return 0;
+    lua_pushvalue(L, i);
     return 1;
 }
 
-static int vector_ge(lua_State *L) {
+static int method_copy_into(lua_State *L) {
     vector *self = check_vector(L, 1);
-    vector *other = check_vector(L, 2);
-
-    if (self->len != other->len) {
-        return luaL_error(
-            L, "Argument vectors have different lengths %d and %d",
-            self->len, other->len
-        );
-    }
+    return return_result(L, 2, vector_copy_into(self, check_vector(L, 2)));
+}
 
-    for (int i = 0; i < self->len; i++) {
-        if (self->items[i] < other->items[i]) {
-            lua_pushboolean(L, 0);
-            return 1;
-        }
-    }
+static int method_unm_into(lua_State *L) {
+    vector *self = check_vector(L, 1);
+    return return_result(L, 2, vector_unm_into(self, check_vector(L, 2)));
+}
 
-    lua_pushboolean(L, 1);
-    return 1;
+static int method_normalized_into(lua_State *L) {
+    vector *self = check_vector(L, 1);
+    return return_result(L, 2, vector_normalized_into(self, check_vector(L, 2)));
 }
 
-inline static void vector_unm_mut_raw(vector *self) {
-    for (int i = 0; i < self->len; i++) {
-        self->items[i] *= -1;
-    }
+static int method_normalized2_into(lua_State *L) {
+    vector *self = check_vector(L, 1);
+    return return_result(L, 2, vector_normalized2_into(self, check_vector(L, 2)));
 }
 
-inline static void vector_add_mut_raw(vector *self, vector *other) {
-    for (int i = 0; i < self->len; i++) {
-        self->items[i] += other->items[i];
-    }
+static int method_add_into(lua_State *L) {
+    vector *self = check_vector(L, 1);
+    vector *other = check_vector(L, 2);
+    return return_result(L, 3, vector_add_into(self, other, check_vector(L, 3)));
 }
 
-inline static void vector_sub_mut_raw(vector *self, vector *other) {
-    for (int i = 0; i < self->len; i++) {
-        self->items[i] -= other->items[i];
-    }
+static int method_sub_into(lua_State *L) {
+    vector *self = check_vector(L, 1);
+    vector *other = check_vector(L, 2);
+    return return_result(L, 3, vector_sub_into(self, other, check_vector(L, 3)));
 }
 
-inline static void vector_mul_mut_raw(vector *self, double k) {
-    for (int i = 0; i < self->len; i++) {
-        self->items[i] *= k;
-    }
+static int method_mul_into(lua_State *L) {
+    vector *self = check_vector(L, 1);
+    double k = luaL_checknumber(L, 2);
+    return return_result(L, 3, vector_mul_into(self, k, check_vector(L, 3)));
 }
 
-inline static void vector_div_mut_raw(vector *self, double k) {
-    for (int i = 0; i < self->len; i++) {
-        self->items[i] /= k;
-    }
+static int method_div_into(lua_State *L) {
+    vector *self = check_vector(L, 1);
+    double k = luaL_checknumber(L, 2);
+    return return_result(L, 3, vector_div_into(self, k, check_vector(L, 3)));
 }
 
-inline static void vector_mod_mut_raw(vector *self, double k) {
-    for (int i = 0; i < self->len; i++) {
-        self->items[i] = (int)self->items[i] % (int)k;
-    }
+static int method_mod_into(lua_State *L) {
+    vector *self = check_vector(L, 1);
+    double k = luaL_checknumber(L, 2);
+    return return_result(L, 3, vector_mod_into(self, k, check_vector(L, 3)));
 }
 
-static int vector_unm_mut(lua_State *L) {
+static int method_madd_into(lua_State *L) {
     vector *self = check_vector(L, 1);
-    vector_unm_mut_raw(self);
-    return 1;
+    vector *other = check_vector(L, 2);
+    double k = luaL_checknumber(L, 3);
+    return return_result(L, 4, vector_madd_into(self, other, k, check_vector(L, 4)));
 }
 
-static int vector_add_mut(lua_State *L) {
+static int method_lerp_into(lua_State *L) {
     vector *self = check_vector(L, 1);
     vector *other = check_vector(L, 2);
+    double t = luaL_checknumber(L, 3);
+    return return_result(L, 4, vector_lerp_into(self, other, t, check_vector(L, 4)));
+}
 
-    if (self->len != other->len) {
-        return luaL_error(
-            L, "Argument vectors have different lengths %d and %d",
-            self->len, other->len
-        );
-    }
+static int method_fma_into(lua_State *L) {
+    vector *self = check_vector(L, 1);
+    vector *other = check_vector(L, 2);
+    vector *addend = check_vector(L, 3);
+    return return_result(L, 4, vector_fma_into(self, other, addend, check_vector(L, 4)));
+}
 
-    vector_add_mut_raw(self, other);
+static int method_clamp_into(lua_State *L) {
+    vector *self = check_vector(L, 1);
+    vector *min = check_vector(L, 2);
+    vector *max = check_vector(L, 3);
+    return return_result(L, 4, vector_clamp_into(self, min, max, check_vector(L, 4)));
+}
 
-    lua_pushvalue(L, 1);
+// Immutable counterparts allocate the result, which is also what the metamethods do
+static int method_normalized(lua_State *L) {
+    COUNT_ALLOCATION(ALLOCATION_NORMALIZED);
+    vector *self = check_vector(L, 1);
+    vector_normalized_into(self, push_vector(L));
     return 1;
 }
 
-static int vector_sub_mut(lua_State *L) {
+static int method_normalized2(lua_State *L) {
+    COUNT_ALLOCATION(ALLOCATION_NORMALIZED2);
     vector *self = check_vector(L, 1);
-    vector *other = check_vector(L, 2);
-
-    if (self->len != other->len) {
-        return luaL_error(
-            L, "Argument vectors have different lengths %d and %d",
-            self->len, other->len
-        );
-    }
-
-    vector_sub_mut_raw(self, other);
+    return vector_normalized2_into(self, push_vector(L)) != NULL ? 1 : 0;
+}
 
-    lua_pushvalue(L, 1);
+static int method_madd(lua_State *L) {
+    vector *self = check_vector(L, 1);
+    vector *other = check_vector(L, 2);
+    double k = luaL_checknumber(L, 3);
+    vector_madd_into(self, other, k, push_vector(L));
     return 1;
 }
 
-static int vector_mul_mut(lua_State *L) {
+static int method_lerp(lua_State *L) {
     vector *self = check_vector(L, 1);
-    double k = luaL_checknumber(L, 2);
-
-    vector_mul_mut_raw(self, k);
+    vector *other = check_vector(L, 2);
+    double t = luaL_checknumber(L, 3);
+    vector_lerp_into(self, other, t, push_vector(L));
+    return 1;
+}
 
-    lua_pushvalue(L, 1);
+static int method_fma(lua_State *L) {
+    vector *self = check_vector(L, 1);
+    vector *other = check_vector(L, 2);
+    vector *addend = check_vector(L, 3);
+    vector_fma_into(self, other, addend, push_vector(L));
     return 1;
 }
 
-static int vector_div_mut(lua_State *L) {
+static int method_clamp(lua_State *L) {
     vector *self = check_vector(L, 1);
-    double k = luaL_checknumber(L, 2);
+    vector *min = check_vector(L, 2);
+    vector *max = check_vector(L, 3);
+    vector_clamp_into(self, min, max, push_vector(L));
+    return 1;
+}
 
-    vector_div_mut_raw(self, k);
+static int method_swizzle(lua_State *L) {
+    vector *self = check_vector(L, 1);
+    int32_t mask = vector_swizzle_compile(luaL_checkstring(L, 2));
+    if (mask < 0 || vector_swizzle_mask(self, mask, opt_result(L, 3)) == NULL) {
+        return luaL_error(L, "Can not swizzle %s with %s", to_string(L, 1), lua_tostring(L, 2));
+    }
+    return 1;
+}
 
-    lua_pushvalue(L, 1);
+static int meta_eq(lua_State *L) {
+    const vector *self = test_vector(L, 1), *other = test_vector(L, 2);
+    lua_pushboolean(L, self != NULL && other != NULL && vector_eq(self, other));
     return 1;
 }
 
-static int vector_mod_mut(lua_State *L) {
+static int meta_lt(lua_State *L) {
     vector *self = check_vector(L, 1);
-    double k = luaL_checknumber(L, 2);
-
-    vector_mod_mut_raw(self, k);
+    lua_pushboolean(L, vector_lt(self, check_vector(L, 2)));
+    return 1;
+}
 
-    lua_pushvalue(L, 1);
+static int meta_le(lua_State *L) {
+    vector *self = check_vector(L, 1);
+    lua_pushboolean(L, vector_le(self, check_vector(L, 2)));
     return 1;
 }
 
-static int vector_unm(lua_State *L) {
+static int meta_unm(lua_State *L) {
+    COUNT_ALLOCATION(ALLOCATION_UNM);
     vector *self = check_vector(L, 1);
-    vector *result = vector_copy_raw(L, self);
-    vector_unm_mut_raw(result);
+    vector_unm_into(self, push_vector(L));
     return 1;
 }
 
-static int vector_add(lua_State *L) {
+static int meta_add(lua_State *L) {
+    COUNT_ALLOCATION(ALLOCATION_ADD);
     vector *self = check_vector(L, 1);
     vector *other = check_vector(L, 2);
-    vector *result = vector_copy_raw(L, self);
-    vector_add_mut_raw(result, other);
-
-    lua_pushvalue(L, -1);
+    vector_add_into(self, other, push_vector(L));
     return 1;
 }
 
-static int vector_sub(lua_State *L) {
+static int meta_sub(lua_State *L) {
+    COUNT_ALLOCATION(ALLOCATION_SUB);
     vector *self = check_vector(L, 1);
     vector *other = check_vector(L, 2);
-    vector *result = vector_copy_raw(L, self);
-    vector_sub_mut_raw(result, other);
-
-    lua_pushvalue(L, -1);
+    vector_sub_into(self, other, push_vector(L));
     return 1;
 }
 
-static int vector_mul(lua_State *L) {
+static int meta_mul(lua_State *L) {
+    COUNT_ALLOCATION(ALLOCATION_MUL);
     vector *self = check_vector(L, 1);
     double k = luaL_checknumber(L, 2);
-    vector *result = vector_copy_raw(L, self);
-    vector_mul_mut_raw(result, k);
-
-    lua_pushvalue(L, -1);
+    vector_mul_into(self, k, push_vector(L));
     return 1;
 }
 
-static int vector_div(lua_State *L) {
+static int meta_div(lua_State *L) {
+    COUNT_ALLOCATION(ALLOCATION_DIV);
     vector *self = check_vector(L, 1);
     double k = luaL_checknumber(L, 2);
-    vector *result = vector_copy_raw(L, self);
-    vector_div_mut_raw(result, k);
-
-    lua_pushvalue(L, -1);
+    vector_div_into(self, k, push_vector(L));
     return 1;
 }
 
-static int vector_mod(lua_State *L) {
+static int meta_mod(lua_State *L) {
+    COUNT_ALLOCATION(ALLOCATION_MOD);
     vector *self = check_vector(L, 1);
     double k = luaL_checknumber(L, 2);
-    vector *result = vector_copy_raw(L, self);
-    vector_mod_mut_raw(result, k);
+    vector_mod_into(self, k, push_vector(L));
+    return 1;
+}
 
-    lua_pushvalue(L, -1);
+static int meta_tostring(lua_State *L) {
+    push_vector_string(L, check_vector(L, 1));
     return 1;
 }
 
-inline static int vector_abs_raw(vector *self) {
-    double result = 0;
+static int meta_len(lua_State *L) {
+    lua_pushinteger(L, check_vector(L, 1)->len);
+    return 1;
+}
 
-    for (int i = 0; i < self->len; i++) {
-        result += self->items[i] * self->items[i];
-    }
+// v.items is a proxy table over the zero-based components, like the FFI struct field. Each access
+// creates one, so hot code should prefer v.x and friends. The owner vector is stored under the
+// proxy metatable as key, so that every integer index reaches __index and __newindex.
+static vector *items_owner(lua_State *L) {
+    lua_pushvalue(L, ITEMS_MT);
+    lua_rawget(L, 1);
+    vector *self = lua_touserdata(L, -1);
+    lua_pop(L, 1);
+    return self;
+}
 
-    return sqrt(result);
+static int items_index(lua_State *L) {
+    vector *self = items_owner(L);
+    lua_Integer i = lua_isnumber(L, 2) ? lua_tointeger(L, 2) : -1;
+    if (i < 0 || i >= MAX_LEN) return 0;
+    return push_number(L, self->items[i]);
 }
 
-static int vector_abs(lua_State *L) {
-    vector *self = check_vector(L, 1);
-    lua_pushnumber(L, vector_abs_raw(self));
-    return 1;
+static int items_newindex(lua_State *L) {
+    vector *self = items_owner(L);
+    lua_Integer i = lua_isnumber(L, 2) ? lua_tointeger(L, 2) : -1;
+    if (i < 0 || i >= MAX_LEN) return luaL_error(L, "Item index should be between 0 and %d", MAX_LEN - 1);
+    self->items[i] = luaL_checknumber(L, 3);
+    return 0;
 }
 
-inline static int vector_abs2_raw(vector *self) {
-    double result = 0;
+// Methods first, then the len and items fields, then swizzles: nil past the length or for
+// anything else
+static int meta_index(lua_State *L) {
+    vector *self = check_vector(L, 1);
+    lua_pushvalue(L, 2);
+    lua_rawget(L, VECTOR_METHODS);
+    if (!lua_isnil(L, -1) || lua_type(L, 2) != LUA_TSTRING) return 1;
 
-    for (int i = 0; i < self->len; i++) {
-        result += fabs(self->items[i]);
+    const char *key = lua_tostring(L, 2);
+    if (strcmp(key, "len") == 0) {
+        lua_pushinteger(L, self->len);
+        return 1;
+    }
+    if (strcmp(key, "items") == 0) {
+        lua_createtable(L, 0, 1);
+        lua_pushvalue(L, ITEMS_MT);
+        lua_pushvalue(L, 1);
+        lua_rawset(L, -3);
+        lua_pushvalue(L, ITEMS_MT);
+        lua_setmetatable(L, -2);
+        return 1;
     }
 
-    return result;
+    int32_t mask = vector_swizzle_compile(key);
+    if (mask < 0) return 0;
+    if (mask >> 8 == 1) {
+        int index = mask & 3;
+        return index < self->len ? push_number(L, self->items[index]) : 0;
+    }
+    return vector_swizzle_mask(self, mask, push_vector(L)) != NULL ? 1 : 0;
 }
 
-static int vector_abs2(lua_State *L) {
+static int meta_newindex(lua_State *L) {
     vector *self = check_vector(L, 1);
-    lua_pushnumber(L, vector_abs2_raw(self));
-    return 1;
-}
+    const char *key = lua_type(L, 2) == LUA_TSTRING ? lua_tostring(L, 2) : "";
 
-static int vector_normalized_mut(lua_State *L) {
-    vector *self = check_vector(L, 1);
-    vector_div_mut_raw(self, vector_abs_raw(self));
-    return 1;
-}
+    if (strcmp(key, "len") == 0) {
+        lua_Integer len = luaL_checkinteger(L, 3);
+        if (len < 0 || len > MAX_LEN) return luaL_error(L, "Vector length should be between 0 and %d", MAX_LEN);
+        self->len = len;
+        return 0;
+    }
 
-static int vector_normalized2_mut(lua_State *L) {
-    vector *self = check_vector(L, 1);
+    int32_t mask = vector_swizzle_compile(key);
+    int len = mask >> 8;
+    int max_index = 0;
+    bool seen[MAX_LEN] = {false};
+    for (int i = 0; mask >= 0 && i < len; i++) {
+        int index = (mask >> (2 * i)) & 3;
+        if (seen[index]) mask = -1;
+        seen[index] = true;
+        if (index > max_index) max_index = index;
+    }
+    if (mask < 0) return luaL_error(L, "Can not assign field %s of %s", to_string(L, 2), to_string(L, 1));
+    if (self->len <= max_index) {
+        return luaL_error(L, "Can not assign a component past the length of %s", to_string(L, 1));
+    }
 
-    if (self->len != 2) {
-        return luaL_error(
-            L, "vector:normalized2 works only with two-dimensional vectors, got %d", self->len
-        );
+    if (len == 1) {
+        self->items[mask & 3] = luaL_checknumber(L, 3);
+        return 0;
+    }
+    // Read everything first, so that v.xy = v.yx works
+    const vector *value = test_vector(L, 3);
+    if (value == NULL || value->len != len) {
+        return luaL_error(L, "Expected a vector of length %d, got %s", len, to_string(L, 3));
     }
+    vector tmp = *value;
+    for (int i = 0; i < len; i++) {
+        self->items[(mask >> (2 * i)) & 3] = tmp.items[i];
+    }
+    return 0;
+}
 
-    if (fabs(self->items[0]) > fabs(self->items[1])) {
-        self->items[0] = copysign(1, self->items[0]);
-        self->items[1] = 0;
-    } else if (self->items[1] != 0) {
-        self->items[0] = 0;
-        self->items[1] = copysign(1, self->items[1]);
-    } else {
-        return luaL_error(L, "Can not normalize zero vector");
+// Batch functions. Where vector.lua takes or returns C buffers, these take Lua sequences of vectors
+// (the `n` argument is ignored, as it is for sequences there) and return zero-based tables, so
+// that result[i] means the same on both backends. Scratch arrays are userdata, which the GC
+// reclaims when a call raises; each function first sets the stack to its arity, so that they
+// land above the arguments.
+
+// Copies the sequence of vectors at index i into a scratch array left on the stack
+static vector *check_vectors(lua_State *L, int i, int32_t *len) {
+    luaL_checktype(L, i, LUA_TTABLE);
+    size_t n = lua_rawlen(L, i);
+    if (n > INT32_MAX) luaL_error(L, "Too many vectors: %d", (int)n);
+    vector *items = lua_newuserdata(L, sizeof(vector) * (n > 0 ? n : 1));
+    for (size_t j = 0; j < n; j++) {
+        lua_rawgeti(L, i, (int)j + 1);
+        const vector *v = test_vector(L, -1);
+        if (v == NULL) luaL_error(L, "Expected a vector at index %d, got %s", (int)j + 1, luaL_typename(L, -1));
+        items[j] = *v;
+        lua_pop(L, 1);
     }
+    *len = (int32_t)n;
+    return items;
+}
+
+// The table at index i, or a new one if it is nil; either way it ends up on top of the stack. A
+// given table needs its capacity at index i + 1, which is checked into *capacity.
+static void opt_result_table(lua_State *L, int i, int64_t *capacity) {
+    if (lua_isnoneornil(L, i)) {
+        lua_createtable(L, *capacity > 0 ? (int)*capacity - 1 : 0, 1);
+        return;
+    }
+    luaL_checktype(L, i, LUA_TTABLE);
+    if (lua_isnoneornil(L, i + 1)) luaL_error(L, "Missing capacity for the result buffer");
+    lua_Integer given = luaL_checkinteger(L, i + 1);
+    *capacity = given > 0 ? given : 0;
+    lua_pushvalue(L, i);
+}
 
+static void set_vector(lua_State *L, int table, int64_t i, const vector *v) {
+    *push_vector(L) = *v;
+    lua_rawseti(L, table, (int)i);
+}
+
+static int module_format(lua_State *L) {
+    lua_settop(L, 3);
+    int32_t len;
+    const vector *items = check_vectors(L, 1, &len);
+    const char *separator = luaL_optstring(L, 3, NULL);
+    int64_t text_len = vector_format_batch(items, len, separator, NULL, 0);
+    char *text = lua_newuserdata(L, text_len + 1);
+    vector_format_batch(items, len, separator, text, text_len + 1);
+    lua_pushlstring(L, text, text_len);
     return 1;
 }
 
-static int vector_normalized(lua_State *L) {
-    vector *self = check_vector(L, 1);
-    vector *result = vector_copy_raw(L, self);
-    vector_div_mut_raw(result, vector_abs_raw(result));
-    lua_pushvalue(L, -1);
+static int module_parse(lua_State *L) {
+    lua_settop(L, 3);
+    size_t text_len;
+    const char *text = luaL_checklstring(L, 1, &text_len);
+    int64_t capacity = vector_parse(text, text_len, NULL, 0, NULL);
+    opt_result_table(L, 2, &capacity);
+    int result = lua_gettop(L);
+
+    int64_t consumed;
+    vector *scratch = lua_newuserdata(L, sizeof(vector) * (capacity > 0 ? capacity : 1));
+    int64_t n = vector_parse(text, text_len, scratch, capacity, &consumed);
+    for (int64_t i = 0; i < n; i++) set_vector(L, result, i, &scratch[i]);
+    lua_pushvalue(L, result);
+    lua_pushinteger(L, n);
+    lua_pushinteger(L, consumed);
+    return 3;
+}
+
+typedef vector *(*reduction)(const vector *items, int64_t len, vector *result);
+
+static int reduce(lua_State *L, reduction f, const char *name) {
+    lua_settop(L, 3);
+    int32_t len;
+    const vector *items = check_vectors(L, 1, &len);
+    if (f(items, len, opt_result(L, 3)) == NULL) {
+        return luaL_error(L, "Can not compute the %s: expected one or more vectors of the same length", name);
+    }
     return 1;
 }
 
-static int vector_normalized2(lua_State *L) {
-    vector *self = check_vector(L, 1);
-    vector *result = vector_copy_raw(L, self);
+static int module_sum(lua_State *L) {
+    return reduce(L, vector_sum, "sum");
+}
 
-    if (self->len != 2) {
-        return luaL_error(
-            L, "vector:normalized2 works only with two-dimensional vectors, got %d", self->len
-        );
+static int module_mean(lua_State *L) {
+    return reduce(L, vector_mean, "mean");
+}
+
+static int module_aabb(lua_State *L) {
+    lua_settop(L, 4);
+    int32_t len;
+    const vector *items = check_vectors(L, 1, &len);
+    vector *min = opt_result(L, 3);
+    vector *max = opt_result(L, 4);
+    if (!vector_aabb(items, len, min, max)) {
+        return luaL_error(L, "Can not compute the bounding box: expected one or more vectors of the same length");
     }
+    return 2;
+}
 
-    if (fabs(self->items[0]) > fabs(self->items[1])) {
-        result->items[0] = copysign(1, self->items[0]);
-        result->items[1] = 0;
-    } else if (self->items[1] != 0) {
-        result->items[0] = 0;
-        result->items[1] = copysign(1, self->items[1]);
-    } else {
-        return luaL_error(L, "Can not normalize zero vector");
+static int module_variance(lua_State *L) {
+    lua_settop(L, 4);
+    int32_t len;
+    const vector *items = check_vectors(L, 1, &len);
+    vector *result = opt_result(L, 3);
+    vector *mean = opt_result(L, 4);
+    if (vector_variance(items, len, mean, result) == NULL) {
+        return luaL_error(L, "Can not compute the variance: expected one or more vectors of the same length");
     }
+    return 2;
+}
 
-    lua_pushvalue(L, -1);
-    return 1;
+// There are no matrix types here, so the covariance is a table with the row-major zero-based
+// `items` and the `dim` of the matrix vector.lua returns
+static int module_covariance(lua_State *L) {
+    lua_settop(L, 3);
+    int32_t len;
+    const vector *items = check_vectors(L, 1, &len);
+    int dim = len > 0 ? items[0].len : 0;
+    if (dim < 2 || dim > MAX_LEN) {
+        return luaL_error(L, "Covariance is defined for vectors of length 2 to 4, got %d", dim);
+    }
+    double matrix[MAX_LEN * MAX_LEN];
+    vector *mean = opt_result(L, 3);
+    if (vector_covariance(items, len, mean, matrix) < 0) {
+        return luaL_error(L, "Can not compute the covariance: expected one or more vectors of the same length");
+    }
+
+    lua_createtable(L, 0, 2);
+    lua_createtable(L, dim * dim - 1, 1);
+    for (int i = 0; i < dim * dim; i++) {
+        lua_pushnumber(L, matrix[i]);
+        lua_rawseti(L, -2, i);
+    }
+    lua_setfield(L, -2, "items");
+    lua_pushinteger(L, dim);
+    lua_setfield(L, -2, "dim");
+    lua_insert(L, -2);
+    return 2;
 }
 
-inline static int vector_map_mut_raw(lua_State *L, vector *self, int argument_i) {
-    luaL_checktype(L, argument_i, LUA_TFUNCTION);
-    
-    for (int i = 0; i < self->len; i++) {
-        lua_pushvalue(L, argument_i);
-        lua_pushnumber(L, self->items[i]);
-        int status = lua_pcall(L, 1, 1, 0);
-        if (status != LUA_OK) {
-            return lua_error(L);
-        }
-        double result = luaL_checknumber(L, -1);
-        self->items[i] = result;
-        lua_pop(L, 1);
+static int module_distances(lua_State *L) {
+    lua_settop(L, 5);
+    const vector *origin = check_vector(L, 1);
+    int32_t len;
+    const vector *items = check_vectors(L, 2, &len);
+    double *distances = lua_newuserdata(L, sizeof(double) * (len > 0 ? len : 1));
+    if (vector_distances(origin, items, len, lua_toboolean(L, 5), distances) == NULL) {
+        return luaL_error(L, "Can not measure distances from %s: lengths differ", to_string(L, 1));
     }
 
+    if (lua_isnoneornil(L, 4)) {
+        lua_createtable(L, len > 0 ? len - 1 : 0, 1);
+    } else {
+        luaL_checktype(L, 4, LUA_TTABLE);
+        lua_pushvalue(L, 4);
+    }
+    for (int32_t i = 0; i < len; i++) {
+        lua_pushnumber(L, distances[i]);
+        lua_rawseti(L, -2, i);
+    }
     return 1;
 }
 
-static int vector_map_mut(lua_State *L) {
-    vector *self = check_vector(L, 1);
-    vector_map_mut_raw(L, self, 2);
-    return 1;
+static int module_within_radius(lua_State *L) {
+    lua_settop(L, 6);
+    const vector *origin = check_vector(L, 1);
+    int32_t len;
+    const vector *items = check_vectors(L, 2, &len);
+    double radius = luaL_checknumber(L, 4);
+    int64_t capacity = vector_within_radius(origin, items, len, radius, NULL, 0);
+    if (capacity < 0) {
+        return luaL_error(L, "Can not filter by distance from %s: lengths differ", to_string(L, 1));
+    }
+    opt_result_table(L, 5, &capacity);
+    if (capacity > INT32_MAX) capacity = INT32_MAX;
+    int result = lua_gettop(L);
+
+    int32_t *indices = lua_newuserdata(L, sizeof(int32_t) * (capacity > 0 ? capacity : 1));
+    int32_t found = vector_within_radius(origin, items, len, radius, indices, (int32_t)capacity);
+    int32_t written = found < capacity ? found : (int32_t)capacity;
+    for (int32_t i = 0; i < written; i++) {
+        lua_pushinteger(L, indices[i]);
+        lua_rawseti(L, result, i);
+    }
+    lua_pushvalue(L, result);
+    lua_pushinteger(L, written);
+    lua_pushinteger(L, found);
+    return 3;
 }
 
-static int vector_map(lua_State *L) {
-    vector *self = check_vector(L, 1);
-    vector *result = vector_copy_raw(L, self);
-    vector_map_mut_raw(L, result, 2);
-    return 1;
+static int module_line(lua_State *L) {
+    lua_settop(L, 4);
+    const vector *from = check_vector(L, 1);
+    const vector *to = check_vector(L, 2);
+    int64_t capacity = sight_line_walk(from, to, NULL, 0);
+    opt_result_table(L, 3, &capacity);
+    if (capacity > INT32_MAX) capacity = INT32_MAX;
+    int result = lua_gettop(L);
+
+    vector *cells = lua_newuserdata(L, sizeof(vector) * (capacity > 0 ? capacity : 1));
+    int32_t n = sight_line_walk(from, to, cells, (int32_t)capacity);
+    int32_t written = n < capacity ? n : (int32_t)capacity;
+    for (int32_t i = 0; i < written; i++) set_vector(L, result, i, &cells[i]);
+    lua_pushvalue(L, result);
+    lua_pushinteger(L, written);
+    lua_pushinteger(L, n);
+    return 3;
 }
 
-static int vector_tostring(lua_State *L) {
-    vector *v = check_vector(L, 1);
+// Writing only: snapshots are read back through memory maps, which vector.load hands out as FFI
+// buffers
+static int module_save(lua_State *L) {
+    lua_settop(L, 4);
+    const char *path = luaL_checkstring(L, 1);
+    int32_t len;
+    const vector *items = check_vectors(L, 2, &len);
+    int32_t precision = lua_isnil(L, 4) ? 8 : (int32_t)luaL_checkinteger(L, 4);
+    vector_snapshot_writer *writer = vector_snapshot_writer_open(path, len > 0 ? items[0].len : 0, precision);
+    if (writer == NULL) return luaL_error(L, "Can not write vector snapshot %s", path);
+
+    bool written = vector_snapshot_writer_write(writer, items, len);
+    bool closed = vector_snapshot_writer_close(writer);
+    if (!written) return luaL_error(L, "Can not write vectors to the snapshot");
+    if (!closed) return luaL_error(L, "Can not finish the vector snapshot");
+    return 0;
+}
+
+// Curve names in the order of the tween.c ids, as in vector.easings of vector.lua
+static const char *const easing_names[] = {
+    "linear",
+    "quad_in", "quad_out", "quad_in_out",
+    "cubic_in", "cubic_out", "cubic_in_out",
+    "quart_in", "quart_out", "quart_in_out",
+    "sine_in", "sine_out", "sine_in_out",
+    "expo_in", "expo_out", "expo_in_out",
+    "back_in", "back_out", "back_in_out",
+    "elastic_in", "elastic_out", "elastic_in_out",
+    "bounce_in", "bounce_out", "bounce_in_out",
+};
 
-    luaL_Buffer b;
-    luaL_buffinit(L, &b);
-    luaL_addstring(&b, "{");
-    for (int i = 0; i < v->len; i++) {
-        lua_pushnumber(L, v->items[i]);
-        luaL_addvalue(&b);
-        if (i < v->len - 1) {
-            luaL_addstring(&b, "; ");
-        }
+#define EASING_COUNT (int)(sizeof(easing_names) / sizeof(easing_names[0]))
+
+static int module_ease(lua_State *L) {
+    int easing = 0;
+    if (lua_type(L, 1) == LUA_TSTRING) {
+        const char *name = lua_tostring(L, 1);
+        for (easing = 0; easing < EASING_COUNT && strcmp(name, easing_names[easing]) != 0; easing++) {}
+        if (easing == EASING_COUNT) return luaL_error(L, "Unknown easing %s", name);
+    } else if (!lua_isnoneornil(L, 1)) {
+        easing = (int)luaL_checkinteger(L, 1);
     }
-    luaL_addstring(&b, "}");
-    luaL_pushresult(&b);
-    return 1;
+    return push_number(L, vector_ease(easing, luaL_checknumber(L, 2)));
 }
 
-static int vector_len(lua_State *L) {
-    vector *v = check_vector(L, 1);
-    lua_pushnumber(L, v->len);
-    return 1;
+static int module_set_threads(lua_State *L) {
+    lua_Integer n = luaL_checkinteger(L, 1);
+    if (!lua_isnoneornil(L, 2)) vector_set_thread_threshold(luaL_checkinteger(L, 2));
+    if (!vector_set_threads((int32_t)n)) {
+        return luaL_error(L, "Can only start %d of %d threads", (int)vector_threads(), (int)n);
+    }
+    return 0;
 }
 
-static int vector_index(lua_State *L) {
-    vector *v = check_vector(L, 1);
-    int index = check_index(L, 2);
-    if (index != -1) {
-        lua_pushnumber(L, v->items[index]);
-        return 1;
-    }
+static int module_threads(lua_State *L) {
+    lua_pushinteger(L, vector_threads());
+    lua_pushinteger(L, vector_thread_threshold());
+    return 2;
+}
 
-    luaL_getmetatable(L, "vector_metatable");
-    lua_pushvalue(L, 2);
-    lua_rawget(L, -2);
+static int module_stats(lua_State *L) {
+    lua_createtable(L, 0, 2);
 
+    lua_newtable(L);
+    for (int32_t i = 0; i < vector_stats_count(); i++) {
+        const char *name;
+        uint64_t calls, cycles;
+        vector_stats_get(i, &name, &calls, &cycles);
+        lua_createtable(L, 0, 2);
+        lua_pushnumber(L, (lua_Number)calls);
+        lua_setfield(L, -2, "calls");
+        lua_pushnumber(L, (lua_Number)cycles);
+        lua_setfield(L, -2, "cycles");
+        lua_setfield(L, -2, name);
+    }
+    lua_setfield(L, -2, "functions");
+
+    lua_newtable(L);
+    for (int i = 0; vector_stats_enabled() && i < ALLOCATION_COUNT; i++) {
+        lua_pushnumber(L, (lua_Number)allocations[i]);
+        lua_setfield(L, -2, allocation_names[i]);
+    }
+    lua_setfield(L, -2, "allocations");
     return 1;
 }
 
-static int vector_newindex(lua_State *L) {
-    vector *v = check_vector(L, 1);
-    int index = check_index(L, 2);
-    double value = luaL_checknumber(L, 3);
-
-    if (index == -1) {
-        const char *key = luaL_checkstring(L, 2);
-        return luaL_error(L, "Cannot set invalid field '%s' on a vector", key);
-    }
+static int module_reset_stats(lua_State *L) {
+    (void)L;
+    vector_stats_reset();
+    memset(allocations, 0, sizeof(allocations));
+    return 0;
+}
 
-    v->items[index] = value;
+// Without pooling nothing is ever pooled: every counter stays 0
+static int module_set_pooling(lua_State *L) {
+    (void)L;
     return 0;
 }
 
-static const struct luaL_Reg vector_methods[] = {
-    { "copy", vector_copy },
-    { "unpack", vector_unpack },
-    { "swizzle", vector_swizzle },
-    { "unm_mut", vector_unm_mut },
-    { "add_mut", vector_add_mut },
-    { "sub_mut", vector_sub_mut },
-    { "mul_mut", vector_mul_mut },
-    { "div_mut", vector_div_mut },
-    { "mod_mut", vector_mod_mut },
-    { "__eq", vector_eq },
-    { "__lt", vector_lt },
-    { "__gt", vector_gt },
-    { "__le", vector_le },
-    { "__ge", vector_ge },
-    { "__unm", vector_unm },
-    { "__add", vector_add },
-    { "__sub", vector_sub },
-    { "__mul", vector_mul },
-    { "__div", vector_div },
-    { "__mod", vector_mod },
-    { "abs", vector_abs },
-    { "abs2", vector_abs2 },
-    { "normalized_mut", vector_normalized_mut },
-    { "normalized2_mut", vector_normalized2_mut },
-    { "normalized", vector_normalized },
-    { "normalized2", vector_normalized2 },
-    { "map_mut", vector_map_mut },
-    { "map", vector_map },
-    { "__tostring", vector_tostring },
-    { "__len", vector_len },
-    { "__index", vector_index },
-    { "__newindex", vector_newindex },
-    { NULL, NULL },
+static int module_pool_stats(lua_State *L) {
+    static const char *const fields[] = {"hits", "misses", "in_use", "peak_in_use", "free", "capacity"};
+    lua_createtable(L, 0, 6);
+    for (int i = 0; i < 6; i++) {
+        lua_pushinteger(L, 0);
+        lua_setfield(L, -2, fields[i]);
+    }
+    return 1;
+}
+
+static const luaL_Reg metamethods[] = {
+    {"__eq", meta_eq},
+    {"__lt", meta_lt},
+    {"__le", meta_le},
+    {"__unm", meta_unm},
+    {"__add", meta_add},
+    {"__sub", meta_sub},
+    {"__mul", meta_mul},
+    {"__div", meta_div},
+    {"__mod", meta_mod},
+    {"__tostring", meta_tostring},
+    {"__len", meta_len},
+    {"__index", meta_index},
+    {"__newindex", meta_newindex},
+    {NULL, NULL},
 };
 
-static const struct luaL_Reg module_methods[] = {
-    { "new", vector_new },
-    { "hex", vector_hex },
-    { "name_from_direction", vector_name_from_direction },
-    { NULL, NULL },
+static const luaL_Reg methods[] = {
+    {"copy", method_copy},
+    {"unpack", method_unpack},
+    {"release", method_release},
+    {"unm_mut", method_unm_mut},
+    {"add_mut", method_add_mut},
+    {"sub_mut", method_sub_mut},
+    {"mul_mut", method_mul_mut},
+    {"div_mut", method_div_mut},
+    {"mod_mut", method_mod_mut},
+    {"abs", method_abs},
+    {"abs2", method_abs2},
+    {"dot", method_dot},
+    {"cross", method_cross},
+    {"dist", method_dist},
+    {"dist2", method_dist2},
+    {"angle_between", method_angle_between},
+    {"normalized_mut", method_normalized_mut},
+    {"normalized2_mut", method_normalized2_mut},
+    {"normalized", method_normalized},
+    {"normalized2", method_normalized2},
+    {"copy_into", method_copy_into},
+    {"unm_into", method_unm_into},
+    {"add_into", method_add_into},
+    {"sub_into", method_sub_into},
+    {"mul_into", method_mul_into},
+    {"div_into", method_div_into},
+    {"mod_into", method_mod_into},
+    {"normalized_into", method_normalized_into},
+    {"normalized2_into", method_normalized2_into},
+    {"madd", method_madd},
+    {"madd_into", method_madd_into},
+    {"lerp", method_lerp},
+    {"lerp_into", method_lerp_into},
+    {"fma", method_fma},
+    {"fma_into", method_fma_into},
+    {"clamp", method_clamp},
+    {"clamp_into", method_clamp_into},
+    {"swizzle", method_swizzle},
+    {"map", method_map},
+    {"map_mut", method_map_mut},
+    {NULL, NULL},
 };
 
-// The main function to open the library.
-// Lua looks for a function named "luaopen_<libraryname>".
-int luaopen_vector(lua_State *L) {
-    // Create the metatable.
-    luaL_newmetatable(L, "vector_metatable");
+static const luaL_Reg items_metamethods[] = {
+    {"__index", items_index},
+    {"__newindex", items_newindex},
+    {NULL, NULL},
+};
 
-    // Set the __index metamethod to the table of methods itself.
-    // This is how methods are looked up.
-    lua_pushvalue(L, -1);
-    lua_setfield(L, -2, "__index");
+static const luaL_Reg module_functions[] = {
+    {"new", vector_new},
+    {"hex", vector_hex},
+    {"name_from_direction", module_name_from_direction},
+    {"axpy", module_axpy},
+    {"simd", module_simd},
+    {"set_simd", module_set_simd},
+    {"frame_scope", module_frame_scope},
+    {"set_pooling", module_set_pooling},
+    {"pool_stats", module_pool_stats},
+    {"reset_pool_stats", module_set_pooling},
+    {"format", module_format},
+    {"parse", module_parse},
+    {"sum", module_sum},
+    {"mean", module_mean},
+    {"aabb", module_aabb},
+    {"variance", module_variance},
+    {"covariance", module_covariance},
+    {"distances", module_distances},
+    {"within_radius", module_within_radius},
+    {"line", module_line},
+    {"save", module_save},
+    {"ease", module_ease},
+    {"set_threads", module_set_threads},
+    {"threads", module_threads},
+    {"stats", module_stats},
+    {"reset_stats", module_reset_stats},
+    {NULL, NULL},
+};
 
-    // Register the methods in the metatable.
-    luaL_register(L, NULL, vector_methods);
+// Sets the functions as fields of the table at `table`, each closing over the stack slots 1 to
+// UPVALUES; works the same from Lua 5.1 to 5.4, unlike luaL_register and luaL_setfuncs
+static void set_functions(lua_State *L, int table, const luaL_Reg *functions) {
+    for (; functions->name != NULL; functions++) {
+        for (int i = 1; i <= UPVALUES; i++) lua_pushvalue(L, i);
+        lua_pushcclosure(L, functions->func, UPVALUES);
+        lua_setfield(L, table, functions->name);
+    }
+}
 
-    // Create the library table and register the functions.
-    lua_newtable(L);
-    luaL_register(L, NULL, module_methods);
-
-    vector *zero = vector_allocate(L);
-    zero->len = 2;
-    zero->items[0] = 0;
-    zero->items[1] = 0;
-    lua_setfield(L, -2, "zero");
-
-    vector *one = vector_allocate(L);
-    one->len = 2;
-    one->items[0] = 1;
-    one->items[1] = 1;
-    lua_setfield(L, -2, "one");
-
-    vector *white = vector_allocate(L);
-    white->len = 3;
-    white->items[0] = 1;
-    white->items[1] = 1;
-    white->items[2] = 1;
-    lua_setfield(L, -2, "white");
-
-    vector *black = vector_allocate(L);
-    black->len = 3;
-    black->items[0] = 0;
-    black->items[1] = 0;
-    black->items[2] = 0;
-    lua_setfield(L, -2, "black");
-
-    lua_createtable(L, 4, 0);  // .extended_directions
-    lua_createtable(L, 4, 0);  // .directions
-
-    vector *up = vector_allocate(L);
-    up->len = 2;
-    up->items[0] = 0;
-    up->items[1] = -1;
-    lua_pushvalue(L, -1);
-    lua_pushvalue(L, -1);
-    lua_setfield(L, -6, "up");
-    lua_rawseti(L, -4, 1);
-    lua_rawseti(L, -2, 1);
-
-    vector *down = vector_allocate(L);
-    down->len = 2;
-    down->items[0] = 0;
-    down->items[1] = 1;
-    lua_pushvalue(L, -1);
-    lua_pushvalue(L, -1);
-    lua_setfield(L, -6, "down");
-    lua_rawseti(L, -4, 2);
-    lua_rawseti(L, -2, 2);
-
-    vector *left = vector_allocate(L);
-    left->len = 2;
-    left->items[0] = -1;
-    left->items[1] = 0;
-    lua_pushvalue(L, -1);
-    lua_pushvalue(L, -1);
-    lua_setfield(L, -6, "left");
-    lua_rawseti(L, -4, 3);
-    lua_rawseti(L, -2, 3);
-
-    vector *right = vector_allocate(L);
-    right->len = 2;
-    right->items[0] = 1;
-    right->items[1] = 0;
-    lua_pushvalue(L, -1);
-    lua_pushvalue(L, -1);
-    lua_setfield(L, -6, "right");
-    lua_rawseti(L, -4, 4);
-    lua_rawseti(L, -2, 4);
-
-    lua_setfield(L, -3, "directions");
-
-    vector *ul = vector_allocate(L);
-    ul->len = 2;
-    ul->items[0] = -1;
-    ul->items[1] = -1;
-    lua_rawseti(L, -2, 5);
-
-    vector *ur = vector_allocate(L);
-    ur->len = 2;
-    ur->items[0] = 1;
-    ur->items[1] = -1;
-    lua_rawseti(L, -2, 6);
-
-    vector *dl = vector_allocate(L);
-    dl->len = 2;
-    dl->items[0] = -1;
-    dl->items[1] = 1;
-    lua_rawseti(L, -2, 7);
-
-    vector *dr = vector_allocate(L);
-    dr->len = 2;
-    dr->items[0] = 1;
-    dr->items[1] = 1;
-    lua_rawseti(L, -2, 8);
-
-    lua_setfield(L, -2, "extended_directions");
+// Calls vector.new(...) from the module table at index 4 and leaves the result on the stack
+static void push_constant(lua_State *L, int len, double x, double y, double z) {
+    lua_getfield(L, 4, "new");
+    lua_pushnumber(L, x);
+    lua_pushnumber(L, y);
+    if (len == 3) lua_pushnumber(L, z);
+    lua_call(L, len, 1);
+}
+
+static void set_constant(lua_State *L, const char *name, int len, double x, double y, double z) {
+    push_constant(L, len, x, y, z);
+    lua_setfield(L, 4, name);
+}
+
+// Fills a sequence at the top of the stack with module fields
+static void set_sequence(lua_State *L, const char *name, const char *const *fields, int len) {
+    lua_createtable(L, len, 0);
+    for (int i = 0; i < len; i++) {
+        lua_getfield(L, 4, fields[i]);
+        lua_rawseti(L, -2, i + 1);
+    }
+    lua_setfield(L, 4, name);
+}
+
+EXPORT int luaopen_vector(lua_State *L) {
+    lua_settop(L, 0);
+    lua_newtable(L);  // 1: vector metatable
+    lua_newtable(L);  // 2: methods
+    lua_newtable(L);  // 3: items proxy metatable
+    lua_newtable(L);  // 4: module
+
+    set_functions(L, 1, metamethods);
+    set_functions(L, 2, methods);
+    set_functions(L, 3, items_metamethods);
+    set_functions(L, 4, module_functions);
+
+    lua_pushstring(L, "capi");
+    lua_setfield(L, 4, "backend");
+    lua_pushvalue(L, 1);
+    lua_setfield(L, 4, "mt");
+
+    // Same constants, in the same order, as vector.lua
+    set_constant(L, "zero", 2, 0, 0, 0);
+    set_constant(L, "one", 2, 1, 1, 0);
+    set_constant(L, "up", 2, 0, -1, 0);
+    set_constant(L, "down", 2, 0, 1, 0);
+    set_constant(L, "left", 2, -1, 0, 0);
+    set_constant(L, "right", 2, 1, 0, 0);
+    set_constant(L, "white", 3, 1, 1, 1);
+    set_constant(L, "black", 3, 0, 0, 0);
+
+    static const char *const direction_names[] = {"up", "left", "down", "right"};
+    lua_createtable(L, 4, 0);
+    for (int i = 0; i < 4; i++) {
+        lua_pushstring(L, direction_names[i]);
+        lua_rawseti(L, -2, i + 1);
+    }
+    lua_setfield(L, 4, "direction_names");
+    set_sequence(L, "directions", direction_names, 4);
+
+    set_sequence(L, "extended_directions", direction_names, 4);
+    lua_getfield(L, 4, "extended_directions");
+    static const double diagonals[][2] = {{1, 1}, {1, -1}, {-1, -1}, {-1, 1}};
+    for (int i = 0; i < 4; i++) {
+        push_constant(L, 2, diagonals[i][0], diagonals[i][1], 0);
+        lua_rawseti(L, -2, 5 + i);
+    }
+
+    lua_createtable(L, 0, EASING_COUNT);
+    for (int i = 0; i < EASING_COUNT; i++) {
+        lua_pushinteger(L, i);
+        lua_setfield(L, -2, easing_names[i]);
+    }
+    lua_setfield(L, 4, "easings");
 
+    lua_settop(L, 4);
     return 1;
 }
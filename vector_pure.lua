@@ -0,0 +1,279 @@
+-- Pure Lua implementation of the core vector API, for interpreters without FFI and as the
+-- baseline in bench.lua. Mirrors the layout of the C struct: `len` and zero-based `items`.
+
+local vector = {}
+
+local vector_methods = {}
+vector.mt = {}
+vector.mt.__index = vector_methods
+
+local unpack = unpack or table.unpack
+
+local allocate = function(len)
+  return setmetatable({len = len, items = {}}, vector.mt)
+end
+
+vector.new = function(...)
+  local n = select('#', ...)
+  if n > 4 then
+    error("Too many arguments, max is " .. 4)
+  end
+
+  local v = allocate(n)
+  for i = 1, n do
+    v.items[i - 1] = select(i, ...)
+  end
+  return v
+end
+
+vector.hex = function(hex)
+  if #hex % 2 ~= 0 or #hex == 0 or #hex > 8 or hex:find("[^%x]") then
+    error("Wrong hex format")
+  end
+
+  local result = allocate(math.floor(#hex / 2))
+  for i = 0, result.len - 1 do
+    result.items[i] = tonumber(hex:sub(2 * i + 1, 2 * i + 2), 16) / 255
+  end
+  return result
+end
+
+vector.zero = vector.new(0, 0)
+vector.one = vector.new(1, 1)
+vector.up = vector.new(0, -1)
+vector.down = vector.new(0, 1)
+vector.left = vector.new(-1, 0)
+vector.right = vector.new(1, 0)
+
+vector.white = vector.new(1, 1, 1)
+vector.black = vector.new(0, 0, 0)
+
+vector.direction_names = {"up", "left", "down", "right"}
+vector.directions = {vector.up, vector.left, vector.down, vector.right}
+vector.extended_directions = {
+  vector.up, vector.left, vector.down, vector.right,
+  vector.new(1, 1), vector.new(1, -1), vector.new(-1, -1), vector.new(-1, 1)
+}
+
+vector.name_from_direction = function(v)
+  if v == vector.up then return "up" end
+  if v == vector.down then return "down" end
+  if v == vector.left then return "left" end
+  if v == vector.right then return "right" end
+end
+
+local truncate = function(x)
+  if x >= 0 then return math.floor(x) end
+  return math.ceil(x)
+end
+
+vector_methods.copy_into = function(self, result)
+  result.len = self.len
+  for i = 0, self.len - 1 do
+    result.items[i] = self.items[i]
+  end
+  return result
+end
+
+vector_methods.copy = function(self)
+  return self:copy_into(allocate(self.len))
+end
+
+vector_methods.unpack = function(self)
+  return unpack(self.items, 0, self.len - 1)
+end
+
+vector_methods.unm_mut = function(self)
+  for i = 0, self.len - 1 do
+    self.items[i] = -self.items[i]
+  end
+  return self
+end
+
+vector_methods.add_mut = function(self, other)
+  for i = 0, self.len - 1 do
+    self.items[i] = self.items[i] + other.items[i]
+  end
+  return self
+end
+
+vector_methods.sub_mut = function(self, other)
+  for i = 0, self.len - 1 do
+    self.items[i] = self.items[i] - other.items[i]
+  end
+  return self
+end
+
+vector_methods.mul_mut = function(self, k)
+  for i = 0, self.len - 1 do
+    self.items[i] = self.items[i] * k
+  end
+  return self
+end
+
+vector_methods.div_mut = function(self, k)
+  for i = 0, self.len - 1 do
+    self.items[i] = self.items[i] / k
+  end
+  return self
+end
+
+vector_methods.mod_mut = function(self, k)
+  k = truncate(k)
+  for i = 0, self.len - 1 do
+    self.items[i] = math.fmod(truncate(self.items[i]), k)
+  end
+  return self
+end
+
+vector_methods.abs = function(self)
+  local result = 0
+  for i = 0, self.len - 1 do
+    result = result + self.items[i] * self.items[i]
+  end
+  return math.sqrt(result)
+end
+
+vector_methods.abs2 = function(self)
+  local result = 0
+  for i = 0, self.len - 1 do
+    result = result + math.abs(self.items[i])
+  end
+  return result
+end
+
+vector_methods.normalized_mut = function(self)
+  local abs_val = self:abs()
+  if abs_val > 0 then
+    self:div_mut(abs_val)
+  end
+  return self
+end
+
+vector_methods.normalized2_mut = function(self)
+  if self.len ~= 2 then return nil end
+  local x, y = self.items[0], self.items[1]
+  if math.abs(x) > math.abs(y) then
+    self.items[0] = x < 0 and -1 or 1
+    self.items[1] = 0
+  elseif y ~= 0 then
+    self.items[0] = 0
+    self.items[1] = y < 0 and -1 or 1
+  end
+  return self
+end
+
+vector_methods.unm_into = function(self, result)
+  return self:copy_into(result):unm_mut()
+end
+
+vector_methods.add_into = function(self, other, result)
+  return self:copy_into(result):add_mut(other)
+end
+
+vector_methods.sub_into = function(self, other, result)
+  if rawequal(other, result) then
+    return self:copy():sub_mut(other):copy_into(result)
+  end
+  return self:copy_into(result):sub_mut(other)
+end
+
+vector_methods.mul_into = function(self, k, result)
+  return self:copy_into(result):mul_mut(k)
+end
+
+vector_methods.div_into = function(self, k, result)
+  return self:copy_into(result):div_mut(k)
+end
+
+vector_methods.mod_into = function(self, k, result)
+  return self:copy_into(result):mod_mut(k)
+end
+
+vector_methods.normalized_into = function(self, result)
+  return self:copy_into(result):normalized_mut()
+end
+
+vector_methods.normalized2_into = function(self, result)
+  if self.len ~= 2 then return nil end
+  return self:copy_into(result):normalized2_mut()
+end
+
+vector.mt.__eq = function(self, other)
+  if self.len ~= other.len then return false end
+  for i = 0, self.len - 1 do
+    if self.items[i] ~= other.items[i] then return false end
+  end
+  return true
+end
+
+vector.mt.__lt = function(self, other)
+  for i = 0, self.len - 1 do
+    if self.items[i] >= other.items[i] then return false end
+  end
+  return true
+end
+
+vector.mt.__le = function(self, other)
+  for i = 0, self.len - 1 do
+    if self.items[i] > other.items[i] then return false end
+  end
+  return true
+end
+
+vector.mt.__unm = function(self)
+  return self:copy():unm_mut()
+end
+
+vector.mt.__add = function(self, other)
+  return self:copy():add_mut(other)
+end
+
+vector.mt.__sub = function(self, other)
+  return self:copy():sub_mut(other)
+end
+
+vector.mt.__mul = function(self, other)
+  return self:copy():mul_mut(other)
+end
+
+vector.mt.__div = function(self, other)
+  return self:copy():div_mut(other)
+end
+
+vector.mt.__mod = function(self, other)
+  return self:copy():mod_mut(other)
+end
+
+vector_methods.normalized = function(self)
+  return self:copy():normalized_mut()
+end
+
+vector_methods.normalized2 = function(self)
+  return self:copy():normalized2_mut()
+end
+
+vector_methods.map_mut = function(self, f)
+  for i = 0, self.len - 1 do
+    self.items[i] = f(self.items[i])
+  end
+  return self
+end
+
+vector_methods.map = function(self, f)
+  return self:copy():map_mut(f)
+end
+
+vector.mt.__len = function(self)
+  return self.len
+end
+
+vector.mt.__tostring = function(self)
+  local parts = {}
+  for i = 0, self.len - 1 do
+    parts[i + 1] = self.items[i]
+  end
+  return "{" .. table.concat(parts, "; ") .. "}"
+end
+
+return vector
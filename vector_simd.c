@@ -0,0 +1,321 @@
+#include <math.h>
+#include <string.h>
+
+#include "vector.h"
+
+#if (defined __x86_64__ || defined __i386__) && defined __GNUC__
+  #define VECTOR_X86 1
+  #include <immintrin.h>
+#endif
+
+// All kernels keep the scalar evaluation order: products are rounded before they are added
+// (the library is built with -ffp-contract=off and no kernel uses FMA), lengths are accumulated
+// component by component starting from zero, and sqrt/div are correctly rounded in every
+// instruction set. This makes every path bit-identical to the scalar one, including abs and
+// normalization, i.e. the ULP bound is 0.
+
+static void scalar_add(double *dst, const double *src, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        dst[i] += src[i];
+    }
+}
+
+static void scalar_sub(double *dst, const double *src, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        dst[i] -= src[i];
+    }
+}
+
+static void scalar_scale(double *dst, double k, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        dst[i] *= k;
+    }
+}
+
+static void scalar_div(double *dst, double k, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        dst[i] /= k;
+    }
+}
+
+static void scalar_add_scaled(double *dst, const double *src, double k, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        dst[i] += src[i] * k;
+    }
+}
+
+static void scalar_abs_columns(double *const *columns, int dim, double *result, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        double abs_val = 0;
+        for (int c = 0; c < dim; c++) {
+            abs_val += columns[c][i] * columns[c][i];
+        }
+        result[i] = sqrt(abs_val);
+    }
+}
+
+static void scalar_normalize_columns(double *const *columns, int dim, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        double abs_val = 0;
+        for (int c = 0; c < dim; c++) {
+            abs_val += columns[c][i] * columns[c][i];
+        }
+        abs_val = sqrt(abs_val);
+        if (abs_val > 0) {
+            for (int c = 0; c < dim; c++) {
+                columns[c][i] /= abs_val;
+            }
+        }
+    }
+}
+
+static const vector_kernel_table scalar_kernels = {
+    .name = "scalar",
+    .add = scalar_add,
+    .sub = scalar_sub,
+    .scale = scalar_scale,
+    .div = scalar_div,
+    .add_scaled = scalar_add_scaled,
+    .abs_columns = scalar_abs_columns,
+    .normalize_columns = scalar_normalize_columns,
+};
+
+#ifdef VECTOR_X86
+
+// SSE2 is part of the x86-64 baseline, so these need no target attribute there
+
+__attribute__((target("sse2")))
+static void sse2_add(double *dst, const double *src, size_t n) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(dst + i, _mm_add_pd(_mm_loadu_pd(dst + i), _mm_loadu_pd(src + i)));
+    }
+    scalar_add(dst + i, src + i, n - i);
+}
+
+__attribute__((target("sse2")))
+static void sse2_sub(double *dst, const double *src, size_t n) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(dst + i, _mm_sub_pd(_mm_loadu_pd(dst + i), _mm_loadu_pd(src + i)));
+    }
+    scalar_sub(dst + i, src + i, n - i);
+}
+
+__attribute__((target("sse2")))
+static void sse2_scale(double *dst, double k, size_t n) {
+    __m128d kk = _mm_set1_pd(k);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(dst + i, _mm_mul_pd(_mm_loadu_pd(dst + i), kk));
+    }
+    scalar_scale(dst + i, k, n - i);
+}
+
+__attribute__((target("sse2")))
+static void sse2_div(double *dst, double k, size_t n) {
+    __m128d kk = _mm_set1_pd(k);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(dst + i, _mm_div_pd(_mm_loadu_pd(dst + i), kk));
+    }
+    scalar_div(dst + i, k, n - i);
+}
+
+__attribute__((target("sse2")))
+static void sse2_add_scaled(double *dst, const double *src, double k, size_t n) {
+    __m128d kk = _mm_set1_pd(k);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d scaled = _mm_mul_pd(_mm_loadu_pd(src + i), kk);
+        _mm_storeu_pd(dst + i, _mm_add_pd(_mm_loadu_pd(dst + i), scaled));
+    }
+    scalar_add_scaled(dst + i, src + i, k, n - i);
+}
+
+__attribute__((target("sse2")))
+static inline __m128d sse2_abs_at(double *const *columns, int dim, size_t i) {
+    __m128d acc = _mm_setzero_pd();
+    for (int c = 0; c < dim; c++) {
+        __m128d x = _mm_loadu_pd(columns[c] + i);
+        acc = _mm_add_pd(acc, _mm_mul_pd(x, x));
+    }
+    return _mm_sqrt_pd(acc);
+}
+
+__attribute__((target("sse2")))
+static void sse2_abs_columns(double *const *columns, int dim, double *result, size_t n) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(result + i, sse2_abs_at(columns, dim, i));
+    }
+    double *tail[MAX_LEN];
+    for (int c = 0; c < dim; c++) tail[c] = columns[c] + i;
+    scalar_abs_columns(tail, dim, result + i, n - i);
+}
+
+__attribute__((target("sse2")))
+static void sse2_normalize_columns(double *const *columns, int dim, size_t n) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d abs_val = sse2_abs_at(columns, dim, i);
+        __m128d mask = _mm_cmpgt_pd(abs_val, _mm_setzero_pd());
+        for (int c = 0; c < dim; c++) {
+            __m128d x = _mm_loadu_pd(columns[c] + i);
+            __m128d q = _mm_div_pd(x, abs_val);
+            _mm_storeu_pd(columns[c] + i, _mm_or_pd(_mm_and_pd(mask, q), _mm_andnot_pd(mask, x)));
+        }
+    }
+    double *tail[MAX_LEN];
+    for (int c = 0; c < dim; c++) tail[c] = columns[c] + i;
+    scalar_normalize_columns(tail, dim, n - i);
+}
+
+static const vector_kernel_table sse2_kernels = {
+    .name = "sse2",
+    .add = sse2_add,
+    .sub = sse2_sub,
+    .scale = sse2_scale,
+    .div = sse2_div,
+    .add_scaled = sse2_add_scaled,
+    .abs_columns = sse2_abs_columns,
+    .normalize_columns = sse2_normalize_columns,
+};
+
+__attribute__((target("avx2")))
+static void avx2_add(double *dst, const double *src, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(dst + i, _mm256_add_pd(_mm256_loadu_pd(dst + i), _mm256_loadu_pd(src + i)));
+    }
+    sse2_add(dst + i, src + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void avx2_sub(double *dst, const double *src, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(dst + i, _mm256_sub_pd(_mm256_loadu_pd(dst + i), _mm256_loadu_pd(src + i)));
+    }
+    sse2_sub(dst + i, src + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void avx2_scale(double *dst, double k, size_t n) {
+    __m256d kk = _mm256_set1_pd(k);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(dst + i, _mm256_mul_pd(_mm256_loadu_pd(dst + i), kk));
+    }
+    sse2_scale(dst + i, k, n - i);
+}
+
+__attribute__((target("avx2")))
+static void avx2_div(double *dst, double k, size_t n) {
+    __m256d kk = _mm256_set1_pd(k);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(dst + i, _mm256_div_pd(_mm256_loadu_pd(dst + i), kk));
+    }
+    sse2_div(dst + i, k, n - i);
+}
+
+__attribute__((target("avx2")))
+static void avx2_add_scaled(double *dst, const double *src, double k, size_t n) {
+    __m256d kk = _mm256_set1_pd(k);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d scaled = _mm256_mul_pd(_mm256_loadu_pd(src + i), kk);
+        _mm256_storeu_pd(dst + i, _mm256_add_pd(_mm256_loadu_pd(dst + i), scaled));
+    }
+    sse2_add_scaled(dst + i, src + i, k, n - i);
+}
+
+__attribute__((target("avx2")))
+static inline __m256d avx2_abs_at(double *const *columns, int dim, size_t i) {
+    __m256d acc = _mm256_setzero_pd();
+    for (int c = 0; c < dim; c++) {
+        __m256d x = _mm256_loadu_pd(columns[c] + i);
+        acc = _mm256_add_pd(acc, _mm256_mul_pd(x, x));
+    }
+    return _mm256_sqrt_pd(acc);
+}
+
+__attribute__((target("avx2")))
+static void avx2_abs_columns(double *const *columns, int dim, double *result, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(result + i, avx2_abs_at(columns, dim, i));
+    }
+    double *tail[MAX_LEN];
+    for (int c = 0; c < dim; c++) tail[c] = columns[c] + i;
+    sse2_abs_columns(tail, dim, result + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void avx2_normalize_columns(double *const *columns, int dim, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d abs_val = avx2_abs_at(columns, dim, i);
+        __m256d mask = _mm256_cmp_pd(abs_val, _mm256_setzero_pd(), _CMP_GT_OQ);
+        for (int c = 0; c < dim; c++) {
+            __m256d x = _mm256_loadu_pd(columns[c] + i);
+            __m256d q = _mm256_div_pd(x, abs_val);
+            _mm256_storeu_pd(columns[c] + i, _mm256_blendv_pd(x, q, mask));
+        }
+    }
+    double *tail[MAX_LEN];
+    for (int c = 0; c < dim; c++) tail[c] = columns[c] + i;
+    sse2_normalize_columns(tail, dim, n - i);
+}
+
+static const vector_kernel_table avx2_kernels = {
+    .name = "avx2",
+    .add = avx2_add,
+    .sub = avx2_sub,
+    .scale = avx2_scale,
+    .div = avx2_div,
+    .add_scaled = avx2_add_scaled,
+    .abs_columns = avx2_abs_columns,
+    .normalize_columns = avx2_normalize_columns,
+};
+
+#endif
+
+vector_kernel_table vector_kernels = scalar_kernels;
+
+static bool vector_simd_supported(const char *name) {
+    if (strcmp(name, "scalar") == 0) return true;
+#ifdef VECTOR_X86
+    __builtin_cpu_init();
+    if (strcmp(name, "sse2") == 0) return __builtin_cpu_supports("sse2");
+    if (strcmp(name, "avx2") == 0) return __builtin_cpu_supports("avx2");
+#endif
+    return false;
+}
+
+// Selects the kernel table by name; returns false if the CPU or the build lacks it
+EXPORT bool vector_simd_set(const char *name) {
+    if (!vector_simd_supported(name)) return false;
+#ifdef VECTOR_X86
+    if (strcmp(name, "avx2") == 0) {
+        vector_kernels = avx2_kernels;
+        return true;
+    }
+    if (strcmp(name, "sse2") == 0) {
+        vector_kernels = sse2_kernels;
+        return true;
+    }
+#endif
+    vector_kernels = scalar_kernels;
+    return true;
+}
+
+EXPORT const char *vector_simd_name(void) {
+    return vector_kernels.name;
+}
+
+__attribute__((constructor))
+static void vector_simd_init(void) {
+    if (!vector_simd_set("avx2")) vector_simd_set("sse2");
+}
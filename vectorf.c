@@ -0,0 +1,175 @@
+#include <math.h>
+#include <string.h>
+
+#include "vector.h"
+
+// Single precision vectors: 20 bytes instead of 40, same operators as `vector`. Arithmetic is
+// done in float, lengths are accumulated in double to avoid overflow on large coordinates.
+
+EXPORT vectorf *vectorf_unm_mut(vectorf *self) {
+    for (int i = 0; i < self->len; i++) {
+        self->items[i] *= -1;
+    }
+    return self;
+}
+
+EXPORT vectorf *vectorf_add_mut(vectorf *self, const vectorf *other) {
+    for (int i = 0; i < self->len; i++) {
+        self->items[i] += other->items[i];
+    }
+    return self;
+}
+
+EXPORT vectorf *vectorf_sub_mut(vectorf *self, const vectorf *other) {
+    for (int i = 0; i < self->len; i++) {
+        self->items[i] -= other->items[i];
+    }
+    return self;
+}
+
+EXPORT vectorf *vectorf_mul_mut(vectorf *self, double k) {
+    for (int i = 0; i < self->len; i++) {
+        self->items[i] *= (float)k;
+    }
+    return self;
+}
+
+EXPORT vectorf *vectorf_div_mut(vectorf *self, double k) {
+    for (int i = 0; i < self->len; i++) {
+        self->items[i] /= (float)k;
+    }
+    return self;
+}
+
+EXPORT vectorf *vectorf_mod_mut(vectorf *self, double k) {
+    for (int i = 0; i < self->len; i++) {
+        self->items[i] = (int)self->items[i] % (int)k;
+    }
+    return self;
+}
+
+EXPORT bool vectorf_eq(const vectorf *self, const vectorf *other) {
+    if (self->len != other->len) return false;
+    for (int i = 0; i < self->len; i++) {
+        if (self->items[i] != other->items[i]) return false;
+    }
+    return true;
+}
+
+EXPORT bool vectorf_lt(const vectorf *self, const vectorf *other) {
+    for (int i = 0; i < self->len; i++) {
+        if (self->items[i] >= other->items[i]) return false;
+    }
+    return true;
+}
+
+EXPORT bool vectorf_le(const vectorf *self, const vectorf *other) {
+    for (int i = 0; i < self->len; i++) {
+        if (self->items[i] > other->items[i]) return false;
+    }
+    return true;
+}
+
+EXPORT double vectorf_abs(const vectorf *self) {
+    double result = 0;
+    for (int i = 0; i < self->len; i++) {
+        result += (double)self->items[i] * self->items[i];
+    }
+    return sqrt(result);
+}
+
+EXPORT double vectorf_abs2(const vectorf *self) {
+    double result = 0;
+    for (int i = 0; i < self->len; i++) {
+        result += fabsf(self->items[i]);
+    }
+    return result;
+}
+
+EXPORT vectorf *vectorf_normalized_mut(vectorf *self) {
+    double abs_val = vectorf_abs(self);
+    if (abs_val > 0) {
+        for (int i = 0; i < self->len; i++) {
+            self->items[i] = self->items[i] / abs_val;
+        }
+    }
+    return self;
+}
+
+EXPORT vectorf *vectorf_normalized2_mut(vectorf *self) {
+    if (self->len != 2) return NULL;
+
+    if (fabsf(self->items[0]) > fabsf(self->items[1])) {
+        self->items[0] = copysignf(1, self->items[0]);
+        self->items[1] = 0;
+    } else if (self->items[1] != 0) {
+        self->items[0] = 0;
+        self->items[1] = copysignf(1, self->items[1]);
+    }
+    return self;
+}
+
+EXPORT vectorf *vectorf_copy_into(const vectorf *self, vectorf *result) {
+    memmove(result, self, sizeof(vectorf));
+    return result;
+}
+
+EXPORT vectorf *vectorf_unm_into(const vectorf *self, vectorf *result) {
+    return vectorf_unm_mut(vectorf_copy_into(self, result));
+}
+
+EXPORT vectorf *vectorf_add_into(const vectorf *self, const vectorf *other, vectorf *result) {
+    vectorf tmp = *self;
+    *result = *vectorf_add_mut(&tmp, other);
+    return result;
+}
+
+EXPORT vectorf *vectorf_sub_into(const vectorf *self, const vectorf *other, vectorf *result) {
+    vectorf tmp = *self;
+    *result = *vectorf_sub_mut(&tmp, other);
+    return result;
+}
+
+EXPORT vectorf *vectorf_mul_into(const vectorf *self, double k, vectorf *result) {
+    return vectorf_mul_mut(vectorf_copy_into(self, result), k);
+}
+
+EXPORT vectorf *vectorf_div_into(const vectorf *self, double k, vectorf *result) {
+    return vectorf_div_mut(vectorf_copy_into(self, result), k);
+}
+
+EXPORT vectorf *vectorf_mod_into(const vectorf *self, double k, vectorf *result) {
+    return vectorf_mod_mut(vectorf_copy_into(self, result), k);
+}
+
+EXPORT vectorf *vectorf_normalized_into(const vectorf *self, vectorf *result) {
+    return vectorf_normalized_mut(vectorf_copy_into(self, result));
+}
+
+EXPORT vectorf *vectorf_normalized2_into(const vectorf *self, vectorf *result) {
+    if (self->len != 2) return NULL;
+    return vectorf_normalized2_mut(vectorf_copy_into(self, result));
+}
+
+EXPORT vectorf *vectorf_from_vector(const vector *source, vectorf *result) {
+    result->len = source->len;
+    for (int i = 0; i < source->len; i++) {
+        result->items[i] = (float)source->items[i];
+    }
+    return result;
+}
+
+EXPORT vector *vector_from_vectorf(const vectorf *source, vector *result) {
+    result->len = source->len;
+    for (int i = 0; i < source->len; i++) {
+        result->items[i] = source->items[i];
+    }
+    return result;
+}
+
+EXPORT bool vectorf_from_hex(const char *hex_str, vectorf *result) {
+    vector tmp;
+    if (!vector_from_hex(hex_str, &tmp)) return false;
+    vectorf_from_vector(&tmp, result);
+    return true;
+}